@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+SmallThink benchmarks.
+
+Runs each workload of this directory (*.small) several times, reports the median and 95th percentile
+of the wall time and the instructions per second, and compares the medians with the baseline.
+A workload slower than its baseline by more than the threshold is a regression : the exit code is then 1.
+
+Usage :
+    bench/bench.py [workload ...] [--binary linux/bin/smallthink] [--runs 15] [--threshold 0.15] [--options "-jit=off"]
+    bench/bench.py --update     records the results as the new baseline.
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+ROOT_DIR = os.path.dirname(BENCH_DIR)
+BASELINE = os.path.join(BENCH_DIR, "baseline.json")
+
+
+def heavy_in_input(path):
+    """Words read by heavy_in.small : 3000000 words, always the same."""
+    words = ["alpha", "be", "gamma", "d", "epsilon", "z", "smallthink", "42", "3.25"]
+    generator = random.Random(42)
+
+    with open(path, "w") as output:
+        for _ in range(600000):
+            output.write(" ".join(generator.choice(words) for _ in range(5)) + "\n")
+
+
+# Standard input of the workloads which read one.
+INPUTS = {
+    "heavy_in": heavy_in_input,
+}
+
+
+def workloads(names):
+    """Returns the names of the workloads to run, all of them by default."""
+    found = sorted(name[:-len(".small")] for name in os.listdir(BENCH_DIR) if name.endswith(".small"))
+
+    for name in names:
+        if name not in found:
+            sys.exit("Unknown workload : " + name)
+
+    return names or found
+
+
+def run(binary, workload, options, stdin_path):
+    """Runs a workload once. Returns the wall time in seconds."""
+    command = [binary, os.path.join(BENCH_DIR, workload + ".small")] + options
+
+    with open(stdin_path or os.devnull, "rb") as stdin:
+        start = time.perf_counter()
+        result = subprocess.run(command, stdin=stdin, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        elapsed = time.perf_counter() - start
+
+    if result.returncode != 0:
+        sys.exit("%s failed with exit code %d." % (workload, result.returncode))
+
+    return elapsed
+
+
+def instructions(binary, workload, options, stdin_path, directory):
+    """
+    Number of instructions the interpreter runs for the workload with the measured options, read from the -stats report of one more run.
+    None if a loop ran as native code : its instructions are not counted, so no rate can be given.
+    """
+    path = os.path.join(directory, workload + ".stats")
+    run(binary, workload, options + ["-stats=" + path], stdin_path)
+
+    with open(path) as stream:
+        stats = json.load(stream)
+
+    return None if stats["native_loops"] else stats["instructions_retired"]
+
+
+def percentile(times, rank):
+    """Nearest rank percentile of the times."""
+    ordered = sorted(times)
+    return ordered[max(0, int(math.ceil(rank / 100.0 * len(ordered))) - 1)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SmallThink benchmarks.")
+    parser.add_argument("workloads", nargs="*", help="workloads to run (all by default)")
+    parser.add_argument("--binary", default=os.path.join(ROOT_DIR, "linux", "bin", "smallthink"), help="interpreter to benchmark")
+    parser.add_argument("--runs", type=int, default=15, help="runs of each workload")
+    parser.add_argument("--threshold", type=float, default=None, help="slowdown flagged as a regression (0.15 is 15%%)")
+    parser.add_argument("--options", default="", help="options given to the interpreter")
+    parser.add_argument("--baseline", default=BASELINE, help="baseline file")
+    parser.add_argument("--update", action="store_true", help="records the results as the new baseline")
+    arguments = parser.parse_args()
+
+    if not os.path.isfile(arguments.binary):
+        sys.exit("Interpreter not found : %s (build it with project/stupidbuild.sh or give --binary)." % arguments.binary)
+
+    baseline = {"threshold": 0.15, "benchmarks": {}}
+
+    if os.path.isfile(arguments.baseline):
+        with open(arguments.baseline) as stream:
+            baseline = json.load(stream)
+
+    threshold = arguments.threshold if arguments.threshold is not None else baseline.get("threshold", 0.15)
+    options = arguments.options.split()
+    results = {}
+    regressions = []
+
+    print("%-16s %10s %10s %14s %10s %10s %8s  %s" % ("workload", "median", "p95", "instructions", "Minstr/s", "baseline", "change", "status"))
+
+    with tempfile.TemporaryDirectory() as directory:
+        for workload in workloads(arguments.workloads):
+            stdin_path = None
+
+            if workload in INPUTS:
+                stdin_path = os.path.join(directory, workload + ".input")
+                INPUTS[workload](stdin_path)
+
+            # A first run warms the caches up, it is not measured.
+            run(arguments.binary, workload, options, stdin_path)
+            times = [run(arguments.binary, workload, options, stdin_path) for _ in range(arguments.runs)]
+
+            median = percentile(times, 50)
+            p95 = percentile(times, 95)
+            count = instructions(arguments.binary, workload, options, stdin_path, directory)
+            results[workload] = {"median": round(median, 6), "p95": round(p95, 6), "instructions": count}
+
+            reference = baseline["benchmarks"].get(workload)
+            status, change, reference_text = "new", "", "-"
+
+            if reference:
+                ratio = median / reference["median"] - 1.0
+                change = "%+.1f%%" % (100.0 * ratio)
+                reference_text = "%.4fs" % reference["median"]
+
+                if ratio > threshold:
+                    status = "REGRESSION"
+                    regressions.append(workload)
+                elif ratio < -threshold:
+                    status = "faster"
+                else:
+                    status = "ok"
+
+            count_text, rate_text = "-", "-"
+
+            if count is not None:
+                count_text, rate_text = "%d" % count, "%.1f" % (count / median / 1e6)
+
+            print("%-16s %9.4fs %9.4fs %14s %10s %10s %8s  %s" % (workload, median, p95, count_text, rate_text, reference_text, change, status))
+
+    if arguments.update:
+        baseline["threshold"] = threshold
+        baseline["benchmarks"].update(results)
+
+        with open(arguments.baseline, "w") as stream:
+            json.dump(baseline, stream, indent=4, sort_keys=True)
+            stream.write("\n")
+
+        print("Baseline updated : " + arguments.baseline)
+        return 0
+
+    if regressions:
+        print("Regressions (more than %.0f%% slower) : %s" % (100.0 * threshold, ", ".join(regressions)))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
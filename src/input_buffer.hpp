@@ -0,0 +1,202 @@
+/*
+	input_buffer.hpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	input_buffer is a class which reads the standard input by large blocks, and gives it back by words or by characters.
+	Words are split like std::cin >> does : on spaces, tabulations, newlines, vertical tabulations, form feeds and carriage returns.
+	The blocks can be read from a source instead of the standard input, a string for instance.
+*/
+
+#ifndef INPUT_BUFFER_HPP
+#define INPUT_BUFFER_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "output_buffer.hpp"
+
+class input_buffer
+{
+	public:
+		// Size of the blocks read, the buffer is allocated once.
+		static const std::size_t capacity = 64 * 1024;
+
+		// Where the blocks are read instead of the standard input.
+		class source
+		{
+			public:
+				virtual ~source()
+				{
+				}
+
+				// Reads at most size characters. Returns their count, 0 at the end of the input.
+				virtual std::size_t read(char* data, std::size_t size) = 0;
+		};
+
+		// The tied output is flushed before waiting for the input, when it writes the lines as they end (like a prompt on a terminal).
+		// Without a source, the standard input is read. Neither the output nor the source are owned.
+		explicit input_buffer(output_buffer* tied = nullptr, source* origin = nullptr) : m_buffer(capacity), m_position(0), m_size(0), m_end(false), m_tied(tied), m_source(origin)
+		{
+		}
+
+		// Reads the next word. Returns false at the end of the input, the word is then left as it was.
+		bool read_word(std::string& word)
+		{
+			// We skip the leading spaces.
+			for(;;)
+			{
+				if(m_position == m_size && !refill())
+					return false;
+
+				while(m_position < m_size && is_space(m_buffer[m_position]))
+					++m_position;
+
+				if(m_position < m_size)
+					break;
+			}
+
+			word.clear();
+
+			// The word is copied by chunks : it may span several blocks.
+			for(;;)
+			{
+				std::size_t begin = m_position;
+
+				while(m_position < m_size && !is_space(m_buffer[m_position]))
+					++m_position;
+
+				word.append(m_buffer.data() + begin, m_position - begin);
+
+				if(m_position < m_size || !refill())
+					return true;
+			}
+		}
+
+		// Reads the next character. Returns -1 at the end of the input.
+		int get()
+		{
+			if(m_position == m_size && !refill())
+				return -1;
+
+			return static_cast<unsigned char>(m_buffer[m_position++]);
+		}
+
+		// Discards the input until the end of the line (included). The end of the input is forgotten : a terminal can be read again.
+		void ignore_line()
+		{
+			m_end = false;
+
+			for(;;)
+			{
+				if(m_position == m_size && !refill())
+					return;
+
+				const void* newline = memchr(m_buffer.data() + m_position, '\n', m_size - m_position);
+
+				if(newline != nullptr)
+				{
+					m_position = static_cast<std::size_t>(static_cast<const char*>(newline) - m_buffer.data()) + 1;
+					return;
+				}
+
+				m_position = m_size;
+			}
+		}
+
+	private:
+		// Not copyable, the buffer is owned.
+		input_buffer(const input_buffer&);
+		input_buffer& operator=(const input_buffer&);
+
+		// Same spaces as std::isspace() in the "C" locale.
+		static bool is_space(char c)
+		{
+			return c == ' ' || (c >= '\t' && c <= '\r');
+		}
+
+		// Reads the next block. Returns false at the end of the input (or on error), which is kept until ignore_line().
+		bool refill()
+		{
+			m_position = 0;
+			m_size = 0;
+
+			if(m_end)
+				return false;
+
+			if(m_tied != nullptr && m_tied->line_buffered())
+				m_tied->flush();
+
+			if(m_source != nullptr)
+			{
+				m_size = m_source->read(m_buffer.data(), m_buffer.size());
+				m_end = m_size == 0;
+				return !m_end;
+			}
+
+#ifndef _WIN32
+			ssize_t count;
+
+			do
+			{
+				count = read(STDIN_FILENO, m_buffer.data(), m_buffer.size());
+			}
+			while(count < 0 && errno == EINTR);
+
+			if(count > 0)
+				m_size = static_cast<std::size_t>(count);
+#else
+			// Without read(), a terminal would block until the whole block is full : we read one line at most.
+			int character;
+
+			while(m_size < m_buffer.size() && (character = getc(stdin)) != EOF)
+			{
+				m_buffer[m_size++] = static_cast<char>(character);
+
+				if(character == '\n')
+					break;
+			}
+
+			clearerr(stdin);
+#endif
+
+			m_end = m_size == 0;
+			return !m_end;
+		}
+
+		std::vector<char> m_buffer;
+		std::size_t m_position;
+		std::size_t m_size;
+		bool m_end;
+		output_buffer* m_tied;
+		source* m_source;
+};
+
+#endif // INPUT_BUFFER_HPP
@@ -1,5 +1,5 @@
 /*
-	main.hpp
+	main.cpp
 
 	The MIT License (MIT)
 
@@ -22,1264 +22,458 @@
 	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-	This is the interpreter for SmallThink, a toy-programming-exotic-language.
+	This is the command line interpreter for SmallThink, a toy-programming-exotic-language, built on libsmallthink (smallthink.hpp).
 	Look at doc/tutorial.rst for a better description of SmallThink.
 */
 
 // Because we manipulate strings a lot.
 #include <string>
 
-// For std::cout, std::cin and std::ifstream.
+// For std::cout, std::cin and std::ofstream.
 #include <iostream>
 #include <fstream>
 
-// For runtime, used to manipulates variables by their names.
-#include <map>
-#include <utility>
-
-// To catch exceptions.
-#include <stdexcept>
-
-// For flushing std::cin, time(), srand() and rand().
-#include <climits>
+// For clock() of -time.
 #include <ctime>
+
+// For strtoul() of -jobs.
 #include <cstdlib>
 
-// For trim and conversions functions : to and from.
-#include "string_utils.hpp"
+// For the outputs and the errors of the runs of a batch.
+#include <sstream>
+#include <vector>
 
-/* Some useful data structures and enums. */
-namespace data
-{
-    /* Opcodes list. */
-    std::vector<std::string> opcodes = {"mov", "add", "mul", "cmp_eq", "cmp_gt", "cmp_lt", "neg", "out", "in", "get", "flush", "stop", "label", "jmp", "jnz", "jz", "num", "str", "num_int", "seed_random"};
+// For std::bad_alloc, caught so that a run of a batch out of memory fails alone.
+#include <new>
 
-    /* Returns true if given string is in opcodes list. */
-    bool is_opcode(std::string x)
+// The interpreter.
+#include "smallthink.hpp"
+
+// To run a batch on every core.
+#include "work_stealing_pool.hpp"
+
+/* Command line options. */
+struct options
+{
+    bool time_measurement; // -time
+    std::string compile_to; // -compile [output]
+    smallthink::engine used_engine; // -engine=switch|threaded
+    bool optimize; // -O
+    bool dump_instructions; // -dump
+    bool explain_types; // -explain-types
+    bool use_jit; // -jit=on|off
+    bool use_trace; // -trace=on|off
+    output_buffer::flush_policy flush; // -flush=exit|full|line
+    bool profile; // -profile
+    std::string stats_to; // -stats[=path], "-" for the error output.
+    bool batch; // -batch script... or script -inputs input...
+    std::vector<std::string> batch_files; // The scripts of -batch, or the inputs of -inputs.
+    unsigned int jobs; // -jobs=count, 0 for one per hardware thread.
+    std::string cache_directory; // -cache=on|off|directory, empty for no cache.
+    std::string single_run; // The last option given which only applies to a single run (-time, -compile, -flush, -profile, -stats, -dump, -explain-types).
+
+    options() : time_measurement(false), compile_to(""), used_engine(smallthink::ENGINE_THREADED), optimize(false), dump_instructions(false), explain_types(false), use_jit(true), use_trace(true), flush(output_buffer::FP_LINE), profile(false), stats_to(""), batch(false), jobs(0), cache_directory(""), single_run("")
     {
-        return find(opcodes.begin(), opcodes.end(), x) != opcodes.end();
     }
+};
 
-    /* Returns true if given string is a decimal number. */
-    bool is_number(std::string x)
-    {
-        // Empty strings are not numbers.
-        if(x.size() > 0)
+/*
+    Runs of a batch : each script once with an empty input, or one script once per input file.
+    Each run has its own virtual machine, random generator and buffers : its output and its errors are kept to be printed in order.
+*/
+class batch : public work_stealing_pool::task
+{
+    public:
+        std::vector<std::string> outputs;
+        std::vector<std::string> errors;
+        std::vector<int> results;
+
+        // Without a program, the files are scripts compiled by each run. With one, they are its inputs.
+        batch(const options& launch, const smallthink::program* shared) : outputs(launch.batch_files.size()), errors(launch.batch_files.size()), results(launch.batch_files.size()), m_launch(launch), m_shared(shared)
+        {
+        }
+
+        // A run which fails, even out of memory, only sets its own status : the other runs go on.
+        virtual void run(std::size_t job)
         {
-            unsigned int offset(0); // No offset.
+            std::ostringstream printed_errors;
 
-            // If starts by a '-'.
-            if(x.at(0) == '-')
-                offset = 1;
+            try
+            {
+                smallthink::program own;
+                const smallthink::program* compiled = m_shared;
+                const std::string& file = m_launch.batch_files[job];
 
-            for(unsigned int i(offset) ; i < x.size() ; ++i)
-                if(!isdigit(x.at(i)) && x.at(i) != '.')
+                if(compiled == nullptr)
                 {
-                    return false;
+                    smallthink::compile_options build;
+                    build.optimize = m_launch.optimize;
+                    build.use_jit = m_launch.use_jit;
+                    build.trace = m_launch.use_trace;
+                    build.cache_directory = m_launch.cache_directory;
+                    build.errors = &printed_errors;
+
+                    results[job] = own.compile_file(file, build);
+                    compiled = &own;
                 }
 
-            return true;
+                if(compiled->compiled())
+                    results[job] = execute(*compiled, m_shared != nullptr ? file : "", outputs[job], printed_errors);
+            }
+            catch(const std::bad_alloc&)
+            {
+                outputs[job].clear();
+                printed_errors << std::endl << "[ERROR] Out of memory" << std::endl;
+                results[job] = smallthink::ST_RUNTIME_ERROR;
+            }
+
+            errors[job] = printed_errors.str();
         }
 
-        return false;
-    }
+    private:
+        // Runs the program once, reading the input file if any. Returns the status of the run.
+        int execute(const smallthink::program& compiled, const std::string& input_file, std::string& printed, std::ostream& printed_errors)
+        {
+            smallthink::string_output captured;
+            smallthink::string_input no_input("");
+            smallthink::file_input file_input(input_file);
 
-    /* Tokens types, prefixed by TT_ (TOKEN TYPE_). */
-    enum token_type
-    {
-        TT_COMA,
-        TT_STRING,
-        TT_IDENTIFIER,
-        TT_NUMERIC
-    };
-
-    /* Represents a token. For easier manipulation. */
-    struct token
-    {
-        token_type type;
-        std::string value;
-    };
-
-    /*
-        Used by parser to know wich token is expected depending of the actual instruction.
-        Prefixed by ET_ (EXPECTED TOKEN_).
-    */
-    enum expected_token
-    {
-        ET_OPCODE,
-        ET_COMA,
-        ET_IDENTIFIER,
-        ET_IDENTIFIER_OR_NUMERIC,
-        ET_IDENTIFIER_OR_NUMERIC_OR_STRING
-    };
-
-    /* Used by parser to know if a token type match an expectation. */
-    bool match_expectation(expected_token e_type, token g_token)
-    {
-        token_type t_type = g_token.type;
+            if(input_file != "" && !file_input.is_open())
+            {
+                printed_errors << "[ERROR] Can not open file : " << input_file << std::endl;
+                return smallthink::ST_INVALID_INPUT;
+            }
 
-        switch(e_type)
-        {
-            case ET_OPCODE:
-                return (t_type == TT_IDENTIFIER) && is_opcode(g_token.value);
-                break;
-            case ET_COMA:
-                return t_type == TT_COMA;
-                break;
-            case ET_IDENTIFIER:
-                return t_type == TT_IDENTIFIER;
-                break;
-            case ET_IDENTIFIER_OR_NUMERIC:
-                return (t_type == TT_IDENTIFIER) || (t_type == TT_NUMERIC);
-                break;
-            case ET_IDENTIFIER_OR_NUMERIC_OR_STRING:
-                return (t_type == TT_IDENTIFIER) || (t_type == TT_NUMERIC) || (t_type == TT_STRING);
-                break;
-            default:
-                return false;
-                break;
+            output_buffer output(output_buffer::FP_EXIT, &captured);
+            input_buffer input(&output, input_file != "" ? static_cast<input_buffer::source*>(&file_input) : &no_input);
+            smallthink::vm machine(compiled);
+            smallthink::run_options execution;
+            execution.used_engine = m_launch.used_engine;
+            execution.errors = &printed_errors;
+
+            int result = machine.run(input, output, execution);
+
+            output.flush();
+            printed.swap(captured.text);
+            return result;
         }
-    }
 
-    /* DEBUG ONLY. Return the string representation of the type of the token. */
-    std::string print_type(token g_token)
+        const options& m_launch;
+        const smallthink::program* m_shared;
+};
+
+/*
+    Runs a batch on a work stealing pool, then prints the outputs in order, and the errors of each run after its output.
+    Returns the status of the first run which failed, or 0.
+*/
+int run_batch(const std::string& filename, const options& launch)
+{
+    smallthink::program shared;
+
+    if(filename != "")
     {
-        switch(g_token.type)
-        {
-            case data::TT_IDENTIFIER:
-                return "identifier";
-                break;
-            case data::TT_COMA:
-                return "coma";
-                break;
-            case data::TT_STRING:
-                return "string";
-                break;
-            case data::TT_NUMERIC:
-                return "numeric";
-                break;
-            default:
-                return "";
-                break;
-        }
+        smallthink::compile_options build;
+        build.optimize = launch.optimize;
+        build.use_jit = launch.use_jit;
+        build.trace = launch.use_trace;
+        build.cache_directory = launch.cache_directory;
+
+        smallthink::status compiled = shared.compile_file(filename, build);
+
+        if(compiled != smallthink::ST_OK)
+            return compiled;
     }
 
-    /* DEBUG ONLY. Return the string representation of the expected type. */
-    std::string print_type(expected_token t_type)
+    batch runs(launch, filename != "" ? &shared : nullptr);
+    work_stealing_pool pool(launch.jobs);
+    int result = 0;
+
+    pool.run(runs, launch.batch_files.size());
+
+    for(std::size_t i(0) ; i < launch.batch_files.size() ; ++i)
     {
-        switch(t_type)
+        std::cout << runs.outputs[i];
+
+        if(runs.errors[i] != "")
         {
-            case ET_OPCODE:
-                return "opcode";
-                break;
-            case ET_COMA:
-                return "coma";
-                break;
-            case ET_IDENTIFIER:
-                return "identifier";
-                break;
-            case ET_IDENTIFIER_OR_NUMERIC:
-                return "identifier_or_numeric";
-                break;
-            case ET_IDENTIFIER_OR_NUMERIC_OR_STRING:
-                return "identifier_or_numeric_or_string";
-                break;
-            default:
-                return "none:" + string_utils::from<expected_token>(t_type);
-                break;
+            std::cout.flush();
+            std::cerr << runs.errors[i];
         }
+
+        if(result == 0)
+            result = runs.results[i];
     }
 
-} // data namespace.
+    std::cout.flush();
+    return result;
+}
 
-/* Some useful runtime structures and enums. */
-namespace runtime
+/*
+    Compiles the file and runs it once.
+    Bytecode files are recognized and loaded directly. If compile_to is given, the program is saved as bytecode instead of being run.
+    The optimizer runs before saving, so a compiled program is already optimized.
+    Each phase is timed in the given statistics, and the runtime is instrumented for -stats and -profile.
+*/
+int load_from_file(std::string filename, smallthink::statistics& stats, const options& launch = options())
 {
-    /* Used to indicate the opcode of an instruction. */
-    enum opcode
-    {
-        MOV,
-        ADD,
-        MUL,
-        CMP_EQ,
-        CMP_GT,
-        CMP_LT,
-        NEG,
-        OUT,
-        IN,
-        GET,
-        STOP,
-        FLUSH,
-        LABEL,
-        JMP,
-        JNZ,
-        JZ,
-        NUM,
-        STR,
-        NUM_INT,
-        SEED_RANDOM,
-        NONE
-    };
-
-    /* Represents an instruction for easier manipulation. */
-    struct instruction
-    {
-        opcode op;
-        data::token* f_arg;
-        data::token* s_arg;
-    };
+    // A saved, dumped or explained program is neither compiled by the JIT, fused, specialized nor traced, these instructions are internal.
+    // A profiled program runs the instructions one by one, so each of them is counted : it is neither compiled, traced nor fused.
+    bool lowered = !launch.dump_instructions && !launch.explain_types && launch.compile_to == "" && !launch.profile;
+    smallthink::compile_options build;
+    build.optimize = launch.optimize;
+    build.use_jit = launch.use_jit && lowered;
+    build.fuse = lowered;
+    build.specialize = lowered;
+    build.trace = launch.use_trace && lowered;
+    build.stats = &stats;
+    build.cache_directory = launch.cache_directory;
+
+    smallthink::program compiled;
+    smallthink::status result = compiled.compile_file(filename, build);
+
+    if(result != smallthink::ST_OK)
+        return result;
 
-    /* DEBUG ONLY. Returns the string representation of the opcode. */
-    std::string print_opcode(opcode op)
+    if(launch.dump_instructions)
     {
-        switch(op)
-        {
-            case MOV:
-                return "mov";
-                break;
-            case ADD:
-                return "add";
-                break;
-            case MUL:
-                return "mul";
-                break;
-            case CMP_EQ:
-                return "cmp_eq";
-                break;
-            case CMP_GT:
-                return "cmp_gt";
-                break;
-            case CMP_LT:
-                return "cmp_lt";
-                break;
-            case NEG:
-                return "neg";
-                break;
-            case OUT:
-                return "out";
-                break;
-            case IN:
-                return "in";
-                break;
-            case GET:
-                return "get";
-                break;
-            case FLUSH:
-                return "flush";
-                break;
-            case JMP:
-                return "jmp";
-                break;
-            case JNZ:
-                return "jnz";
-                break;
-            case JZ:
-                return "jz";
-                break;
-            case NUM:
-                return "num";
-                break;
-            case STR:
-                return "str";
-                break;
-            case NUM_INT:
-                return "num_int";
-                break;
-            case LABEL:
-                return "label";
-                break;
-            case STOP:
-                return "stop";
-                break;
-            case SEED_RANDOM:
-                return "seed_random";
-                break;
-            default:
-                return "";
-                break;
-        }
+        compiled.dump(std::cout);
+        return smallthink::ST_OK;
     }
-    /* Return the opcode CODE depending of the opcode STRING representation. */
-    opcode get_opcode(std::string x)
+
+    if(launch.explain_types)
     {
-        x = string_utils::lowercase(x);
-
-        if(x == "mov")
-            return MOV;
-        else if(x == "add")
-            return ADD;
-        else if(x == "mul")
-            return MUL;
-        else if(x == "cmp_eq")
-            return CMP_EQ;
-        else if(x == "cmp_gt")
-            return CMP_GT;
-        else if(x == "cmp_lt")
-            return CMP_LT;
-        else if(x == "neg")
-            return NEG;
-        else if(x == "out")
-            return OUT;
-        else if(x == "in")
-            return IN;
-        else if(x == "get")
-            return GET;
-        else if(x == "flush")
-            return FLUSH;
-        else if(x == "stop")
-            return STOP;
-        else if(x == "label")
-            return LABEL;
-        else if(x == "jmp")
-            return JMP;
-        else if(x == "jz")
-            return JZ;
-        else if(x == "jnz")
-            return JNZ;
-        else if(x == "num")
-            return NUM;
-        else if(x == "str")
-            return STR;
-        else if(x == "num_int")
-            return NUM_INT;
-        else if(x == "seed_random")
-            return SEED_RANDOM;
-
-        return NONE;
+        compiled.explain_types(std::cout);
+        return smallthink::ST_OK;
     }
 
-    /* Return the number of arguments needed to complete an instruction (depending of the opcode). */
-    int get_number_of_args_needed(opcode g_opcode)
+    if(launch.compile_to != "")
+        return compiled.save(launch.compile_to);
+
+    smallthink::vm machine(compiled);
+    smallthink::run_options execution;
+    execution.used_engine = launch.used_engine;
+    execution.profile = launch.profile;
+    execution.stats = launch.stats_to != "" ? &stats : nullptr;
+
+    // The buffer is put under std::cout while running, so anything else printed there keeps its place in the output.
+    // std::cerr flushes std::cout before printing an error, the input flushes it before waiting when lines are written as they end.
+    output_buffer output(launch.flush);
+    input_buffer input(&output);
+    std::streambuf* previous_buffer = std::cout.rdbuf(&output);
+
+    if(launch.time_measurement)
     {
-        switch(g_opcode)
-        {
-            case MOV:
-            case ADD:
-            case MUL:
-            case CMP_EQ:
-            case CMP_GT:
-            case CMP_LT:
-                return 2;
-            case NEG:
-            case OUT:
-            case IN:
-            case GET:
-            case JMP:
-            case JNZ:
-            case JZ:
-            case NUM:
-            case STR:
-            case NUM_INT:
-            case LABEL:
-                return 1;
-            // case STOP:
-            // case FLUSH:
-            // case SEED_RANDOM:
-            default:
-                return 0;
-                break;
-        }
-    }
+        clock_t start_time = clock();
+        result = machine.run(input, output, execution);
+        clock_t end_time = clock();
 
-    /* Returns the token type of the argument needed (depending of the opcode and the argument number). */
-    data::expected_token get_expected_argument_type(opcode op, int argument_number)
+        std::cout << "----------------------------------" << std::endl;
+        std::cout << "[TIME] " << (end_time - start_time) << " clicks (" << (float)(end_time - start_time)/CLOCKS_PER_SEC << " seconds.)" << std::endl;
+    }
+    else
     {
-        switch(op)
-        {
-            case MOV:
-            case ADD:
-            case MUL:
-            case CMP_EQ:
-            case CMP_GT:
-            case CMP_LT:
-                if(argument_number == 1)
-                    return data::ET_IDENTIFIER;
-
-                return data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING;
-                break;
-            case OUT:
-                return data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING;
-                break;
-            case NEG:
-            case IN:
-            case GET:
-            case JMP:
-            case JNZ:
-            case JZ:
-            case NUM:
-            case STR:
-            case NUM_INT:
-            case LABEL:
-                return data::ET_IDENTIFIER;
-                break;
-            // case STOP:
-            // case FLUSH:
-            // case SEED_RANDOM:
-            default:
-                return data::ET_OPCODE;
-                break;
-        }
+        result = machine.run(input, output, execution);
     }
 
-    /* Represents a dynamic variable type. */
-    enum dynamic_variable_type
-    {
-        DVT_NUMERIC,
-        DVT_STRING
-    };
+    output.flush();
+    std::cout.rdbuf(previous_buffer);
 
-    /* Used by the runtime to represent a dynamically typed variable. */
-    struct dynamic_variable
-    {
-        dynamic_variable_type type;
-        std::string value;
-    };
+    // The report goes to std::cerr, after the output of the program.
+    if(launch.profile)
+        machine.report_profile(std::cerr);
 
-} // runtime namespace.
+    return result;
+}
 
 /*
-    Very basic lexer.
-
-    FIXME: The for loop used to read the line is dirty.
+    Main function.
+
+    Usage : smallthink filename [-time] [-compile [output]] [-engine=switch|threaded] [-jit=on|off] [-trace=on|off] [-flush=exit|full|line] [-profile] [-stats[=path]] [-cache=on|off|directory] [-O] [-dump] [-explain-types]
+            smallthink -batch script... [-jobs=count] [-engine=switch|threaded] [-jit=on|off] [-trace=on|off] [-cache=on|off|directory] [-O]
+            smallthink filename -inputs input... [-jobs=count] [-engine=switch|threaded] [-jit=on|off] [-trace=on|off] [-cache=on|off|directory] [-O]
+        -time       prints the execution time.
+        -compile    saves the program as bytecode (in filename.stbc by default) instead of running it.
+        -engine     selects the dispatch engine of the runtime, threaded by default.
+        -jit        compiles the numeric loops to native code (x86-64 only), on by default.
+        -trace      runs the hot loops left to the interpreter with types not known before running as traces specialized for the types seen, on by default.
+        -flush      selects when the output is written : at exit, when the buffer is full, or at each line on a terminal (the default).
+        -profile    counts and times each instruction, and prints a report on the error output at exit.
+        -stats      writes the time of each phase and the counters of the run as JSON, to the file or to the error output.
+        -cache      caches the compiled sources in $XDG_CACHE_HOME/smallthink (on) or in the directory, off by default.
+        -O          optimizes the program before running or saving it.
+        -dump       prints the instructions of the program instead of running it.
+        -explain-types  prints the add, mul and cmp_* instructions whose argument types are not known, instead of running the program.
+        -batch      runs each script once with an empty input, on several threads. The outputs are printed in the order of the scripts.
+        -inputs     runs the script once per input file, on several threads. The outputs are printed in the order of the inputs.
+        -jobs       number of threads of a batch, one per hardware thread by default.
+        -time, -compile, -flush, -profile, -stats, -dump and -explain-types apply to a single run, they are rejected with -batch and -inputs.
 */
-std::vector<data::token> lex(std::ifstream &inputfile)
+int main(int argc, char* argv[])
 {
-    std::vector<data::token> tokens;
-    std::string line("");
-
-    /* We read the file line by line. */
-    while(std::getline(inputfile, line))
+    /* Arguments check. */
+    if(argc > 1 && argv[1])
     {
-        // First we trim the line.
-        line = string_utils::trim(line);
+        std::string filename(argv[1]);
+        options launch;
 
-        // We check if the line is not a comment or not empty.
-        if(line.size() < 1 || line.at(0) == ';')
-            continue;
-
-        // We are starting the reading.
-        data::token current_token; // The current token.
-        std::string word(""); // The current word.
-        bool is_string(false), is_escaped(false); // To indicate if we are in a string and if we are
+        // The scripts of a batch follow -batch, instead of the filename.
+        if(filename == "-batch")
+        {
+            filename = "";
+            launch.batch = true;
+        }
 
-        for(unsigned int i(0) ; i < line.size() ; ++i) // FIXME: this loop is dirty, need to find a more elegant way to do it.
+        for(int i(2) ; i < argc ; ++i)
         {
-            char cchar(line.at(i));
+            std::string option(argv[i]);
 
-            // If we met a coma and we are not in a string, it's considered as a token.
-            if(cchar == ',' && !is_string)
+            if(option[0] != '-')
             {
-                // We initialize the previous token, if there was.
-                if(word != "")
-                {
-                    if(data::is_number(word))
-                        current_token.type = data::TT_NUMERIC;
-                    else
-                        current_token.type = data::TT_IDENTIFIER;
-
-                    current_token.value = word;
-
-                    // We clear the current word.
-                    word = "";
-
-                    // Then we push our token in the token list.
-                    tokens.push_back(current_token);
-                }
-
-                // And then we initializa the coma token.
-                current_token.type = data::TT_COMA;
-                current_token.value = ",";
+                // A script of -batch or an input of -inputs.
+                if(launch.batch)
+                    launch.batch_files.push_back(option);
+            }
+            else if(option == "-time")
+            {
+                launch.time_measurement = true;
+                launch.single_run = option;
+            }
+            else if(option == "-compile")
+            {
+                // The output filename is optional.
+                if(i + 1 < argc && argv[i + 1][0] != '-')
+                    launch.compile_to = argv[++i];
+                else
+                    launch.compile_to = filename + ".stbc";
 
-                // Then we push our token in the token list.
-                tokens.push_back(current_token);
+                launch.single_run = option;
             }
-            // If we are in a string and an un-escaped slash appears, we know the next char will be escaped.
-            else if(cchar == '\\' && is_string && !is_escaped)
+            else if(option == "-engine=switch")
             {
-                is_escaped = true;
+                launch.used_engine = smallthink::ENGINE_SWITCH;
             }
-            // If we are not in a string and a double-quote appears, we know that we are starting a string.
-            else if(cchar == '"' && !is_string)
+            else if(option == "-engine=threaded")
             {
-                is_string = true;
+                launch.used_engine = smallthink::ENGINE_THREADED;
             }
-            // If we are in a string and an un-escaped double-quote appears, we know that we have finished the string.
-            else if(cchar == '"' && is_string && !is_escaped)
+            else if(option == "-jit=on")
             {
-                // End of string.
-                is_string = false;
-
-                // We initialize the token.
-                current_token.type = data::TT_STRING;
-                current_token.value = word;
-
-                // We clear the current word.
-                word = "";
-
-                // Then we push our token in the token list.
-                tokens.push_back(current_token);
+                launch.use_jit = true;
             }
-            // If we are not in a string and a space appears, it's the end of the token.
-            else if(isspace(cchar) && !is_string)
+            else if(option == "-jit=off")
             {
-                if(word != "")
-                {
-                    // We initialize the token.
-                    if(data::is_number(word))
-                        current_token.type = data::TT_NUMERIC;
-                    else
-                        current_token.type = data::TT_IDENTIFIER;
-
-                    current_token.value = word;
-
-                    // We clear the current word.
-                    word = "";
-
-                    // Then we push our token in the token list.
-                    tokens.push_back(current_token);
-                }
+                launch.use_jit = false;
             }
-            else
+            else if(option == "-trace=on")
             {
-                // We put the char into the current word.
-                word += cchar;
-                is_escaped = false;
+                launch.use_trace = true;
+            }
+            else if(option == "-trace=off")
+            {
+                launch.use_trace = false;
+            }
+            else if(option == "-flush=exit")
+            {
+                launch.flush = output_buffer::FP_EXIT;
+                launch.single_run = option;
+            }
+            else if(option == "-flush=full")
+            {
+                launch.flush = output_buffer::FP_FULL;
+                launch.single_run = option;
+            }
+            else if(option == "-flush=line")
+            {
+                launch.flush = output_buffer::FP_LINE;
+                launch.single_run = option;
+            }
+            else if(option == "-O")
+            {
+                launch.optimize = true;
+            }
+            else if(option == "-dump")
+            {
+                launch.dump_instructions = true;
+                launch.single_run = option;
+            }
+            else if(option == "-explain-types")
+            {
+                launch.explain_types = true;
+                launch.single_run = option;
+            }
+            else if(option == "-profile")
+            {
+                launch.profile = true;
+                launch.single_run = option;
+            }
+            else if(option == "-stats" || option == "-stats=-")
+            {
+                launch.stats_to = "-";
+                launch.single_run = option;
+            }
+            else if(option.compare(0, 7, "-stats=") == 0)
+            {
+                launch.stats_to = option.substr(7);
+                launch.single_run = option;
+            }
+            else if(option == "-inputs")
+            {
+                launch.batch = true;
+            }
+            else if(option.compare(0, 6, "-jobs=") == 0)
+            {
+                launch.jobs = static_cast<unsigned int>(strtoul(option.c_str() + 6, nullptr, 10));
+            }
+            else if(option == "-cache=on")
+            {
+                launch.cache_directory = smallthink::default_cache_directory();
+            }
+            else if(option == "-cache=off")
+            {
+                launch.cache_directory = "";
+            }
+            else if(option.compare(0, 7, "-cache=") == 0)
+            {
+                launch.cache_directory = option.substr(7);
             }
         }
 
-        // If word is not empty.
-        if(word != "")
-        {
-            // We initialize the last token.
-            if(word == ",")
-                current_token.type = data::TT_COMA;
-            else if(data::is_number(word))
-                current_token.type = data::TT_NUMERIC;
-            else
-                current_token.type = data::TT_IDENTIFIER;
-
-            current_token.value = word;
-
-            // Then we push it in the token list.
-            tokens.push_back(current_token);
-        }
-    }
-
-    return tokens;
-}
-
-/* Very basic parser. */
-std::vector<runtime::instruction> parse(std::vector<data::token> tokens)
-{
-    std::vector<runtime::instruction> instructions;
-    runtime::instruction current_instruction{runtime::NONE, 0, 0};
-    data::expected_token expected_token_type(data::ET_OPCODE); // At the beginning we expect an opcode.
-
-    enum {IE_OPCODE, IE_FARG, IE_COMA, IE_SARG} instruction_element = IE_OPCODE; // Used to know wich element we need to complete the instruction.
-    bool instruction_complete = false; // Used to know if current instruction is complete.
-
-    /*
-        We parse all the tokens.
-
-        An instruction is either :
-            opcode identifier|numeric|string coma identifier|numeric|string
-            opcode identifier|numeric|string
-            opcode
-    */
-    for(unsigned int i(0) ; i < tokens.size() ; ++i)
-    {
-        // If the token is not expected.
-        if(!match_expectation(expected_token_type, tokens.at(i)))
-        {
-            std::cout << "[" << i << "] Unexpected token: (" << data::print_type(tokens.at(i)) << ") \"" << tokens.at(i).value << "\"." << std::endl;
-            std::cout << "[" << i << "] Expecting: (" << data::print_type(expected_token_type) << ")." << std::endl;
-            exit(1);
-        }
-        else
+        if(launch.batch)
         {
-            // We check wich element we need to complete the instruction.
-            switch(instruction_element)
+            // A batch has no single run to time, save, flush as it goes, profile or measure.
+            if(launch.single_run != "")
             {
-                case IE_OPCODE:
-                    current_instruction.op = runtime::get_opcode(tokens.at(i).value);
-
-                    // Depending of the opcode we need (or don't need) an argument.
-                    if(runtime::get_number_of_args_needed(current_instruction.op) > 0)
-                    {
-                        instruction_element = IE_FARG;
-                        expected_token_type = runtime::get_expected_argument_type(current_instruction.op, 1);
-                    }
-                    else // We have a full instruction.
-                    {
-                        instruction_complete = true;
-                        expected_token_type = data::ET_OPCODE;
-                    }
-
-                    break;
-                case IE_FARG:
-                    current_instruction.f_arg = new data::token(tokens.at(i));
-
-                    // Depending of the opcode we need (or don't need) another argument.
-                    if(runtime::get_number_of_args_needed(current_instruction.op) > 1)
-                    {
-                        instruction_element = IE_COMA;
-                        expected_token_type = data::ET_COMA;
-                    }
-                    else // We have a full instruction.
-                    {
-                        instruction_complete = true;
-                        expected_token_type = data::ET_OPCODE;
-                    }
-                    break;
-                case IE_COMA:
-                    // After the first argument, we have the coma. Then we have the second argument.
-                    instruction_element = IE_SARG;
-                    expected_token_type = runtime::get_expected_argument_type(current_instruction.op, 2);
-                    break;
-                case IE_SARG:
-                    current_instruction.s_arg = new data::token(tokens.at(i));
-
-                    // We have a full instruction.
-                    instruction_complete = true;
-                    expected_token_type = data::ET_OPCODE;
-                    break;
-                default:
-                    std::cout << "Unknown parser error. Sorry." << std::endl;
-                    exit(2);
-                    break;
+                std::cerr << "[ERROR] " << launch.single_run << " can not be used with -batch or -inputs." << std::endl;
+                return smallthink::ST_INVALID_INPUT;
             }
-        }
 
-        // We check if the instrucion is complete.
-        if(instruction_complete)
-        {
-            // We push the instruction and reset it.
-            instructions.push_back(current_instruction);
-            instruction_complete = false; // Reset the instruction complete flag.
-            instruction_element = IE_OPCODE; // Reset the next element flag.
-            current_instruction = {runtime::NONE, 0, 0}; // This is a null instruction.
+            return run_batch(filename, launch);
         }
-    }
-
-    return instructions;
-}
-
-/* Very basic runtime. */
-int run(std::vector<runtime::instruction> instructions)
-{
-    /*
-        cip : current instruction pointer
-            -> index of the current instruction in the instructions vector.
-    */
-    std::map<std::string, unsigned int> labels; // The map of the labels.
-
-    /* Remember the position of each label. */
-    for(unsigned int cip(0) ; cip < instructions.size() ; ++cip)
-    {
-        if(instructions.at(cip).op == runtime::LABEL)
-            labels[instructions.at(cip).f_arg->value] = cip;
-    }
-
-    // For rand().
-    srand(time(NULL));
-
-    // Prepare memory.
-    std::map<std::string, runtime::dynamic_variable> memory;
-    memory["cmp_register"] = runtime::dynamic_variable{runtime::DVT_NUMERIC, "0"};
-    memory["random_max"] = runtime::dynamic_variable{runtime::DVT_NUMERIC, string_utils::from<int>(10000)};
-    memory["random_int"] = runtime::dynamic_variable{runtime::DVT_NUMERIC, string_utils::from<int>(rand() % 1000)};
-    memory["random_num"] = runtime::dynamic_variable{runtime::DVT_NUMERIC, string_utils::from<double>(rand() % 10000)};
 
+        /* Launch the interpreter. */
+        smallthink::statistics stats;
+        int result = load_from_file(filename, stats, launch);
 
-    // Let's go ! \o/
-    for(unsigned int cip(0) ; cip < instructions.size() ; ++cip)
-    {
-        switch(instructions.at(cip).op)
+        if(launch.stats_to == "-")
         {
-            case runtime::MOV:
-                // We need a new local context to prevent compiler errors about new_variable.
-                {
-                    // We create a new variable.
-                    runtime::dynamic_variable new_variable;
-
-                    // We detect the variable type.
-                    if(instructions.at(cip).s_arg->type == data::TT_NUMERIC)
-                    {
-                        new_variable.type = runtime::DVT_NUMERIC;
-                        new_variable.value = instructions.at(cip).s_arg->value;
-                    }
-                    else if(instructions.at(cip).s_arg->type == data::TT_STRING)
-                    {
-                        new_variable.type = runtime::DVT_STRING;
-                        new_variable.value = instructions.at(cip).s_arg->value;
-                    }
-                    else if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            new_variable = memory.at(instructions.at(cip).s_arg->value);
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[MOV-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).s_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-
-                    // We add it to the memory (or overwrite the old one with the same name).
-                    memory[instructions.at(cip).f_arg->value] = new_variable;
-                }
-                break;
-            case runtime::ADD:
-                {
-                    // Add a variable and a value or two variable.
-                    // First arg must be a variable (used to store the result).
-
-                    // We check if the second arg is a variable. If yes we use its value.
-                    if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            /**
-                                4 cases :
-                                    str + str   -> normal
-                                    num + num   -> normal
-                                    str + num   -> num converted to str
-                                    num + str   -> num converted to str
-                            **/
-                            runtime::dynamic_variable first_variable(memory.at(instructions.at(cip).f_arg->value)), second_variable(memory.at(instructions.at(cip).s_arg->value));
-
-                            if(first_variable.type == runtime::DVT_STRING) // No conversions needed.
-                            {
-                                first_variable.value += second_variable.value;
-                            }
-                            else
-                            {
-                                // num + num
-                                if(second_variable.type == runtime::DVT_NUMERIC)
-                                {
-                                    // We convert to double to add, then convert it back to std::string.
-                                    first_variable.value = string_utils::from<double>(string_utils::to<double>(first_variable.value) + string_utils::to<double>(second_variable.value));
-                                }
-                                // num + str
-                                else
-                                {
-                                    // We need to change the type.
-                                    first_variable.type = runtime::DVT_STRING;
-                                    first_variable.value = first_variable.value + second_variable.value;
-                                }
-                            }
-
-                            // Finally we store the result in the first variable.
-                            memory.at(instructions.at(cip).f_arg->value) = first_variable;
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[ADD-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else
-                    {
-                        try
-                        {
-                            runtime::dynamic_variable first_variable(memory.at(instructions.at(cip).f_arg->value));
-                            runtime::dynamic_variable second_variable;
-
-                            if(instructions.at(cip).s_arg->type == data::TT_NUMERIC)
-                                second_variable = {runtime::DVT_NUMERIC, instructions.at(cip).s_arg->value};
-                            else
-                                second_variable = {runtime::DVT_STRING, instructions.at(cip).s_arg->value};
-
-                            // str + str
-                            // str + num
-                            if(first_variable.type == runtime::DVT_STRING) // No conversions needed.
-                            {
-                                first_variable.value += second_variable.value;
-                            }
-                            else
-                            {
-                                // num + num
-                                if(second_variable.type == runtime::DVT_NUMERIC)
-                                {
-                                    // We convert to double to add, then convert it back to std::string.
-                                    first_variable.value = string_utils::from<double>(string_utils::to<double>(first_variable.value) + string_utils::to<double>(second_variable.value));
-                                }
-                                // num + str
-                                else
-                                {
-                                    // We need to change the type.
-                                    first_variable.type = runtime::DVT_STRING;
-                                    first_variable.value = first_variable.value + second_variable.value;
-                                }
-                            }
-
-                            // Finally we store the result in the first variable.
-                            memory.at(instructions.at(cip).f_arg->value) = first_variable;
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[ADD-VAR-VAL][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                break;
-            case runtime::MUL:
-                {
-                    // Mul a variable and a value or two variable.
-                    // First arg must be a variable (used to store the result).
-
-                    // We check if the second arg is a variable. If yes we use its value.
-                    if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            /**
-                                2 cases :
-                                    num * num   -> normal
-                                    str * num   -> str repeated num times.
-                            **/
-                            runtime::dynamic_variable first_variable(memory.at(instructions.at(cip).f_arg->value)), second_variable(memory.at(instructions.at(cip).s_arg->value));
-
-                            // num * num
-                            if(first_variable.type == runtime::DVT_NUMERIC) // No conversions needed.
-                            {
-                                first_variable.value =  string_utils::from<double>(string_utils::to<double>(first_variable.value) * string_utils::to<double>(second_variable.value));
-                            }
-                            // str * num
-                            else
-                            {
-                                unsigned int times = string_utils::to<unsigned int>(second_variable.value);
-
-                                for(unsigned int i(0) ; i < times ; ++i)
-                                    first_variable.value += first_variable.value;
-                            }
-
-                            // Finally we store the result in the first variable.
-                            memory.at(instructions.at(cip).f_arg->value) = first_variable;
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[MUL-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else
-                    {
-                        try
-                        {
-                            /**
-                                2 cases :
-                                    num * num   -> normal
-                                    str * num   -> str repeated num times.
-                            **/
-                            runtime::dynamic_variable first_variable(memory.at(instructions.at(cip).f_arg->value));
-                            runtime::dynamic_variable second_variable = {runtime::DVT_NUMERIC, instructions.at(cip).s_arg->value};
-
-                            // num * num
-                            if(first_variable.type == runtime::DVT_NUMERIC) // No conversions needed.
-                            {
-                                first_variable.value =  string_utils::from<double>(string_utils::to<double>(first_variable.value) * string_utils::to<double>(second_variable.value));
-                            }
-                            // str * num
-                            else
-                            {
-                                unsigned int times = string_utils::to<unsigned int>(second_variable.value);
-
-                                for(unsigned int i(0) ; i < times ; ++i)
-                                    first_variable.value += first_variable.value;
-                            }
-
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[MUL-VAR-VAL][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                break;
-            case runtime::CMP_EQ:
-                {
-                    // Compare a variable and a value or two variable.
-                    // Check if equals.
-                    // THE TYPE IS NOT USED IN COMPARISONS.
-                    // First arg must be a variable.
-                    // Result is stored into special variable "cmp_register".
-
-                    // We check if the second arg is a variable. If yes we use its value.
-                    if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value == memory.at(instructions.at(cip).s_arg->value).value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_EQ-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else // If the second argument is not a variable.
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value == instructions.at(cip).s_arg->value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_EQ-VAR-VAL][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                break;
-            case runtime::CMP_GT:
-                {
-                    // Compare a variable and a value or two variable.
-                    // Check if first > second.
-                    // THE TYPE IS NOT USED IN COMPARISONS.
-                    // First arg must be a variable.
-                    // Result is stored into special variable "cmp_register".
-
-                    // We check if the second arg is a variable. If yes we use its value.
-                    if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value > memory.at(instructions.at(cip).s_arg->value).value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_GT-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else // If the second argument is not a variable.
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value > instructions.at(cip).s_arg->value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_GT-VAR-VAL][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                break;
-            case runtime::CMP_LT:
-                {
-                    // Compare a variable and a value or two variable.
-                    // Check if first < second.
-                    // THE TYPE IS NOT USED IN COMPARISONS.
-                    // First arg must be a variable.
-                    // Result is stored into special variable "cmp_register".
-
-                    // We check if the second arg is a variable. If yes we use its value.
-                    if(instructions.at(cip).s_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value < memory.at(instructions.at(cip).s_arg->value).value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_LT-VAR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else // If the second argument is not a variable.
-                    {
-                        try
-                        {
-                            if(memory.at(instructions.at(cip).f_arg->value).value < instructions.at(cip).s_arg->value)
-                                memory.at("cmp_register").value = "1";
-                            else
-                                memory.at("cmp_register").value = "0";
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[CMP_LT-VAR-VAL][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                break;
-            case runtime::NEG:
-                {
-                    // Negate a variable.
-                    if(instructions.at(cip).f_arg->type == data::TT_IDENTIFIER)
-                    {
-                        try
-                        {
-                            // Try to negate the variable.
-                            std::string value = memory.at(instructions.at(cip).f_arg->value).value;
-
-                            double converted_value = string_utils::to<double>(value);
-                            converted_value *= (-1);
-                            value = string_utils::from<double>(converted_value);
-
-                            memory.at(instructions.at(cip).f_arg->value).value = value;
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[NEG-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                    else
-                    {
-                        // We are lazy, if not a variable, we do not do anything.
-                        // Remember that this is not an error. You are allowed to negate a numeric value.
-                    }
-                }
-                break;
-            case runtime::OUT:
-                // Prints the given argument.
-                // If argument is a variable we have to print it.
-                if(instructions.at(cip).f_arg->type == data::TT_IDENTIFIER)
-                {
-                    // We test for special identifier endline, wich correspond to std::endl;
-                    if(instructions.at(cip).f_arg->value == "endline")
-                    {
-                        std::cout << std::endl;
-                    }
-                    else
-                    {
-                        try
-                        {
-                            // Try to print the variable.
-                            std::cout << memory.at(instructions.at(cip).f_arg->value).value;
-                        }
-                        catch(const std::out_of_range& e)
-                        {
-                            // Error.
-                            std::cerr << std::endl << "[OUT-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                            return 3;
-                        }
-                    }
-                }
-                else
-                {
-                    // Else we just print the value.
-                    std::cout << instructions.at(cip).f_arg->value;
-                }
-                break;
-            case runtime::IN:
-                // Gets input from user (one word).
-                try
-                {
-                    // Try to get input in the variable.
-                    memory.at(instructions.at(cip).f_arg->value).type = runtime::DVT_STRING;
-                    std::cin >> memory.at(instructions.at(cip).f_arg->value).value;
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[IN-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::GET:
-                // Gets input from user (one character).
-                // We test for special identifier endline, wich correspond to std::endl;
-                try
-                {
-                    // Try to get input in the variable.
-                    memory.at(instructions.at(cip).f_arg->value).type = runtime::DVT_STRING;
-
-                    // Gets only one char.
-                    char input = std::cin.get();
-
-                    // Store input in variable.
-                    memory.at(instructions.at(cip).f_arg->value).value = "" + input; // Add char* and char to get a std::string...
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[IN-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::FLUSH:
-                std::cin.clear();
-                std::cin.ignore(INT_MAX, '\n');
-                break;
-            case runtime::STOP:
-                // Stop the runtime.
-                return 0;
-                break;
-            case runtime::LABEL:
-                // Nothing to do.
-                break;
-            case runtime::JMP:
-                try
-                {
-                    // Jump to the indicated label.
-                    cip = labels[instructions.at(cip).f_arg->value];
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[JMP-LABEL][ERROR] Unknown label : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::JNZ:
-                try
-                {
-                    // Jump to the indicated label if special variable "cmp_register" is different than 0.
-                    if(string_utils::to<int>(memory.at("cmp_register").value) != 0)
-                        cip = labels[instructions.at(cip).f_arg->value];
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[JNZ-LABEL][ERROR] Unknown label : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::JZ:
-                try
-                {
-                    // Jump to the indicated label if special variable "cmp_register" equals 0.
-                    if(string_utils::to<int>(memory.at("cmp_register").value) == 0)
-                        cip = labels[instructions.at(cip).f_arg->value];
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[JZ-LABEL][ERROR] Unknown label : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::NUM:
-                try
-                {
-                    // Try to convert variable.
-                    memory.at(instructions.at(cip).f_arg->value).type = runtime::DVT_NUMERIC;
-
-                    // Now we convert to double and convert it back to string to have a valid numeric variable.
-                    memory.at(instructions.at(cip).f_arg->value).value = string_utils::from<double>(string_utils::to<double>(memory.at(instructions.at(cip).f_arg->value).value));
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[NUM-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::STR:
-                try
-                {
-                    // Try to convert variable.
-                    memory.at(instructions.at(cip).f_arg->value).type = runtime::DVT_STRING;
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[STR-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::NUM_INT:
-                try
-                {
-                    // Try to convert variable.
-                    memory.at(instructions.at(cip).f_arg->value).type = runtime::DVT_NUMERIC;
-
-                    // Now we convert to double and convert it back to string to have a valid numeric variable.
-                    memory.at(instructions.at(cip).f_arg->value).value = string_utils::from<int>(string_utils::to<int>(memory.at(instructions.at(cip).f_arg->value).value));
-                }
-                catch(const std::out_of_range& e)
-                {
-                    // Error.
-                    std::cerr << std::endl << "[NUM_INT-VAR][ERROR] Unknown variable : " << instructions.at(cip).f_arg->value << std::endl;
-                    return 3;
-                }
-                break;
-            case runtime::SEED_RANDOM:
-                {
-                    int random_max = string_utils::to<int>(memory.at("random_max").value);
-
-                    memory.at("random_int").value = string_utils::from<int>(rand() % random_max);
-                    memory.at("random_num").value = string_utils::from<double>(rand() % random_max);
-                }
-                break;
-            default:
-                break;
+            stats.write(std::cerr, filename, result);
         }
-    }
-
-    return 0;
-}
-
-/* Coordinate lexer, parser and runtime. */
-int load_from_file(std::string filename, bool time_measurement = false)
-{
-    std::ifstream inputfile(filename.c_str());
-    std::vector<runtime::instruction> instructions = parse(lex(inputfile));
-
+        else if(launch.stats_to != "")
+        {
+            std::ofstream stats_file(launch.stats_to.c_str());
 
-    if(time_measurement)
-    {
-        clock_t start_time = clock();
-        int result = run(instructions);
-        clock_t end_time = clock();
+            if(!stats_file)
+            {
+                std::cerr << "[ERROR] Can not write file : " << launch.stats_to << std::endl;
+                return 1;
+            }
 
-        std::cout << "----------------------------------" << std::endl;
-        std::cout << "[TIME] " << (end_time - start_time) << " clicks (" << (float)(end_time - start_time)/CLOCKS_PER_SEC << " seconds.)" << std::endl;
+            stats.write(stats_file, filename, result);
+        }
 
         return result;
     }
 
-    return run(instructions);
-}
-
-/* Main function. */
-int main(int argc, char* argv[])
-{
-    /* Arguments check. */
-    if(argc > 1 && argv[1])
-    {
-        if(argc > 2 && std::string(argv[2]) == std::string("-time"))
-            /* Launch the interpreter with time measurement. */
-            return load_from_file(std::string(argv[1]), true);
-
-        /* Launch the interpreter. */
-        return load_from_file(std::string(argv[1]));
-    }
-
     /* Ask for filename (only read from files is supported for the moment). */
     std::string filename("");
 
@@ -1288,7 +482,8 @@ int main(int argc, char* argv[])
     std::getline(std::cin, filename);
 
     /* Launch the interpreter. */
-    return load_from_file(filename);
+    smallthink::statistics stats;
+    return load_from_file(filename, stats);
 
 	return 0;
 }
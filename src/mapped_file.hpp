@@ -0,0 +1,144 @@
+/*
+	mapped_file.hpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	mapped_file is a class which gives a read-only view of a whole file.
+	The file is mapped in memory with mmap() where available, else it is read into a buffer.
+*/
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class mapped_file
+{
+	public:
+		mapped_file() : m_data(nullptr), m_size(0), m_mapped(false)
+		{
+		}
+
+		~mapped_file()
+		{
+			close();
+		}
+
+		// Maps the given file. Returns false if it can not be opened.
+		bool open(const std::string& filename)
+		{
+			close();
+
+#ifndef _WIN32
+			int descriptor = ::open(filename.c_str(), O_RDONLY);
+
+			if(descriptor < 0)
+				return false;
+
+			struct stat status;
+
+			if(fstat(descriptor, &status) != 0)
+			{
+				::close(descriptor);
+				return false;
+			}
+
+			m_size = static_cast<std::size_t>(status.st_size);
+
+			// mmap() refuses empty mappings, an empty file is just an empty view.
+			if(m_size > 0)
+			{
+				void* address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+				if(address != MAP_FAILED)
+				{
+					m_data = static_cast<const char*>(address);
+					m_mapped = true;
+				}
+			}
+
+			::close(descriptor);
+
+			if(m_mapped || m_size == 0)
+				return true;
+#endif
+
+			// Fallback : we read the whole file.
+			std::ifstream file(filename.c_str(), std::ios::binary);
+
+			if(!file)
+				return false;
+
+			m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+
+			return true;
+		}
+
+		// Unmaps the file.
+		void close()
+		{
+#ifndef _WIN32
+			if(m_mapped)
+				munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+			m_buffer.clear();
+			m_data = nullptr;
+			m_size = 0;
+			m_mapped = false;
+		}
+
+		const char* data() const
+		{
+			return m_data;
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+	private:
+		// Not copyable, the mapping is owned.
+		mapped_file(const mapped_file&);
+		mapped_file& operator=(const mapped_file&);
+
+		const char* m_data;
+		std::size_t m_size;
+		bool m_mapped;
+		std::vector<char> m_buffer;
+};
+
+#endif // MAPPED_FILE_HPP
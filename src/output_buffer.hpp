@@ -0,0 +1,255 @@
+/*
+	output_buffer.hpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	output_buffer is a class which buffers the standard output in user space and writes it with few system calls.
+	It is also a std::streambuf, so it can be put under std::cout : everything written there goes through the same buffer.
+	The buffer can be written to a sink instead of the standard output, a string for instance.
+*/
+
+#ifndef OUTPUT_BUFFER_HPP
+#define OUTPUT_BUFFER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <streambuf>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+class output_buffer : public std::streambuf
+{
+	public:
+		// When the buffer is written, prefixed by FP_ (FLUSH POLICY_).
+		enum flush_policy
+		{
+			FP_EXIT, // At exit, or when asked. The buffer grows as needed.
+			FP_FULL, // When the buffer is full.
+			FP_LINE  // When the buffer is full, and at each newline if the output is a terminal.
+		};
+
+		// Size of the buffer, it is allocated once.
+		static const std::size_t capacity = 64 * 1024;
+
+		// Longer strings are not copied : they are written along with the buffer, in one writev().
+		static const std::size_t direct_size = 4096;
+
+		// Where the buffer is written instead of the standard output.
+		class sink
+		{
+			public:
+				virtual ~sink()
+				{
+				}
+
+				// Writes all the characters. Returns false if they can not be written.
+				virtual bool write(const char* data, std::size_t size) = 0;
+		};
+
+		// Without a sink, the buffer is written to the standard output. The sink is not owned.
+		explicit output_buffer(flush_policy policy = FP_LINE, sink* destination = nullptr) : m_buffer(capacity), m_used(0), m_policy(policy), m_terminal(false), m_failed(false), m_sink(destination)
+		{
+#ifndef _WIN32
+			m_terminal = m_sink == nullptr && isatty(STDOUT_FILENO) != 0;
+#endif
+		}
+
+		~output_buffer()
+		{
+			flush();
+		}
+
+		// Returns true if each line is written as soon as it ends : the input should then flush the output before reading.
+		bool line_buffered() const
+		{
+			return m_policy == FP_LINE && m_terminal;
+		}
+
+		// Appends the characters to the buffer.
+		void write(const char* data, std::size_t size)
+		{
+			if(size >= direct_size && m_policy != FP_EXIT)
+			{
+				write_with_buffer(data, size);
+			}
+			else
+			{
+				if(m_used + size > m_buffer.size())
+				{
+					if(m_policy == FP_EXIT)
+						m_buffer.resize(std::max(m_buffer.size() * 2, m_used + size));
+					else
+						flush();
+				}
+
+				memcpy(m_buffer.data() + m_used, data, size);
+				m_used += size;
+			}
+
+			if(line_buffered() && memchr(data, '\n', size) != nullptr)
+				flush();
+		}
+
+		// Appends a newline, which also ends the line for a terminal.
+		void newline()
+		{
+			if(m_used == m_buffer.size())
+			{
+				if(m_policy == FP_EXIT)
+					m_buffer.resize(m_buffer.size() * 2);
+				else
+					flush();
+			}
+
+			m_buffer[m_used++] = '\n';
+
+			if(line_buffered())
+				flush();
+		}
+
+		// Writes the buffer. Returns false if the output is closed or broken, the characters are then lost.
+		bool flush()
+		{
+			if(m_used > 0)
+				write_all(m_buffer.data(), m_used, nullptr, 0);
+
+			m_used = 0;
+			return !m_failed;
+		}
+
+	protected:
+		virtual int_type overflow(int_type c)
+		{
+			if(c != traits_type::eof())
+			{
+				char character = traits_type::to_char_type(c);
+				write(&character, 1);
+			}
+
+			return traits_type::not_eof(c);
+		}
+
+		virtual std::streamsize xsputn(const char* data, std::streamsize size)
+		{
+			write(data, static_cast<std::size_t>(size));
+			return size;
+		}
+
+		virtual int sync()
+		{
+			return flush() ? 0 : -1;
+		}
+
+	private:
+		// Not copyable, the buffer is owned.
+		output_buffer(const output_buffer&);
+		output_buffer& operator=(const output_buffer&);
+
+		// Writes the buffer then the given characters, in one system call when possible.
+		void write_with_buffer(const char* data, std::size_t size)
+		{
+			write_all(m_buffer.data(), m_used, data, size);
+			m_used = 0;
+		}
+
+		// Writes two blocks of characters, until they are written or the output fails.
+		void write_all(const char* first, std::size_t first_size, const char* second, std::size_t second_size)
+		{
+			if(m_failed)
+				return;
+
+			if(m_sink != nullptr)
+			{
+				if(!m_sink->write(first, first_size) || !m_sink->write(second, second_size))
+					m_failed = true;
+
+				return;
+			}
+
+#ifndef _WIN32
+			struct iovec blocks[2];
+			blocks[0].iov_base = const_cast<char*>(first);
+			blocks[0].iov_len = first_size;
+			blocks[1].iov_base = const_cast<char*>(second);
+			blocks[1].iov_len = second_size;
+
+			struct iovec* remaining = blocks;
+			int count = second_size > 0 ? 2 : 1;
+
+			// We skip an empty first block, the pointer of an empty vector may be anything.
+			if(first_size == 0)
+			{
+				++remaining;
+				--count;
+			}
+
+			while(count > 0)
+			{
+				ssize_t written = writev(STDOUT_FILENO, remaining, count);
+
+				if(written < 0)
+				{
+					if(errno == EINTR)
+						continue;
+
+					m_failed = true;
+					return;
+				}
+
+				std::size_t done = static_cast<std::size_t>(written);
+
+				// Partial write : we skip what was written and try again with the rest.
+				while(count > 0 && done >= remaining->iov_len)
+				{
+					done -= remaining->iov_len;
+					++remaining;
+					--count;
+				}
+
+				if(count > 0)
+				{
+					remaining->iov_base = static_cast<char*>(remaining->iov_base) + done;
+					remaining->iov_len -= done;
+				}
+			}
+#else
+			if(fwrite(first, 1, first_size, stdout) != first_size || fwrite(second, 1, second_size, stdout) != second_size || fflush(stdout) != 0)
+				m_failed = true;
+#endif
+		}
+
+		std::vector<char> m_buffer;
+		std::size_t m_used;
+		flush_policy m_policy;
+		bool m_terminal;
+		bool m_failed;
+		sink* m_sink;
+};
+
+#endif // OUTPUT_BUFFER_HPP
@@ -0,0 +1,8895 @@
+/*
+	smallthink.cpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	This is the interpreter for SmallThink, a toy-programming-exotic-language, built as a library : see smallthink.hpp for its interface.
+	Look at doc/tutorial.rst for a better description of SmallThink.
+*/
+
+// Because we manipulate strings a lot.
+#include <string>
+
+// For std::cout, std::cin and std::ofstream.
+#include <iostream>
+#include <fstream>
+
+// To discard the errors of an invalid cache entry.
+#include <sstream>
+
+// For runtime, used to manipulates variables by their names.
+#include <map>
+#include <vector>
+#include <utility>
+
+// For the optimizer : std::find(), std::sort() and std::fill().
+#include <algorithm>
+
+// For the clock of the profiler and of the phases measured by -stats.
+#include <chrono>
+
+// For the native representation of numeric values.
+#include <cstdint>
+#include <limits>
+
+// For std::isnan() on the elements of arrays.
+#include <cmath>
+
+// For std::bad_alloc, caught when a run runs out of memory.
+#include <new>
+
+// For INT_MAX and UINT_MAX.
+#include <climits>
+#include <cstdlib>
+
+// To seed each virtual machine differently.
+#include <atomic>
+
+// For strtod() and strtoll() error reporting.
+#include <cerrno>
+
+// For memcpy() and memcmp() on bytecode.
+#include <cstring>
+
+// For trim and conversions functions : to and from.
+#include "string_utils.hpp"
+
+// To read source and bytecode files.
+#include "mapped_file.hpp"
+
+// To buffer the input and the output of the programs.
+#include "input_buffer.hpp"
+#include "output_buffer.hpp"
+
+// The interface of the library.
+#include "smallthink.hpp"
+
+// The threaded dispatch engine needs the "labels as values" extension of GCC and Clang.
+#if defined(__GNUC__)
+#define SMALLTHINK_THREADED_CODE
+#endif
+
+// The steps of a trace are run in its own loop, without a call for each of them.
+#if defined(__GNUC__)
+#define SMALLTHINK_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define SMALLTHINK_ALWAYS_INLINE inline
+#endif
+
+// The profiler reads the time stamp counter of x86 processors.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SMALLTHINK_RDTSC
+#include <x86intrin.h>
+#endif
+
+// The array kernels use SSE2 on x86-64, and AVX2 when the processor has it.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SMALLTHINK_SIMD
+#include <immintrin.h>
+#endif
+
+// The JIT emits x86-64 code for the System V calling convention, in memory given by mmap().
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__unix__)
+#define SMALLTHINK_JIT
+#include <sys/mman.h>
+#endif
+
+// -stats reads the peak resident memory with getrusage().
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// The compile cache creates its directory and names its temporary files after the process.
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Some useful data structures and enums. */
+namespace data
+{
+    /*
+        Characters of a token, viewed where the lexer read them (usually the mapped source file) : they are never copied one by one.
+        The view is only valid while the source is.
+    */
+    struct text_view
+    {
+        const char* data;
+        std::size_t size;
+
+        std::string str() const
+        {
+            return std::string(data, size);
+        }
+
+        bool operator==(const char* other) const
+        {
+            return strlen(other) == size && memcmp(data, other, size) == 0;
+        }
+    };
+
+    std::ostream& operator<<(std::ostream& stream, const text_view& text)
+    {
+        return stream.write(text.data, static_cast<std::streamsize>(text.size));
+    }
+
+    /* Returns true if given text is the name of an opcode, whatever its case. Defined with the opcode table. */
+    bool is_opcode(const text_view& x);
+
+    /* Returns true if given text is a decimal number. */
+    bool is_number(const text_view& x)
+    {
+        // Empty strings are not numbers.
+        if(x.size > 0)
+        {
+            unsigned int offset(0); // No offset.
+
+            // If starts by a '-'.
+            if(x.data[0] == '-')
+                offset = 1;
+
+            for(std::size_t i(offset) ; i < x.size ; ++i)
+                if(!isdigit(static_cast<unsigned char>(x.data[i])) && x.data[i] != '.')
+                {
+                    return false;
+                }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /* Tokens types, prefixed by TT_ (TOKEN TYPE_). */
+    enum token_type
+    {
+        TT_COMA,
+        TT_STRING,
+        TT_IDENTIFIER,
+        TT_NUMERIC
+    };
+
+    /* Represents a token. For easier manipulation. */
+    struct token
+    {
+        token_type type;
+        text_view value;
+        unsigned int line; // Line of the source, from 1.
+
+        // Binary form of a numeric token, filled once by the lexer (see parse_numeric).
+        bool is_integer;
+        std::int64_t integer;
+        double number;
+    };
+
+    /*
+        Pre-parses the value of a numeric token into its binary form.
+        A number without a dot which fits in 64 bits is an integer, anything else is a floating number.
+    */
+    void parse_numeric(token& g_token)
+    {
+        g_token.is_integer = false;
+        g_token.integer = 0;
+        g_token.number = 0.0;
+
+        if(g_token.type != TT_NUMERIC)
+            return;
+
+        // The value is not null terminated : numbers are short, they are copied on the stack for strtoll() and strtod().
+        char digits[64];
+        std::string long_digits;
+        const char* begin = digits;
+        char* end = nullptr;
+
+        if(g_token.value.size < sizeof(digits))
+        {
+            memcpy(digits, g_token.value.data, g_token.value.size);
+            digits[g_token.value.size] = '\0';
+        }
+        else
+        {
+            long_digits = g_token.value.str();
+            begin = long_digits.c_str();
+        }
+
+        if(memchr(g_token.value.data, '.', g_token.value.size) == nullptr)
+        {
+            errno = 0;
+            long long integer = strtoll(begin, &end, 10);
+
+            if(errno != ERANGE)
+            {
+                g_token.is_integer = true;
+                g_token.integer = integer;
+                g_token.number = static_cast<double>(integer);
+                return;
+            }
+        }
+
+        g_token.number = strtod(begin, &end);
+    }
+
+    /*
+        Used by parser to know wich token is expected depending of the actual instruction.
+        Prefixed by ET_ (EXPECTED TOKEN_).
+    */
+    enum expected_token
+    {
+        ET_OPCODE,
+        ET_COMA,
+        ET_IDENTIFIER,
+        ET_IDENTIFIER_OR_NUMERIC,
+        ET_IDENTIFIER_OR_NUMERIC_OR_STRING
+    };
+
+    /* Used by parser to know if a token type match an expectation. */
+    bool match_expectation(expected_token e_type, const token& g_token)
+    {
+        token_type t_type = g_token.type;
+
+        switch(e_type)
+        {
+            case ET_OPCODE:
+                return (t_type == TT_IDENTIFIER) && is_opcode(g_token.value);
+                break;
+            case ET_COMA:
+                return t_type == TT_COMA;
+                break;
+            case ET_IDENTIFIER:
+                return t_type == TT_IDENTIFIER;
+                break;
+            case ET_IDENTIFIER_OR_NUMERIC:
+                return (t_type == TT_IDENTIFIER) || (t_type == TT_NUMERIC);
+                break;
+            case ET_IDENTIFIER_OR_NUMERIC_OR_STRING:
+                return (t_type == TT_IDENTIFIER) || (t_type == TT_NUMERIC) || (t_type == TT_STRING);
+                break;
+            default:
+                return false;
+                break;
+        }
+    }
+
+    /* DEBUG ONLY. Return the string representation of the type of the token. */
+    std::string print_type(token g_token)
+    {
+        switch(g_token.type)
+        {
+            case data::TT_IDENTIFIER:
+                return "identifier";
+                break;
+            case data::TT_COMA:
+                return "coma";
+                break;
+            case data::TT_STRING:
+                return "string";
+                break;
+            case data::TT_NUMERIC:
+                return "numeric";
+                break;
+            default:
+                return "";
+                break;
+        }
+    }
+
+    /* DEBUG ONLY. Return the string representation of the expected type. */
+    std::string print_type(expected_token t_type)
+    {
+        switch(t_type)
+        {
+            case ET_OPCODE:
+                return "opcode";
+                break;
+            case ET_COMA:
+                return "coma";
+                break;
+            case ET_IDENTIFIER:
+                return "identifier";
+                break;
+            case ET_IDENTIFIER_OR_NUMERIC:
+                return "identifier_or_numeric";
+                break;
+            case ET_IDENTIFIER_OR_NUMERIC_OR_STRING:
+                return "identifier_or_numeric_or_string";
+                break;
+            default:
+                return "none:" + string_utils::from<expected_token>(t_type);
+                break;
+        }
+    }
+
+} // data namespace.
+
+/* Some useful runtime structures and enums. */
+namespace runtime
+{
+    /* Used to indicate the opcode of an instruction. Stored on one byte. */
+    enum opcode : std::uint8_t
+    {
+        MOV,
+        ADD,
+        MUL,
+        CMP_EQ,
+        CMP_GT,
+        CMP_LT,
+        NEG,
+        OUT,
+        IN,
+        GET,
+        STOP,
+        FLUSH,
+        LABEL,
+        JMP,
+        JNZ,
+        JZ,
+        NUM,
+        STR,
+        NUM_INT,
+        SEED_RANDOM,
+        FLUSH_OUT,
+        ARRAY_NEW,
+        ARRAY_RESIZE,
+        ARRAY_LEN,
+        ARRAY_GET,
+        ARRAY_SET,
+        ARRAY_SUM,
+        ARRAY_MIN,
+        ARRAY_MAX,
+        ARRAY_SCALE,
+        ARRAY_ADD,
+        ARRAY_DOT,
+        ARRAY_SORT,
+        MAP_NEW,
+        MAP_PUT,
+        MAP_GET,
+        MAP_HAS,
+        MAP_DEL,
+        MAP_LEN,
+        MAP_NEXT,
+
+        // Internal opcodes, produced by the resolution pass.
+        OUT_ENDLINE,
+
+        // Specialized opcodes, produced by the types pass : the types of the arguments are known, they are not checked. Never saved as bytecode.
+        ADD_NUMBER,
+        ADD_STRING,
+        MUL_NUMBER,
+        MUL_STRING,
+        CMP_EQ_NUMBER,
+        CMP_EQ_STRING,
+        CMP_GT_NUMBER,
+        CMP_GT_STRING,
+        CMP_LT_NUMBER,
+        CMP_LT_STRING,
+        JZ_FLAG,
+        JNZ_FLAG,
+
+        // Superinstructions, produced by the superinstructions pass. Never saved as bytecode.
+        CMP_EQ_JZ,
+        CMP_EQ_JNZ,
+        CMP_GT_JZ,
+        CMP_GT_JNZ,
+        CMP_LT_JZ,
+        CMP_LT_JNZ,
+        MOV_ADD,
+        ADD_CMP_EQ_JZ,
+        ADD_CMP_EQ_JNZ,
+
+        // Entry of a loop compiled by the JIT, its target is the index of the native code. Never saved as bytecode.
+        JIT_LOOP,
+
+        // Entry of a loop run by the tracing tier, its target is the index of the loop. Never saved as bytecode.
+        TRACE_LOOP,
+
+        NONE
+    };
+
+    /* Used to indicate what an argument of an instruction refers to, prefixed by AK_ (ARGUMENT KIND_). */
+    enum argument_kind : std::uint8_t
+    {
+        AK_NONE,
+        AK_VARIABLE,
+        AK_CONSTANT,
+        AK_TOKEN // Index of a token of the source, until the resolution pass.
+    };
+
+    /*
+        Represents an instruction, packed in 16 bytes with no pointer : four instructions by cache line.
+        Arguments are indices : of tokens in the lexer output after the parser, of register file slots after the resolution pass.
+    */
+    struct instruction
+    {
+        opcode op;
+
+        // What the arguments refer to, set by the parser then by the resolution pass.
+        argument_kind f_kind;
+        argument_kind s_kind;
+
+        // Token indices, then register file slots of the arguments.
+        unsigned int f_slot;
+        unsigned int s_slot;
+
+        // Index of the instruction to jump to, set by the label resolution pass.
+        unsigned int target;
+    };
+
+    /* Describes an opcode of the language : its name in the source, and the tokens its arguments are made of. */
+    struct opcode_entry
+    {
+        const char* name;
+        std::size_t size;
+        opcode op;
+        int arguments;
+        data::expected_token first;
+        data::expected_token second;
+    };
+
+    /*
+        Opcodes of the language, in the order of the opcode enum. The parser, the error messages and the dumps all read
+        the names and the arguments here.
+    */
+    constexpr opcode_entry opcode_entries[] =
+    {
+        {"mov", 3, MOV, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"add", 3, ADD, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"mul", 3, MUL, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"cmp_eq", 6, CMP_EQ, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"cmp_gt", 6, CMP_GT, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"cmp_lt", 6, CMP_LT, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"neg", 3, NEG, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"out", 3, OUT, 1, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING, data::ET_OPCODE},
+        {"in", 2, IN, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"get", 3, GET, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"stop", 4, STOP, 0, data::ET_OPCODE, data::ET_OPCODE},
+        {"flush", 5, FLUSH, 0, data::ET_OPCODE, data::ET_OPCODE},
+        {"label", 5, LABEL, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"jmp", 3, JMP, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"jnz", 3, JNZ, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"jz", 2, JZ, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"num", 3, NUM, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"str", 3, STR, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"num_int", 7, NUM_INT, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"seed_random", 11, SEED_RANDOM, 0, data::ET_OPCODE, data::ET_OPCODE},
+        {"flush_out", 9, FLUSH_OUT, 0, data::ET_OPCODE, data::ET_OPCODE},
+        {"array_new", 9, ARRAY_NEW, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC},
+        {"array_resize", 12, ARRAY_RESIZE, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC},
+        {"array_len", 9, ARRAY_LEN, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_get", 9, ARRAY_GET, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_set", 9, ARRAY_SET, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC},
+        {"array_sum", 9, ARRAY_SUM, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_min", 9, ARRAY_MIN, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_max", 9, ARRAY_MAX, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_scale", 11, ARRAY_SCALE, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC},
+        {"array_add", 9, ARRAY_ADD, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC},
+        {"array_dot", 9, ARRAY_DOT, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"array_sort", 10, ARRAY_SORT, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"map_new", 7, MAP_NEW, 1, data::ET_IDENTIFIER, data::ET_OPCODE},
+        {"map_put", 7, MAP_PUT, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"map_get", 7, MAP_GET, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"map_has", 7, MAP_HAS, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"map_del", 7, MAP_DEL, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER_OR_NUMERIC_OR_STRING},
+        {"map_len", 7, MAP_LEN, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER},
+        {"map_next", 8, MAP_NEXT, 2, data::ET_IDENTIFIER, data::ET_IDENTIFIER}
+    };
+
+    constexpr std::size_t opcode_entries_count = sizeof(opcode_entries) / sizeof(opcode_entries[0]);
+
+    /* Lowercases an ASCII character, without the locale. */
+    constexpr char lowercase(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /* Case-insensitive FNV-1a hash of a name, started from the seed of the perfect hash. */
+    constexpr std::uint32_t hash_opcode_name(const char* name, std::size_t size, std::uint32_t seed)
+    {
+        std::uint32_t hash = 2166136261u ^ seed;
+
+        for(std::size_t i(0) ; i < size ; ++i)
+        {
+            hash ^= static_cast<unsigned char>(lowercase(name[i]));
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    /*
+        Perfect hash of the opcode names : each name falls in its own slot, which holds the index of its entry.
+        The seed is searched by the compiler, the table is never built at run time.
+    */
+    struct opcode_hash_table
+    {
+        static constexpr std::size_t size = 256;
+        static constexpr std::uint8_t empty = 0xFF;
+
+        std::uint32_t seed;
+        std::uint8_t slots[size];
+    };
+
+    /* Fills the table for the given seed. Returns false if two names collide. */
+    constexpr bool fill_opcode_hash_table(opcode_hash_table& table, std::uint32_t seed)
+    {
+        table.seed = seed;
+
+        for(std::size_t i(0) ; i < opcode_hash_table::size ; ++i)
+            table.slots[i] = opcode_hash_table::empty;
+
+        for(std::size_t i(0) ; i < opcode_entries_count ; ++i)
+        {
+            std::size_t slot = hash_opcode_name(opcode_entries[i].name, opcode_entries[i].size, seed) % opcode_hash_table::size;
+
+            if(table.slots[slot] != opcode_hash_table::empty)
+                return false;
+
+            table.slots[slot] = static_cast<std::uint8_t>(i);
+        }
+
+        return true;
+    }
+
+    /* Tries the seeds until the names do not collide. */
+    constexpr opcode_hash_table make_opcode_hash_table()
+    {
+        opcode_hash_table table = {};
+
+        for(std::uint32_t seed(0) ; seed < 100000 ; ++seed)
+            if(fill_opcode_hash_table(table, seed))
+                return table;
+
+        table.seed = UINT32_MAX;
+        return table;
+    }
+
+    constexpr opcode_hash_table opcode_hash = make_opcode_hash_table();
+
+    /* Returns true if the entries are in the order of the opcode enum and their sizes are right. */
+    constexpr bool check_opcode_entries()
+    {
+        for(std::size_t i(0) ; i < opcode_entries_count ; ++i)
+        {
+            if(opcode_entries[i].op != i)
+                return false;
+
+            std::size_t size(0);
+
+            while(opcode_entries[i].name[size] != '\0')
+                ++size;
+
+            if(size != opcode_entries[i].size)
+                return false;
+        }
+
+        return true;
+    }
+
+    static_assert(check_opcode_entries(), "Opcode entries must follow the opcode enum.");
+    static_assert(opcode_entries_count == MAP_NEXT + 1, "Every opcode of the language needs an entry.");
+    static_assert(opcode_hash.seed != UINT32_MAX, "No perfect hash found for the opcode names.");
+
+    /* Return the opcode CODE depending of the opcode name, whatever its case, or NONE. */
+    opcode get_opcode(const char* name, std::size_t size)
+    {
+        std::uint8_t index = opcode_hash.slots[hash_opcode_name(name, size, opcode_hash.seed) % opcode_hash_table::size];
+
+        if(index == opcode_hash_table::empty || opcode_entries[index].size != size)
+            return NONE;
+
+        const char* expected = opcode_entries[index].name;
+
+        for(std::size_t i(0) ; i < size ; ++i)
+            if(lowercase(name[i]) != expected[i])
+                return NONE;
+
+        return opcode_entries[index].op;
+    }
+
+    opcode get_opcode(const data::text_view& x)
+    {
+        return get_opcode(x.data, x.size);
+    }
+
+    /* DEBUG ONLY. Returns the string representation of the opcode. */
+    std::string print_opcode(opcode op)
+    {
+        if(op < opcode_entries_count)
+            return opcode_entries[op].name;
+
+        // Internal opcodes have no entry : they can not be written in the source.
+        switch(op)
+        {
+            case OUT_ENDLINE:
+                return "out endline";
+                break;
+            case ADD_NUMBER:
+                return "add number";
+                break;
+            case ADD_STRING:
+                return "add string";
+                break;
+            case MUL_NUMBER:
+                return "mul number";
+                break;
+            case MUL_STRING:
+                return "mul string";
+                break;
+            case CMP_EQ_NUMBER:
+                return "cmp_eq number";
+                break;
+            case CMP_EQ_STRING:
+                return "cmp_eq string";
+                break;
+            case CMP_GT_NUMBER:
+                return "cmp_gt number";
+                break;
+            case CMP_GT_STRING:
+                return "cmp_gt string";
+                break;
+            case CMP_LT_NUMBER:
+                return "cmp_lt number";
+                break;
+            case CMP_LT_STRING:
+                return "cmp_lt string";
+                break;
+            case JZ_FLAG:
+                return "jz flag";
+                break;
+            case JNZ_FLAG:
+                return "jnz flag";
+                break;
+            case CMP_EQ_JZ:
+                return "cmp_eq+jz";
+                break;
+            case CMP_EQ_JNZ:
+                return "cmp_eq+jnz";
+                break;
+            case CMP_GT_JZ:
+                return "cmp_gt+jz";
+                break;
+            case CMP_GT_JNZ:
+                return "cmp_gt+jnz";
+                break;
+            case CMP_LT_JZ:
+                return "cmp_lt+jz";
+                break;
+            case CMP_LT_JNZ:
+                return "cmp_lt+jnz";
+                break;
+            case MOV_ADD:
+                return "mov+add";
+                break;
+            case ADD_CMP_EQ_JZ:
+                return "add+cmp_eq+jz";
+                break;
+            case ADD_CMP_EQ_JNZ:
+                return "add+cmp_eq+jnz";
+                break;
+            case JIT_LOOP:
+                return "jit loop";
+                break;
+            case TRACE_LOOP:
+                return "trace loop";
+                break;
+            case MOV:
+            case ADD:
+            case MUL:
+            case CMP_EQ:
+            case CMP_GT:
+            case CMP_LT:
+            case NEG:
+            case OUT:
+            case IN:
+            case GET:
+            case STOP:
+            case FLUSH:
+            case LABEL:
+            case JMP:
+            case JNZ:
+            case JZ:
+            case NUM:
+            case STR:
+            case NUM_INT:
+            case SEED_RANDOM:
+            case FLUSH_OUT:
+            case ARRAY_NEW:
+            case ARRAY_RESIZE:
+            case ARRAY_LEN:
+            case ARRAY_GET:
+            case ARRAY_SET:
+            case ARRAY_SUM:
+            case ARRAY_MIN:
+            case ARRAY_MAX:
+            case ARRAY_SCALE:
+            case ARRAY_ADD:
+            case ARRAY_DOT:
+            case ARRAY_SORT:
+            case MAP_NEW:
+            case MAP_PUT:
+            case MAP_GET:
+            case MAP_HAS:
+            case MAP_DEL:
+            case MAP_LEN:
+            case MAP_NEXT:
+            case NONE:
+            default:
+                return "";
+                break;
+        }
+    }
+
+    /* Returns the number of source instructions run by one instruction of the given opcode : more than one for the superinstructions. */
+    unsigned int fused_length(opcode op)
+    {
+        switch(op)
+        {
+            case CMP_EQ_JZ:
+            case CMP_EQ_JNZ:
+            case CMP_GT_JZ:
+            case CMP_GT_JNZ:
+            case CMP_LT_JZ:
+            case CMP_LT_JNZ:
+            case MOV_ADD:
+                return 2;
+            case ADD_CMP_EQ_JZ:
+            case ADD_CMP_EQ_JNZ:
+                return 3;
+            case MOV:
+            case ADD:
+            case MUL:
+            case CMP_EQ:
+            case CMP_GT:
+            case CMP_LT:
+            case NEG:
+            case OUT:
+            case IN:
+            case GET:
+            case STOP:
+            case FLUSH:
+            case LABEL:
+            case JMP:
+            case JNZ:
+            case JZ:
+            case NUM:
+            case STR:
+            case NUM_INT:
+            case SEED_RANDOM:
+            case FLUSH_OUT:
+            case ARRAY_NEW:
+            case ARRAY_RESIZE:
+            case ARRAY_LEN:
+            case ARRAY_GET:
+            case ARRAY_SET:
+            case ARRAY_SUM:
+            case ARRAY_MIN:
+            case ARRAY_MAX:
+            case ARRAY_SCALE:
+            case ARRAY_ADD:
+            case ARRAY_DOT:
+            case ARRAY_SORT:
+            case MAP_NEW:
+            case MAP_PUT:
+            case MAP_GET:
+            case MAP_HAS:
+            case MAP_DEL:
+            case MAP_LEN:
+            case MAP_NEXT:
+            case OUT_ENDLINE:
+            case ADD_NUMBER:
+            case ADD_STRING:
+            case MUL_NUMBER:
+            case MUL_STRING:
+            case CMP_EQ_NUMBER:
+            case CMP_EQ_STRING:
+            case CMP_GT_NUMBER:
+            case CMP_GT_STRING:
+            case CMP_LT_NUMBER:
+            case CMP_LT_STRING:
+            case JZ_FLAG:
+            case JNZ_FLAG:
+            case JIT_LOOP:
+            case TRACE_LOOP:
+            case NONE:
+            default:
+                return 1;
+        }
+    }
+
+    /* Returns the opcode a specialized opcode was made from, or the opcode itself. */
+    opcode generic_opcode(opcode op)
+    {
+        switch(op)
+        {
+            case ADD_NUMBER:
+            case ADD_STRING:
+                return ADD;
+            case MUL_NUMBER:
+            case MUL_STRING:
+                return MUL;
+            case CMP_EQ_NUMBER:
+            case CMP_EQ_STRING:
+                return CMP_EQ;
+            case CMP_GT_NUMBER:
+            case CMP_GT_STRING:
+                return CMP_GT;
+            case CMP_LT_NUMBER:
+            case CMP_LT_STRING:
+                return CMP_LT;
+            case JZ_FLAG:
+                return JZ;
+            case JNZ_FLAG:
+                return JNZ;
+            case MOV:
+            case ADD:
+            case MUL:
+            case CMP_EQ:
+            case CMP_GT:
+            case CMP_LT:
+            case NEG:
+            case OUT:
+            case IN:
+            case GET:
+            case STOP:
+            case FLUSH:
+            case LABEL:
+            case JMP:
+            case JNZ:
+            case JZ:
+            case NUM:
+            case STR:
+            case NUM_INT:
+            case SEED_RANDOM:
+            case FLUSH_OUT:
+            case ARRAY_NEW:
+            case ARRAY_RESIZE:
+            case ARRAY_LEN:
+            case ARRAY_GET:
+            case ARRAY_SET:
+            case ARRAY_SUM:
+            case ARRAY_MIN:
+            case ARRAY_MAX:
+            case ARRAY_SCALE:
+            case ARRAY_ADD:
+            case ARRAY_DOT:
+            case ARRAY_SORT:
+            case MAP_NEW:
+            case MAP_PUT:
+            case MAP_GET:
+            case MAP_HAS:
+            case MAP_DEL:
+            case MAP_LEN:
+            case MAP_NEXT:
+            case OUT_ENDLINE:
+            case CMP_EQ_JZ:
+            case CMP_EQ_JNZ:
+            case CMP_GT_JZ:
+            case CMP_GT_JNZ:
+            case CMP_LT_JZ:
+            case CMP_LT_JNZ:
+            case MOV_ADD:
+            case ADD_CMP_EQ_JZ:
+            case ADD_CMP_EQ_JNZ:
+            case JIT_LOOP:
+            case TRACE_LOOP:
+            case NONE:
+            default:
+                return op;
+        }
+    }
+
+    /* Return the number of arguments needed to complete an instruction (depending of the opcode). */
+    int get_number_of_args_needed(opcode g_opcode)
+    {
+        if(g_opcode < opcode_entries_count)
+            return opcode_entries[g_opcode].arguments;
+
+        return 0;
+    }
+
+    /* Returns the token type of the argument needed (depending of the opcode and the argument number). */
+    data::expected_token get_expected_argument_type(opcode op, int argument_number)
+    {
+        if(op >= opcode_entries_count || argument_number > opcode_entries[op].arguments)
+            return data::ET_OPCODE;
+
+        return argument_number == 1 ? opcode_entries[op].first : opcode_entries[op].second;
+    }
+
+    /* Represents a dynamic variable type. */
+    enum dynamic_variable_type
+    {
+        DVT_INTEGER,
+        DVT_NUMERIC,
+        DVT_STRING,
+        DVT_UNDEFINED, // Slot of a variable which has not been assigned yet.
+
+        // After DVT_UNDEFINED : the opcodes which read a number or a string reject them with the same check.
+        DVT_ARRAY, // Array of floating numbers, only read by the array opcodes, mov and out. The integer is its index in the arrays of the run.
+        DVT_MAP // Map from strings to variables, only read by the map opcodes and mov. The integer is its index in the maps of the run.
+    };
+
+    /*
+        Used by the runtime to represent a dynamically typed variable.
+        Numbers are kept in binary form, they are only formatted when they are printed or mixed with a string.
+    */
+    struct dynamic_variable
+    {
+        dynamic_variable_type type;
+
+        union
+        {
+            std::int64_t integer; // DVT_INTEGER.
+            double number; // DVT_NUMERIC.
+        };
+
+        std::string value; // DVT_STRING.
+    };
+
+    /* Builds an integer variable. */
+    dynamic_variable make_integer(std::int64_t integer)
+    {
+        dynamic_variable variable;
+        variable.type = DVT_INTEGER;
+        variable.integer = integer;
+
+        return variable;
+    }
+
+    /* Builds a floating numeric variable. */
+    dynamic_variable make_numeric(double number)
+    {
+        dynamic_variable variable;
+        variable.type = DVT_NUMERIC;
+        variable.number = number;
+
+        return variable;
+    }
+
+    /* Builds a string variable. */
+    dynamic_variable make_string(const std::string& value)
+    {
+        dynamic_variable variable;
+        variable.type = DVT_STRING;
+        variable.integer = 0;
+        variable.value = value;
+
+        return variable;
+    }
+
+    /* Builds the content of a slot which has not been assigned yet. */
+    dynamic_variable make_undefined()
+    {
+        dynamic_variable variable;
+        variable.type = DVT_UNDEFINED;
+        variable.integer = 0;
+
+        return variable;
+    }
+
+    /* Builds an array variable, referring to the array of the given index in the arrays of the run. */
+    dynamic_variable make_array(std::size_t index)
+    {
+        dynamic_variable variable;
+        variable.type = DVT_ARRAY;
+        variable.integer = static_cast<std::int64_t>(index);
+
+        return variable;
+    }
+
+    /* Builds a map variable, referring to the map of the given index in the maps of the run. */
+    dynamic_variable make_map(std::size_t index)
+    {
+        dynamic_variable variable;
+        variable.type = DVT_MAP;
+        variable.integer = static_cast<std::int64_t>(index);
+
+        return variable;
+    }
+
+    /* Builds a variable from a numeric or string token, using the value pre-parsed by the lexer. */
+    dynamic_variable make_variable(const data::token& g_token)
+    {
+        if(g_token.type == data::TT_NUMERIC)
+        {
+            if(g_token.is_integer)
+                return make_integer(g_token.integer);
+
+            return make_numeric(g_token.number);
+        }
+
+        return make_string(g_token.value.str());
+    }
+
+    /* Number of conversions between strings and numbers, read by the profiler. One per thread : virtual machines may run at once. */
+    thread_local std::uint64_t conversions(0);
+
+    /* Returns true if the variable holds a number (integer or floating). */
+    bool is_numeric(const dynamic_variable& variable)
+    {
+        return variable.type == DVT_INTEGER || variable.type == DVT_NUMERIC;
+    }
+
+    /* Returns the value of the variable as a floating number. Strings are parsed like std::stringstream would. */
+    double to_double(const dynamic_variable& variable)
+    {
+        switch(variable.type)
+        {
+            case DVT_INTEGER:
+                return static_cast<double>(variable.integer);
+            case DVT_NUMERIC:
+                return variable.number;
+            case DVT_STRING:
+                ++conversions;
+                return strtod(variable.value.c_str(), nullptr);
+            // Arrays and maps are never converted : the opcodes which read a number or a string reject them.
+            case DVT_ARRAY:
+            case DVT_MAP:
+            case DVT_UNDEFINED:
+            default:
+                return 0.0;
+        }
+    }
+
+    /* Returns the value of the variable as an integer. Floating numbers are truncated. */
+    std::int64_t to_integer(const dynamic_variable& variable)
+    {
+        switch(variable.type)
+        {
+            case DVT_INTEGER:
+                return variable.integer;
+            case DVT_NUMERIC:
+                // Out of range values would be undefined behaviour.
+                if(variable.number >= -9.2e18 && variable.number <= 9.2e18)
+                    return static_cast<std::int64_t>(variable.number);
+
+                return 0;
+            case DVT_STRING:
+                ++conversions;
+                return strtoll(variable.value.c_str(), nullptr, 10);
+            case DVT_ARRAY:
+            case DVT_MAP:
+            case DVT_UNDEFINED:
+            default:
+                return 0;
+        }
+    }
+
+    /* Returns the string representation of the variable. */
+    std::string to_string(const dynamic_variable& variable)
+    {
+        switch(variable.type)
+        {
+            case DVT_INTEGER:
+                ++conversions;
+                return string_utils::from<std::int64_t>(variable.integer);
+            case DVT_NUMERIC:
+                ++conversions;
+                return string_utils::from<double>(variable.number);
+            case DVT_STRING:
+                return variable.value;
+            case DVT_ARRAY:
+            case DVT_MAP:
+            case DVT_UNDEFINED:
+            default:
+                return "";
+        }
+    }
+
+    /*
+        Formats a numeric variable in the given characters (32 are enough) and returns their count.
+        Numbers are formatted as std::ostream does by default (%g, 6 digits), so the text is the same as to_string().
+    */
+    std::size_t format_number(char* digits, std::size_t size, const dynamic_variable& variable)
+    {
+        ++conversions;
+
+        if(variable.type == DVT_INTEGER)
+            return static_cast<std::size_t>(snprintf(digits, size, "%lld", static_cast<long long>(variable.integer)));
+
+        return static_cast<std::size_t>(snprintf(digits, size, "%.*g", 6, variable.number));
+    }
+
+    /* Prints the variable in the output buffer, without building an intermediate string. Arrays are printed by print_array(). */
+    void print(output_buffer& output, const dynamic_variable& variable)
+    {
+        char digits[32];
+
+        switch(variable.type)
+        {
+            case DVT_INTEGER:
+            case DVT_NUMERIC:
+                output.write(digits, format_number(digits, sizeof(digits), variable));
+                break;
+            case DVT_STRING:
+                output.write(variable.value.data(), variable.value.size());
+                break;
+            case DVT_ARRAY:
+            case DVT_MAP:
+            case DVT_UNDEFINED:
+            default:
+                break;
+        }
+    }
+
+    /* Prints the elements of an array in the output buffer, separated by spaces. */
+    void print_array(output_buffer& output, const std::vector<double>& elements)
+    {
+        char digits[32];
+
+        for(std::size_t i(0) ; i < elements.size() ; ++i)
+        {
+            ++conversions;
+
+            if(i != 0)
+                output.write(" ", 1);
+
+            output.write(digits, static_cast<std::size_t>(snprintf(digits, sizeof(digits), "%.*g", 6, elements[i])));
+        }
+    }
+
+    /* Longest string an add or a repetition may build : 1 GiB. */
+    const std::size_t max_string_size = std::size_t(1) << 30;
+
+    /*
+        Appends the string representation of the variable to the string, in place : numbers are not converted to a temporary string.
+        Returns false if the result would be longer than max_string_size, the string is then left as it was.
+    */
+    bool append(std::string& value, const dynamic_variable& variable)
+    {
+        char digits[32];
+        std::size_t size(0);
+
+        switch(variable.type)
+        {
+            case DVT_INTEGER:
+            case DVT_NUMERIC:
+                size = format_number(digits, sizeof(digits), variable);
+
+                if(size > max_string_size - value.size())
+                    return false;
+
+                value.append(digits, size);
+                break;
+            case DVT_STRING:
+                if(variable.value.size() > max_string_size - value.size())
+                    return false;
+
+                value += variable.value;
+                break;
+            case DVT_ARRAY:
+            case DVT_MAP:
+            case DVT_UNDEFINED:
+            default:
+                break;
+        }
+
+        return true;
+    }
+
+    /*
+        Repeats the string the given times in place, zero or less times giving an empty string.
+        The result is reserved once, then the string is appended to itself by doubling : a few copies for any count.
+        Returns false if the result would be longer than max_string_size, the string is then left as it was.
+    */
+    bool repeat(std::string& value, std::int64_t times)
+    {
+        if(times <= 0 || value.empty())
+        {
+            value.clear();
+            return true;
+        }
+
+        std::size_t size = value.size();
+
+        if(static_cast<std::uint64_t>(times) > max_string_size / size)
+            return false;
+
+        std::size_t total = size * static_cast<std::size_t>(times);
+        value.reserve(total);
+
+        while(value.size() * 2 <= total)
+            value.append(value.data(), value.size());
+
+        value.append(value.data(), total - value.size());
+        return true;
+    }
+
+    /* Longest array : 1 GiB of memory, 2^27 elements, like the longest string. */
+    const std::size_t max_array_size = max_string_size / sizeof(double);
+
+    /*
+        Resizes the elements of an array, zero or less giving an empty array. The first elements are kept and the new ones are zeros.
+        Returns false if the array would be longer than max_array_size, it is then left as it was.
+    */
+    bool resize_array(std::vector<double>& elements, std::int64_t size)
+    {
+        if(size > 0 && static_cast<std::uint64_t>(size) > max_array_size)
+            return false;
+
+        elements.resize((size > 0) ? static_cast<std::size_t>(size) : 0, 0.0);
+        return true;
+    }
+
+    /* Returns true if the element has an order, which not-a-number has not. */
+    bool is_ordered(double element)
+    {
+        return !std::isnan(element);
+    }
+
+    /* Sorts the elements of an array in increasing order. The not-a-number elements go last, std::sort() could not order them. */
+    void sort_array(std::vector<double>& elements)
+    {
+        std::vector<double>::iterator ordered_end = std::partition(elements.begin(), elements.end(), is_ordered);
+        std::sort(elements.begin(), ordered_end);
+    }
+
+    /* Hashes of the map slots which hold no key. A key never hashes to them. */
+    const std::uint64_t empty_hash = 0;
+    const std::uint64_t removed_hash = 1;
+
+    /* Hash of a map key (64 bits FNV-1a), never empty_hash nor removed_hash. */
+    std::uint64_t hash_key(const std::string& key)
+    {
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+
+        for(std::size_t i(0) ; i < key.size() ; ++i)
+        {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 0x100000001B3ULL;
+        }
+
+        return (hash <= removed_hash) ? hash + 2 : hash;
+    }
+
+    /* Returns the key a variable stands for in a map : a string as it is, a number as its text (like str), formatted in the given string. */
+    const std::string& key_of(const dynamic_variable& variable, std::string& text)
+    {
+        if(variable.type == DVT_STRING)
+            return variable.value;
+
+        text.clear();
+        append(text, variable);
+
+        return text;
+    }
+
+    /*
+        Map from strings to variables, the storage of the DVT_MAP variables : a hash table with open addressing and linear probing.
+        The hashes of the keys are kept in an array of their own, beside the entries : a probe reads consecutive hashes, and only compares
+        the key of an entry whose hash is the same. A removed key leaves a marker, so the probes of the other keys go on past it.
+        The table is rebuilt twice as big when the keys and markers would fill more than 3/4 of it, or at the same size to drop the markers.
+    */
+    class hash_map
+    {
+        public:
+            hash_map() : m_size(0), m_used(0), m_shift(64)
+            {
+            }
+
+            /* Number of keys. */
+            std::size_t size() const
+            {
+                return m_size;
+            }
+
+            /* Number of slots, the slots are numbered from 0. */
+            std::size_t capacity() const
+            {
+                return m_hashes.size();
+            }
+
+            /* Returns the slot of the key, or capacity() if it is not in the map. */
+            std::size_t find(const std::string& key, std::uint64_t hash) const
+            {
+                if(m_size == 0)
+                    return capacity();
+
+                // The table is never full, a probe always ends on an empty slot.
+                for(std::size_t slot = home(hash) ; ; slot = (slot + 1) & (capacity() - 1))
+                {
+                    if(m_hashes[slot] == hash && m_entries[slot].key == key)
+                        return slot;
+
+                    if(m_hashes[slot] == empty_hash)
+                        return capacity();
+                }
+            }
+
+            /* Returns the value of the key, added with the integer 0 if it is not in the map. */
+            dynamic_variable& insert(const std::string& key, std::uint64_t hash)
+            {
+                std::size_t slot = find(key, hash);
+
+                if(slot != capacity())
+                    return m_entries[slot].value;
+
+                if((m_used + 1) * 4 > capacity() * 3)
+                    rehash();
+
+                // The first slot without a key along the probe, a removed one is reused.
+                slot = home(hash);
+
+                while(m_hashes[slot] > removed_hash)
+                    slot = (slot + 1) & (capacity() - 1);
+
+                if(m_hashes[slot] == empty_hash)
+                    ++m_used;
+
+                ++m_size;
+                m_hashes[slot] = hash;
+                m_entries[slot].key = key;
+                m_entries[slot].value = make_integer(0);
+
+                return m_entries[slot].value;
+            }
+
+            /* Removes the key in the given slot, found by find(). The memory of its key and value is freed. */
+            void erase(std::size_t slot)
+            {
+                --m_size;
+                m_hashes[slot] = removed_hash;
+                m_entries[slot].key = std::string();
+                m_entries[slot].value = make_integer(0);
+            }
+
+            /* Returns the first slot from the given one which holds a key, or capacity() if there is none. */
+            std::size_t next(std::size_t slot) const
+            {
+                while(slot < capacity() && m_hashes[slot] <= removed_hash)
+                    ++slot;
+
+                return slot;
+            }
+
+            const std::string& key(std::size_t slot) const
+            {
+                return m_entries[slot].key;
+            }
+
+            dynamic_variable& value(std::size_t slot)
+            {
+                return m_entries[slot].value;
+            }
+
+        private:
+            struct entry
+            {
+                std::string key;
+                dynamic_variable value;
+            };
+
+            /* First slot of the probe of a hash (Fibonacci hashing : the high bits of the product, which depend on every bit of the hash). */
+            std::size_t home(std::uint64_t hash) const
+            {
+                return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ULL) >> m_shift);
+            }
+
+            /* Rebuilds the table without the removed markers, with room for twice the keys, at least 8 slots. */
+            void rehash()
+            {
+                std::size_t slots = 8;
+                unsigned int shift = 61;
+
+                while(slots < (m_size + 1) * 2)
+                {
+                    slots *= 2;
+                    --shift;
+                }
+
+                std::vector<std::uint64_t> hashes(slots, empty_hash);
+                std::vector<entry> entries(slots);
+
+                hashes.swap(m_hashes);
+                entries.swap(m_entries);
+                m_shift = shift;
+                m_used = m_size;
+
+                for(std::size_t i(0) ; i < hashes.size() ; ++i)
+                {
+                    if(hashes[i] <= removed_hash)
+                        continue;
+
+                    std::size_t slot = home(hashes[i]);
+
+                    while(m_hashes[slot] != empty_hash)
+                        slot = (slot + 1) & (capacity() - 1);
+
+                    m_hashes[slot] = hashes[i];
+                    m_entries[slot].key.swap(entries[i].key);
+                    std::swap(m_entries[slot].value, entries[i].value);
+                }
+            }
+
+            std::vector<std::uint64_t> m_hashes; // Hash of the key in each slot, empty_hash or removed_hash without a key.
+            std::vector<entry> m_entries;
+            std::size_t m_size; // Keys.
+            std::size_t m_used; // Keys and removed markers.
+            unsigned int m_shift; // 64 minus the bits of the capacity.
+    };
+
+    /* Fewest arrays and maps made between two collections of the heap. */
+    const std::size_t min_collection = 256;
+
+    /*
+        Arrays and maps of a run. An array or map variable only holds the index of its storage here : a bigger variable would slow down
+        every handler. A copy of the variable refers to the same array or map.
+        The storage no variable reaches anymore, from the register file or through the values of the reached maps, is freed by a
+        mark and sweep collection and reused by the next arrays and maps. A collection runs when the arrays and maps made since the
+        last one are as many as the ones it kept, so its cost is spread over them.
+    */
+    class heap
+    {
+        public:
+            heap() : m_made(0), m_next_collection(min_collection)
+            {
+            }
+
+            /* Makes a new empty array, and returns a variable referring to it. The register file holds every other variable. */
+            dynamic_variable make_array(const std::vector<dynamic_variable>& memory)
+            {
+                reserve(memory);
+
+                if(m_free_arrays.empty())
+                {
+                    m_arrays.push_back(std::vector<double>());
+                    return runtime::make_array(m_arrays.size() - 1);
+                }
+
+                std::size_t index = m_free_arrays.back();
+                m_free_arrays.pop_back();
+
+                return runtime::make_array(index);
+            }
+
+            /* Makes a new empty map, and returns a variable referring to it. The register file holds every other variable. */
+            dynamic_variable make_map(const std::vector<dynamic_variable>& memory)
+            {
+                reserve(memory);
+
+                if(m_free_maps.empty())
+                {
+                    m_maps.push_back(hash_map());
+                    return runtime::make_map(m_maps.size() - 1);
+                }
+
+                std::size_t index = m_free_maps.back();
+                m_free_maps.pop_back();
+
+                return runtime::make_map(index);
+            }
+
+            std::vector<double>& array(const dynamic_variable& variable)
+            {
+                return m_arrays[static_cast<std::size_t>(variable.integer)];
+            }
+
+            hash_map& map(const dynamic_variable& variable)
+            {
+                return m_maps[static_cast<std::size_t>(variable.integer)];
+            }
+
+            /* Frees every array and map, before a new run. */
+            void clear()
+            {
+                m_arrays.clear();
+                m_maps.clear();
+                m_free_arrays.clear();
+                m_free_maps.clear();
+                m_made = 0;
+                m_next_collection = min_collection;
+            }
+
+        private:
+            /* Counts a new array or map, after a collection if it is time. */
+            void reserve(const std::vector<dynamic_variable>& memory)
+            {
+                if(++m_made < m_next_collection)
+                    return;
+
+                std::size_t kept = collect(memory);
+
+                m_made = 0;
+                m_next_collection = std::max(min_collection, kept);
+            }
+
+            /* Marks a variable, if it refers to an array or a map. The maps are marked later, from the worklist. */
+            void mark(const dynamic_variable& variable, std::vector<std::size_t>& worklist)
+            {
+                if(variable.type == DVT_ARRAY)
+                    m_reached_arrays[static_cast<std::size_t>(variable.integer)] = true;
+                else if(variable.type == DVT_MAP && !m_reached_maps[static_cast<std::size_t>(variable.integer)])
+                {
+                    m_reached_maps[static_cast<std::size_t>(variable.integer)] = true;
+                    worklist.push_back(static_cast<std::size_t>(variable.integer));
+                }
+            }
+
+            /* Frees the arrays and maps which are not reached anymore, and returns the number of the ones kept. */
+            std::size_t collect(const std::vector<dynamic_variable>& memory)
+            {
+                std::vector<std::size_t> worklist;
+
+                m_reached_arrays.assign(m_arrays.size(), false);
+                m_reached_maps.assign(m_maps.size(), false);
+
+                for(std::size_t i(0) ; i < memory.size() ; ++i)
+                    mark(memory[i], worklist);
+
+                while(!worklist.empty())
+                {
+                    hash_map& reached = m_maps[worklist.back()];
+                    worklist.pop_back();
+
+                    for(std::size_t slot = reached.next(0) ; slot < reached.capacity() ; slot = reached.next(slot + 1))
+                        mark(reached.value(slot), worklist);
+                }
+
+                // The free lists are made again : the storage already free is not reached either.
+                std::size_t kept(0);
+                m_free_arrays.clear();
+                m_free_maps.clear();
+
+                for(std::size_t i(m_arrays.size()) ; i > 0 ; --i)
+                {
+                    if(m_reached_arrays[i - 1])
+                        ++kept;
+                    else
+                    {
+                        std::vector<double>().swap(m_arrays[i - 1]);
+                        m_free_arrays.push_back(i - 1);
+                    }
+                }
+
+                for(std::size_t i(m_maps.size()) ; i > 0 ; --i)
+                {
+                    if(m_reached_maps[i - 1])
+                        ++kept;
+                    else
+                    {
+                        m_maps[i - 1] = hash_map();
+                        m_free_maps.push_back(i - 1);
+                    }
+                }
+
+                return kept;
+            }
+
+            std::vector<std::vector<double> > m_arrays;
+            std::vector<hash_map> m_maps;
+            std::vector<std::size_t> m_free_arrays; // Indexes of the free arrays, the lowest last.
+            std::vector<std::size_t> m_free_maps;
+            std::vector<bool> m_reached_arrays; // Marks of the last collection.
+            std::vector<bool> m_reached_maps;
+            std::size_t m_made; // Arrays and maps made since the last collection.
+            std::size_t m_next_collection; // Arrays and maps to make before the next collection.
+    };
+
+    /* Adds two integers into the result. Returns true if the sum overflows, the result is then not meaningful. */
+    inline bool add_overflows(std::int64_t first, std::int64_t second, std::int64_t& result)
+    {
+#if defined(__GNUC__)
+        return __builtin_add_overflow(first, second, &result);
+#else
+        if((second > 0 && first > std::numeric_limits<std::int64_t>::max() - second) || (second < 0 && first < std::numeric_limits<std::int64_t>::min() - second))
+            return true;
+
+        result = first + second;
+        return false;
+#endif
+    }
+
+    /* Multiplies two integers into the result. Returns true if the product overflows, the result is then not meaningful. */
+    inline bool mul_overflows(std::int64_t first, std::int64_t second, std::int64_t& result)
+    {
+#if defined(__GNUC__)
+        return __builtin_mul_overflow(first, second, &result);
+#else
+        const std::int64_t max = std::numeric_limits<std::int64_t>::max();
+        const std::int64_t min = std::numeric_limits<std::int64_t>::min();
+
+        // The bounds are divided by a factor whose sign is known, never by -1 with min.
+        if(first > 0 ? (second > 0 ? first > max / second : second < min / first) : (second > 0 ? first < min / second : first != 0 && second < max / first))
+            return true;
+
+        result = first * second;
+        return false;
+#endif
+    }
+
+    /* Adds two numeric variables. Integers are promoted to floating numbers on overflow. */
+    dynamic_variable add_numeric(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        std::int64_t result;
+
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER && !add_overflows(first.integer, second.integer, result))
+            return make_integer(result);
+
+        return make_numeric(to_double(first) + to_double(second));
+    }
+
+    /* Multiplies two numeric variables. Integers are promoted to floating numbers on overflow. */
+    dynamic_variable mul_numeric(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        std::int64_t result;
+
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER && !mul_overflows(first.integer, second.integer, result))
+            return make_integer(result);
+
+        return make_numeric(to_double(first) * to_double(second));
+    }
+
+    /* Adds two numbers in place, for add number : both variables hold numbers, the string of the first one is left as it is. */
+    void add_number(dynamic_variable& first, const dynamic_variable& second)
+    {
+        std::int64_t result;
+
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER && !add_overflows(first.integer, second.integer, result))
+        {
+            first.integer = result;
+            return;
+        }
+
+        double sum = to_double(first) + to_double(second);
+        first.type = DVT_NUMERIC;
+        first.number = sum;
+    }
+
+    /* Multiplies two numbers in place, for mul number : both variables hold numbers, the string of the first one is left as it is. */
+    void mul_number(dynamic_variable& first, const dynamic_variable& second)
+    {
+        std::int64_t result;
+
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER && !mul_overflows(first.integer, second.integer, result))
+        {
+            first.integer = result;
+            return;
+        }
+
+        double product = to_double(first) * to_double(second);
+        first.type = DVT_NUMERIC;
+        first.number = product;
+    }
+
+    /*
+        Adds the second variable to the first one.
+        4 cases :
+            str + str   -> normal
+            num + num   -> normal
+            str + num   -> num converted to str
+            num + str   -> num converted to str
+        Returns false if the string would be too long (see append()), numbers always succeed.
+    */
+    bool add(dynamic_variable& first, const dynamic_variable& second)
+    {
+        // str + str, str + num : appended in place, the string grows geometrically so a loop building a string is linear.
+        if(first.type == DVT_STRING)
+            return append(first.value, second);
+
+        // num + num
+        if(is_numeric(second))
+        {
+            first = add_numeric(first, second);
+            return true;
+        }
+
+        // num + str
+        char digits[32];
+        std::size_t size = format_number(digits, sizeof(digits), first);
+
+        if(second.value.size() > max_string_size - size)
+            return false;
+
+        // We need to change the type. The memory of the old string is reused.
+        first.value.assign(digits, size);
+        first.value += second.value;
+        first.type = DVT_STRING;
+        return true;
+    }
+
+    /*
+        Multiplies the first variable by the second one.
+        2 cases :
+            num * num   -> normal
+            str * num   -> str repeated num times.
+        Returns false if the repeated string would be too long (see repeat()), numbers always succeed.
+    */
+    bool mul(dynamic_variable& first, const dynamic_variable& second)
+    {
+        // num * num
+        if(is_numeric(first))
+        {
+            first = mul_numeric(first, second);
+            return true;
+        }
+
+        // str * num
+        return repeat(first.value, to_integer(second));
+    }
+
+    /* Negates a variable. Strings keep their type but hold the negated number. */
+    void neg(dynamic_variable& variable)
+    {
+        if(variable.type == DVT_INTEGER && variable.integer != std::numeric_limits<std::int64_t>::min())
+            variable.integer = -variable.integer;
+        else if(variable.type == DVT_STRING)
+        {
+            variable.value = string_utils::from<double>(-to_double(variable));
+            ++conversions;
+        }
+        else
+            variable = make_numeric(-to_double(variable));
+    }
+
+    /* Stores an integer in a variable, keeping the memory of its string. Used for cmp_register. */
+    void set_integer(dynamic_variable& variable, std::int64_t integer)
+    {
+        variable.type = DVT_INTEGER;
+        variable.integer = integer;
+    }
+
+    /* Returns true if the first number is greater than the second one, for cmp_gt number : both variables hold numbers. */
+    bool greater_number(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER)
+            return first.integer > second.integer;
+
+        return to_double(first) > to_double(second);
+    }
+
+    /* Returns true if the first number is less than the second one, for cmp_lt number : both variables hold numbers. */
+    bool less_number(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER)
+            return first.integer < second.integer;
+
+        return to_double(first) < to_double(second);
+    }
+
+    /* Returns true if the first variable is greater than the second one. Numbers are compared by value, anything else by representation (lexicographically). */
+    bool greater(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(is_numeric(first) && is_numeric(second))
+            return greater_number(first, second);
+
+        if(first.type == DVT_STRING && second.type == DVT_STRING)
+            return first.value > second.value;
+
+        return to_string(first) > to_string(second);
+    }
+
+    /* Returns true if the first variable is less than the second one. Numbers are compared by value, anything else by representation (lexicographically). */
+    bool less(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(is_numeric(first) && is_numeric(second))
+            return less_number(first, second);
+
+        if(first.type == DVT_STRING && second.type == DVT_STRING)
+            return first.value < second.value;
+
+        return to_string(first) < to_string(second);
+    }
+
+    /* Returns true if both variables are equivalent. Numbers are compared by value, anything else by representation. */
+    bool equals(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER)
+            return first.integer == second.integer;
+
+        if(is_numeric(first) && is_numeric(second))
+            return !(to_double(first) < to_double(second)) && !(to_double(second) < to_double(first));
+
+        return to_string(first) == to_string(second);
+    }
+
+    /* Returns true if both numbers are equal, for cmp_eq number : both variables hold numbers. */
+    bool equals_number(const dynamic_variable& first, const dynamic_variable& second)
+    {
+        if(first.type == DVT_INTEGER && second.type == DVT_INTEGER)
+            return first.integer == second.integer;
+
+        return !(to_double(first) < to_double(second)) && !(to_double(second) < to_double(first));
+    }
+
+    /* What the runtime measures while running, prefixed by INSTRUMENT_. */
+    enum instrumentation
+    {
+        INSTRUMENT_NONE,
+        INSTRUMENT_COUNTERS, // Instructions retired and branches taken, for -stats.
+        INSTRUMENT_PROFILE   // The counters, and each instruction counted and timed in a profile, for -profile.
+    };
+
+    /* Fixed slots of the special variables in the register file. Other variables and constants follow them. */
+    enum special_slot
+    {
+        SLOT_CMP_REGISTER,
+        SLOT_RANDOM_MAX,
+        SLOT_RANDOM_INT,
+        SLOT_RANDOM_NUM,
+        SLOT_ARRAY_INDEX,
+        SLOT_DOT_PRODUCT,
+        SLOT_MAP_VALUE,
+        SLOT_MAP_CURSOR,
+        SLOT_FIRST_FREE
+    };
+
+    /* Returns true if the argument of the given opcode is a label name rather than a variable. */
+    bool takes_label(opcode op)
+    {
+        return op == LABEL || op == JMP || op == JNZ || op == JZ;
+    }
+
+    /* Native code of a loop compiled by the JIT : runs on the register file and returns the index of the next instruction. */
+    typedef unsigned int (*native_loop)(dynamic_variable* memory);
+
+    /*
+        Where the instructions of a program come from in the source, for the profiler.
+        The passes which remove, move or insert instructions keep the lines in step with them.
+    */
+    struct debug_info
+    {
+        std::vector<unsigned int> lines; // Source line of each instruction.
+        std::vector<std::pair<unsigned int, std::string> > labels; // Source line and name of each label, in the order of the source.
+
+        /* Returns the name of the label the line belongs to (the last one before it), or an empty string. */
+        std::string label_of(unsigned int line) const
+        {
+            std::string name;
+
+            for(std::size_t i(0) ; i < labels.size() && labels[i].first <= line ; ++i)
+                name = labels[i].second;
+
+            return name;
+        }
+    };
+
+    /*
+        A program ready to be run : the instructions without labels, with every argument resolved,
+        and the initial register file.
+        The runtime does not use the tokens of the instructions, so a program can also be loaded from bytecode.
+    */
+    struct program
+    {
+        std::vector<instruction> instructions;
+        std::vector<dynamic_variable> memory; // Initial register file.
+        std::vector<std::string> names; // Name of the variable in each slot, for error messages.
+        std::vector<native_loop> native_loops; // Loops compiled by the JIT, run by JIT_LOOP instructions.
+        unsigned int traced_loops; // Loops run by the tracing tier, entered by TRACE_LOOP instructions.
+        std::vector<std::uint64_t> key_hashes; // Hash of the constants used as map keys, by slot, 0 for the other slots. Computed by hash_constant_keys().
+        debug_info debug; // Where the instructions come from, empty for bytecode.
+
+        program() : traced_loops(0)
+        {
+        }
+    };
+
+    /* Returns true if the opcode takes a map and a key. */
+    bool takes_key(opcode op)
+    {
+        return op == MAP_PUT || op == MAP_GET || op == MAP_HAS || op == MAP_DEL;
+    }
+
+    /*
+        Hashes the constant keys of the map opcodes once, when the program is compiled or loaded, so their lookups do not hash them again.
+        Run last : the other passes may move the constants to other slots.
+    */
+    void hash_constant_keys(program& resolved)
+    {
+        std::string text;
+        resolved.key_hashes.assign(resolved.memory.size(), 0);
+
+        for(std::size_t i(0) ; i < resolved.instructions.size() ; ++i)
+        {
+            unsigned int slot = resolved.instructions[i].s_slot;
+
+            if(takes_key(resolved.instructions[i].op) && slot >= SLOT_FIRST_FREE && resolved.names[slot].empty())
+                resolved.key_hashes[slot] = hash_key(key_of(resolved.memory[slot], text));
+        }
+    }
+
+    /* Returns the hash of the key in the given slot : the one computed by hash_constant_keys() for a constant, else it is hashed. */
+    inline std::uint64_t hash_of(const program& resolved, unsigned int slot, const std::string& key)
+    {
+        std::uint64_t hash = resolved.key_hashes[slot];
+        return (hash != 0) ? hash : hash_key(key);
+    }
+
+    /* Counts the instruction done at the given index in the counters of the run, the next one being at next. */
+    inline void retire(smallthink::run_counters& counters, const instruction& done, unsigned int index, unsigned int next)
+    {
+        // The native code of a loop returns to its first instruction when its variables do not hold numbers.
+        if(done.op == JIT_LOOP)
+        {
+            if(next != index + 1)
+                ++counters.native_loops;
+
+            return;
+        }
+
+        // The instructions run by a trace are counted by the tracing tier.
+        if(done.op == TRACE_LOOP)
+            return;
+
+        unsigned int length = fused_length(done.op);
+        counters.instructions += length;
+
+        if(next != index + length)
+            ++counters.taken_branches;
+    }
+
+    /*
+        Pseudo random generator of a virtual machine (xorshift64*) : virtual machines running at once do not share the state of rand().
+        A zero seed is replaced by one from the clock, different for each generator seeded at the same time.
+    */
+    class random_generator
+    {
+        public:
+            explicit random_generator(std::uint64_t seed = 0)
+            {
+                reseed(seed);
+            }
+
+            void reseed(std::uint64_t seed)
+            {
+                static std::atomic<std::uint64_t> seeded(0);
+
+                if(seed == 0)
+                    seed = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) + (++seeded) * 0x9E3779B97F4A7C15ULL;
+
+                // Mixed once (splitmix64), so that close seeds give unrelated sequences. The state is never zero.
+                seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+                m_state = (seed ^ (seed >> 31)) | 1;
+            }
+
+            /* Returns a number in [0, 2^31), like rand() with glibc. */
+            std::int64_t next()
+            {
+                m_state ^= m_state >> 12;
+                m_state ^= m_state << 25;
+                m_state ^= m_state >> 27;
+
+                return static_cast<std::int64_t>((m_state * 0x2545F4914F6CDD1DULL) >> 33);
+            }
+
+        private:
+            std::uint64_t m_state;
+    };
+
+    /* Prints an unknown variable error and returns the runtime error status. */
+    smallthink::status unknown_variable(std::ostream& errors, const std::string& context, const std::string& name)
+    {
+        errors << std::endl << "[" << context << "][ERROR] Unknown variable : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints a too long string error and returns the runtime error status. */
+    smallthink::status string_too_long(std::ostream& errors, const std::string& context, const std::string& name)
+    {
+        errors << std::endl << "[" << context << "][ERROR] String too long : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints the error of a variable which is unknown or holds an array or a map where a number or a string is expected, and returns the runtime error status. */
+    smallthink::status not_a_value(std::ostream& errors, const std::string& context, const std::string& name, const dynamic_variable& variable)
+    {
+        if(variable.type == DVT_UNDEFINED)
+            return unknown_variable(errors, context, name);
+
+        errors << std::endl << "[" << context << "][ERROR] " << (variable.type == DVT_MAP ? "Map" : "Array") << " used as a value : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints the error of a variable which is unknown or does not hold an array, and returns the runtime error status. */
+    smallthink::status not_an_array(std::ostream& errors, const std::string& context, const std::string& name, const dynamic_variable& variable)
+    {
+        if(variable.type == DVT_UNDEFINED)
+            return unknown_variable(errors, context, name);
+
+        errors << std::endl << "[" << context << "][ERROR] Not an array : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints an index out of range error and returns the runtime error status. */
+    smallthink::status out_of_range(std::ostream& errors, const std::string& context, const std::string& name, std::int64_t index)
+    {
+        errors << std::endl << "[" << context << "][ERROR] Index out of range : " << name << "[" << index << "]" << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints a too long array error and returns the runtime error status. */
+    smallthink::status array_too_long(std::ostream& errors, const std::string& context, const std::string& name)
+    {
+        errors << std::endl << "[" << context << "][ERROR] Array too long : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints an empty array error, for the opcodes which need an element, and returns the runtime error status. */
+    smallthink::status empty_array(std::ostream& errors, const std::string& context, const std::string& name)
+    {
+        errors << std::endl << "[" << context << "][ERROR] Empty array : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints the error of two arrays which should have the same length, and returns the runtime error status. */
+    smallthink::status different_lengths(std::ostream& errors, const std::string& context, const std::string& first, const std::string& second)
+    {
+        errors << std::endl << "[" << context << "][ERROR] Arrays of different lengths : " << first << ", " << second << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints the error of a random_max which is not a positive number, and returns the runtime error status. */
+    smallthink::status invalid_random_max(std::ostream& errors, const std::string& context, std::int64_t random_max)
+    {
+        errors << std::endl << "[" << context << "][ERROR] random_max must be greater than 0 : " << random_max << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+    /* Prints the error of a variable which is unknown or does not hold a map, and returns the runtime error status. */
+    smallthink::status not_a_map(std::ostream& errors, const std::string& context, const std::string& name, const dynamic_variable& variable)
+    {
+        if(variable.type == DVT_UNDEFINED)
+            return unknown_variable(errors, context, name);
+
+        errors << std::endl << "[" << context << "][ERROR] Not a map : " << name << std::endl;
+        return smallthink::ST_RUNTIME_ERROR;
+    }
+
+} // runtime namespace.
+
+/*
+    Kernels of the array opcodes : AVX2 when the processor has it, else SSE2 on x86-64, else plain loops.
+
+    The sums (array_sum, array_dot) are taken in 8 lanes : element i is added to lane i % 8, then the lanes are added in a fixed order.
+    Every version computes the same lanes, so a result does not depend on the processor, and the independent lanes hide the latency
+    of the additions. The minimum and the maximum are taken in lanes the same way. The other kernels work element by element.
+*/
+namespace simd
+{
+    const std::size_t lanes = 8;
+
+    /* Adds the lanes of a sum, in the same order for every version. */
+    double add_lanes(const double* partial)
+    {
+        return ((partial[0] + partial[4]) + (partial[2] + partial[6])) + ((partial[1] + partial[5]) + (partial[3] + partial[7]));
+    }
+
+    /* Returns the first element if it is less than the second one (greater with maximum), else the second one, like minpd and maxpd. */
+    template <bool maximum>
+    double select(double element, double current)
+    {
+        return (maximum ? element > current : element < current) ? element : current;
+    }
+
+#ifdef SMALLTHINK_SIMD
+    /* Returns true if the processor and the system support AVX2. Checked once. */
+    bool has_avx2()
+    {
+        static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+        return supported;
+    }
+
+    /* Adds the blocks of 8 elements (of both arrays multiplied, with second) to the lanes. */
+    __attribute__((target("avx2"))) void sum_blocks_avx2(const double* first, const double* second, std::size_t blocks, double* partial)
+    {
+        __m256d low = _mm256_loadu_pd(partial), high = _mm256_loadu_pd(partial + 4);
+
+        for(std::size_t b(0) ; b < blocks ; ++b, first += lanes)
+        {
+            __m256d first_low = _mm256_loadu_pd(first), first_high = _mm256_loadu_pd(first + 4);
+
+            if(second != nullptr)
+            {
+                first_low = _mm256_mul_pd(first_low, _mm256_loadu_pd(second));
+                first_high = _mm256_mul_pd(first_high, _mm256_loadu_pd(second + 4));
+                second += lanes;
+            }
+
+            low = _mm256_add_pd(low, first_low);
+            high = _mm256_add_pd(high, first_high);
+        }
+
+        _mm256_storeu_pd(partial, low);
+        _mm256_storeu_pd(partial + 4, high);
+    }
+
+    void sum_blocks_sse2(const double* first, const double* second, std::size_t blocks, double* partial)
+    {
+        __m128d sums[4];
+
+        for(std::size_t k(0) ; k < 4 ; ++k)
+            sums[k] = _mm_loadu_pd(partial + 2 * k);
+
+        for(std::size_t b(0) ; b < blocks ; ++b, first += lanes)
+        {
+            for(std::size_t k(0) ; k < 4 ; ++k)
+            {
+                __m128d elements = _mm_loadu_pd(first + 2 * k);
+
+                if(second != nullptr)
+                    elements = _mm_mul_pd(elements, _mm_loadu_pd(second + 2 * k));
+
+                sums[k] = _mm_add_pd(sums[k], elements);
+            }
+
+            if(second != nullptr)
+                second += lanes;
+        }
+
+        for(std::size_t k(0) ; k < 4 ; ++k)
+            _mm_storeu_pd(partial + 2 * k, sums[k]);
+    }
+
+    /* Takes the blocks of 8 elements in the lanes of a minimum (or of a maximum). */
+    template <bool maximum>
+    __attribute__((target("avx2"))) void select_blocks_avx2(const double* data, std::size_t blocks, double* partial)
+    {
+        __m256d low = _mm256_loadu_pd(partial), high = _mm256_loadu_pd(partial + 4);
+
+        for(std::size_t b(0) ; b < blocks ; ++b, data += lanes)
+        {
+            low = maximum ? _mm256_max_pd(_mm256_loadu_pd(data), low) : _mm256_min_pd(_mm256_loadu_pd(data), low);
+            high = maximum ? _mm256_max_pd(_mm256_loadu_pd(data + 4), high) : _mm256_min_pd(_mm256_loadu_pd(data + 4), high);
+        }
+
+        _mm256_storeu_pd(partial, low);
+        _mm256_storeu_pd(partial + 4, high);
+    }
+
+    template <bool maximum>
+    void select_blocks_sse2(const double* data, std::size_t blocks, double* partial)
+    {
+        __m128d selected[4];
+
+        for(std::size_t k(0) ; k < 4 ; ++k)
+            selected[k] = _mm_loadu_pd(partial + 2 * k);
+
+        for(std::size_t b(0) ; b < blocks ; ++b, data += lanes)
+            for(std::size_t k(0) ; k < 4 ; ++k)
+                selected[k] = maximum ? _mm_max_pd(_mm_loadu_pd(data + 2 * k), selected[k]) : _mm_min_pd(_mm_loadu_pd(data + 2 * k), selected[k]);
+
+        for(std::size_t k(0) ; k < 4 ; ++k)
+            _mm_storeu_pd(partial + 2 * k, selected[k]);
+    }
+
+    /* Multiplies the elements by the factor, or adds the value to them with add, or adds the elements of other. Returns the elements done. */
+    __attribute__((target("avx2"))) std::size_t map_avx2(double* data, const double* other, std::size_t size, double value, bool add)
+    {
+        __m256d operand = _mm256_set1_pd(value);
+        std::size_t i(0);
+
+        for( ; i + 4 <= size ; i += 4)
+        {
+            __m256d elements = _mm256_loadu_pd(data + i);
+
+            if(other != nullptr)
+                elements = _mm256_add_pd(elements, _mm256_loadu_pd(other + i));
+            else
+                elements = add ? _mm256_add_pd(elements, operand) : _mm256_mul_pd(elements, operand);
+
+            _mm256_storeu_pd(data + i, elements);
+        }
+
+        return i;
+    }
+
+    std::size_t map_sse2(double* data, const double* other, std::size_t size, double value, bool add)
+    {
+        __m128d operand = _mm_set1_pd(value);
+        std::size_t i(0);
+
+        for( ; i + 2 <= size ; i += 2)
+        {
+            __m128d elements = _mm_loadu_pd(data + i);
+
+            if(other != nullptr)
+                elements = _mm_add_pd(elements, _mm_loadu_pd(other + i));
+            else
+                elements = add ? _mm_add_pd(elements, operand) : _mm_mul_pd(elements, operand);
+
+            _mm_storeu_pd(data + i, elements);
+        }
+
+        return i;
+    }
+#endif
+
+    /* Adds the elements (of both arrays multiplied, with second) : the sum of array_sum, or the dot product of array_dot. */
+    double sum(const double* first, const double* second, std::size_t size)
+    {
+        double partial[lanes] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        std::size_t done = size - size % lanes;
+
+#ifdef SMALLTHINK_SIMD
+        if(has_avx2())
+            sum_blocks_avx2(first, second, done / lanes, partial);
+        else
+            sum_blocks_sse2(first, second, done / lanes, partial);
+#else
+        done = 0;
+#endif
+
+        for(std::size_t i(done) ; i < size ; ++i)
+            partial[i % lanes] += (second != nullptr) ? first[i] * second[i] : first[i];
+
+        return add_lanes(partial);
+    }
+
+    /* Returns the least element (the greatest with maximum) of a non empty array. The not-a-number elements are skipped, unless there are only such elements. */
+    template <bool maximum>
+    double select_all(const double* data, std::size_t size)
+    {
+        double partial[lanes];
+        std::size_t done = size - size % lanes, first(0);
+
+        // A not-a-number element is never selected, so the lanes start from an ordered one.
+        while(first + 1 < size && !runtime::is_ordered(data[first]))
+            ++first;
+
+        for(std::size_t k(0) ; k < lanes ; ++k)
+            partial[k] = data[first];
+
+#ifdef SMALLTHINK_SIMD
+        if(has_avx2())
+            select_blocks_avx2<maximum>(data, done / lanes, partial);
+        else
+            select_blocks_sse2<maximum>(data, done / lanes, partial);
+#else
+        done = 0;
+#endif
+
+        for(std::size_t i(done) ; i < size ; ++i)
+            partial[i % lanes] = select<maximum>(data[i], partial[i % lanes]);
+
+        double result = partial[0];
+
+        for(std::size_t k(1) ; k < lanes ; ++k)
+            result = select<maximum>(partial[k], result);
+
+        return result;
+    }
+
+    /* Multiplies the elements by the value, or adds it to them with add, or adds the elements of other : array_scale and array_add. */
+    void map(double* data, const double* other, std::size_t size, double value, bool add)
+    {
+        std::size_t i(0);
+
+#ifdef SMALLTHINK_SIMD
+        if(has_avx2())
+            i = map_avx2(data, other, size, value, add);
+        else
+            i = map_sse2(data, other, size, value, add);
+#endif
+
+        for( ; i < size ; ++i)
+        {
+            if(other != nullptr)
+                data[i] += other[i];
+            else
+                data[i] = add ? data[i] + value : data[i] * value;
+        }
+    }
+
+} // simd namespace.
+
+bool data::is_opcode(const text_view& x)
+{
+    return runtime::get_opcode(x) != runtime::NONE;
+}
+
+/*
+    Word being read by the lexer.
+
+    It is a view into the source while its characters are contiguous. At the first gap (an escape character or a double-quote
+    in the middle of the word), it is copied at the end of the unescaped buffer. This buffer is reserved once with the size
+    of the source, which bounds everything copied in it, so it never moves and the views into it stay valid.
+*/
+class word_builder
+{
+    public:
+        word_builder(std::string& unescaped, std::size_t capacity) : m_unescaped(unescaped), m_capacity(capacity), m_begin(nullptr), m_size(0), m_copied(false)
+        {
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        /* Adds the character at the given position of the source. */
+        void append(const char* position)
+        {
+            if(m_size == 0)
+            {
+                m_begin = position;
+                m_size = 1;
+                m_copied = false;
+                return;
+            }
+
+            if(!m_copied && position == m_begin + m_size)
+            {
+                ++m_size;
+                return;
+            }
+
+            if(!m_copied)
+            {
+                if(m_unescaped.capacity() < m_capacity)
+                    m_unescaped.reserve(m_capacity);
+
+                std::size_t start = m_unescaped.size();
+                m_unescaped.append(m_begin, m_size);
+                m_begin = m_unescaped.data() + start;
+                m_copied = true;
+            }
+
+            m_unescaped.push_back(*position);
+            ++m_size;
+        }
+
+        /* Returns the word and starts a new one. */
+        data::text_view take()
+        {
+            data::text_view word = {m_size > 0 ? m_begin : "", m_size};
+            m_size = 0;
+            m_copied = false;
+
+            return word;
+        }
+
+    private:
+        std::string& m_unescaped;
+        std::size_t m_capacity;
+        const char* m_begin;
+        std::size_t m_size;
+        bool m_copied;
+};
+
+/* Pushes a token in the token list. */
+void push_token(std::vector<data::token>& tokens, data::token_type type, const data::text_view& value, unsigned int line)
+{
+    data::token current_token;
+    current_token.type = type;
+    current_token.value = value;
+    current_token.line = line;
+    data::parse_numeric(current_token);
+
+    tokens.push_back(current_token);
+}
+
+/*
+    Very basic lexer.
+
+    Reads the source in place (usually the mapped file) : tokens are views into it and nothing is allocated per line nor per character.
+    Only the words which are not contiguous in the source are copied, in the unescaped buffer (see word_builder),
+    which must live as long as the tokens.
+*/
+std::vector<data::token> lex(const char* source, std::size_t size, std::string& unescaped)
+{
+    std::vector<data::token> tokens;
+    const char* source_end = source + size;
+    const char* next_line(source);
+    unsigned int line_number(0);
+
+    /* We read the source line by line. */
+    while(next_line < source_end)
+    {
+        const char* line = next_line;
+        ++line_number;
+        const char* line_end = static_cast<const char*>(memchr(line, '\n', static_cast<std::size_t>(source_end - line)));
+
+        if(line_end)
+            next_line = line_end + 1;
+        else
+            next_line = line_end = source_end;
+
+        // First we trim the line.
+        while(line < line_end && isspace(static_cast<unsigned char>(*line)))
+            ++line;
+
+        while(line_end > line && isspace(static_cast<unsigned char>(line_end[-1])))
+            --line_end;
+
+        // We check if the line is not a comment or not empty.
+        if(line == line_end || *line == ';')
+            continue;
+
+        // We are starting the reading.
+        word_builder word(unescaped, size); // The current word.
+        bool is_string(false), is_escaped(false); // To indicate if we are in a string and if we are
+
+        for(const char* position = line ; position < line_end ; ++position)
+        {
+            char cchar(*position);
+
+            // If we met a coma and we are not in a string, it's considered as a token.
+            if(cchar == ',' && !is_string)
+            {
+                // We push the previous token, if there was.
+                if(!word.empty())
+                {
+                    data::text_view value = word.take();
+                    push_token(tokens, data::is_number(value) ? data::TT_NUMERIC : data::TT_IDENTIFIER, value, line_number);
+                }
+
+                // And then the coma token.
+                data::text_view coma = {position, 1};
+                push_token(tokens, data::TT_COMA, coma, line_number);
+            }
+            // If we are in a string and an un-escaped slash appears, we know the next char will be escaped.
+            else if(cchar == '\\' && is_string && !is_escaped)
+            {
+                is_escaped = true;
+            }
+            // If we are not in a string and a double-quote appears, we know that we are starting a string.
+            else if(cchar == '"' && !is_string)
+            {
+                is_string = true;
+            }
+            // If we are in a string and an un-escaped double-quote appears, we know that we have finished the string.
+            else if(cchar == '"' && is_string && !is_escaped)
+            {
+                // End of string.
+                is_string = false;
+                push_token(tokens, data::TT_STRING, word.take(), line_number);
+            }
+            // If we are not in a string and a space appears, it's the end of the token.
+            else if(isspace(static_cast<unsigned char>(cchar)) && !is_string)
+            {
+                if(!word.empty())
+                {
+                    data::text_view value = word.take();
+                    push_token(tokens, data::is_number(value) ? data::TT_NUMERIC : data::TT_IDENTIFIER, value, line_number);
+                }
+            }
+            else
+            {
+                // We put the char into the current word.
+                word.append(position);
+                is_escaped = false;
+            }
+        }
+
+        // If word is not empty, we push the last token.
+        if(!word.empty())
+        {
+            data::text_view value = word.take();
+
+            if(value == ",")
+                push_token(tokens, data::TT_COMA, value, line_number);
+            else
+                push_token(tokens, data::is_number(value) ? data::TT_NUMERIC : data::TT_IDENTIFIER, value, line_number);
+        }
+    }
+
+    return tokens;
+}
+
+/*
+    Very basic parser. The instructions are pushed in instructions, and the source line of each of them in lines.
+    Returns ST_OK, or an error status after printing the error.
+*/
+smallthink::status parse(const std::vector<data::token>& tokens, std::vector<runtime::instruction>& instructions, std::vector<unsigned int>& lines, std::ostream& errors)
+{
+    unsigned int line(0); // Line of the opcode of the current instruction.
+    runtime::instruction current_instruction{runtime::NONE, runtime::AK_NONE, runtime::AK_NONE, 0, 0, 0};
+    data::expected_token expected_token_type(data::ET_OPCODE); // At the beginning we expect an opcode.
+
+    enum {IE_OPCODE, IE_FARG, IE_COMA, IE_SARG} instruction_element = IE_OPCODE; // Used to know wich element we need to complete the instruction.
+    bool instruction_complete = false; // Used to know if current instruction is complete.
+
+    /*
+        We parse all the tokens.
+
+        An instruction is either :
+            opcode identifier|numeric|string coma identifier|numeric|string
+            opcode identifier|numeric|string
+            opcode
+    */
+    for(unsigned int i(0) ; i < tokens.size() ; ++i)
+    {
+        // If the token is not expected.
+        if(!match_expectation(expected_token_type, tokens.at(i)))
+        {
+            errors << "[" << i << "] Unexpected token: (" << data::print_type(tokens.at(i)) << ") \"" << tokens.at(i).value << "\"." << std::endl;
+            errors << "[" << i << "] Expecting: (" << data::print_type(expected_token_type) << ")." << std::endl;
+            return smallthink::ST_INVALID_INPUT;
+        }
+        else
+        {
+            // We check wich element we need to complete the instruction.
+            switch(instruction_element)
+            {
+                case IE_OPCODE:
+                    current_instruction.op = runtime::get_opcode(tokens.at(i).value);
+                    line = tokens.at(i).line;
+
+                    // Depending of the opcode we need (or don't need) an argument.
+                    if(runtime::get_number_of_args_needed(current_instruction.op) > 0)
+                    {
+                        instruction_element = IE_FARG;
+                        expected_token_type = runtime::get_expected_argument_type(current_instruction.op, 1);
+                    }
+                    else // We have a full instruction.
+                    {
+                        instruction_complete = true;
+                        expected_token_type = data::ET_OPCODE;
+                    }
+
+                    break;
+                case IE_FARG:
+                    current_instruction.f_kind = runtime::AK_TOKEN;
+                    current_instruction.f_slot = i;
+
+                    // Depending of the opcode we need (or don't need) another argument.
+                    if(runtime::get_number_of_args_needed(current_instruction.op) > 1)
+                    {
+                        instruction_element = IE_COMA;
+                        expected_token_type = data::ET_COMA;
+                    }
+                    else // We have a full instruction.
+                    {
+                        instruction_complete = true;
+                        expected_token_type = data::ET_OPCODE;
+                    }
+                    break;
+                case IE_COMA:
+                    // After the first argument, we have the coma. Then we have the second argument.
+                    instruction_element = IE_SARG;
+                    expected_token_type = runtime::get_expected_argument_type(current_instruction.op, 2);
+                    break;
+                case IE_SARG:
+                    current_instruction.s_kind = runtime::AK_TOKEN;
+                    current_instruction.s_slot = i;
+
+                    // We have a full instruction.
+                    instruction_complete = true;
+                    expected_token_type = data::ET_OPCODE;
+                    break;
+                default:
+                    errors << "Unknown parser error. Sorry." << std::endl;
+                    return smallthink::ST_INTERNAL_ERROR;
+            }
+        }
+
+        // We check if the instrucion is complete.
+        if(instruction_complete)
+        {
+            // We push the instruction and reset it.
+            instructions.push_back(current_instruction);
+            lines.push_back(line);
+            instruction_complete = false; // Reset the instruction complete flag.
+            instruction_element = IE_OPCODE; // Reset the next element flag.
+            current_instruction = {runtime::NONE, runtime::AK_NONE, runtime::AK_NONE, 0, 0, 0}; // This is a null instruction.
+        }
+    }
+
+    return smallthink::ST_OK;
+}
+
+/*
+    Returns the slot of an argument, giving a new one to unknown variable names and constants.
+    A value can be kept as it was written, as a string constant.
+*/
+unsigned int resolve_argument(const data::token& argument, bool as_written, std::map<std::string, unsigned int>& variables, std::map<std::string, unsigned int>& constants, runtime::program& resolved)
+{
+    if(argument.type == data::TT_IDENTIFIER)
+    {
+        std::map<std::string, unsigned int>::iterator it = variables.find(argument.value.str());
+
+        if(it != variables.end())
+            return it->second;
+
+        // New variable, it stays undefined until it is assigned.
+        resolved.memory.push_back(runtime::make_undefined());
+        resolved.names.push_back(argument.value.str());
+        variables[resolved.names.back()] = static_cast<unsigned int>(resolved.memory.size() - 1);
+
+        return static_cast<unsigned int>(resolved.memory.size() - 1);
+    }
+
+    // Constants are shared by type and value.
+    std::string key = (argument.type == data::TT_STRING || as_written ? "s:" : "n:") + argument.value.str();
+    std::map<std::string, unsigned int>::iterator it = constants.find(key);
+
+    if(it != constants.end())
+        return it->second;
+
+    if(as_written)
+        resolved.memory.push_back(runtime::make_string(argument.value.str()));
+    else
+        resolved.memory.push_back(runtime::make_variable(argument));
+
+    resolved.names.push_back("");
+    constants[key] = static_cast<unsigned int>(resolved.memory.size() - 1);
+
+    return static_cast<unsigned int>(resolved.memory.size() - 1);
+}
+
+/*
+    Resolution pass, between the parser and the runtime.
+
+    Gives a dense slot of the register file to every variable name and every constant,
+    so the runtime never looks up a variable by its name nor reads a token.
+    Returns the program with its initial register file : special variables and constants are set, other variables are undefined.
+    The tokens are not needed anymore after this pass.
+*/
+runtime::program resolve(const std::vector<runtime::instruction>& instructions, const std::vector<data::token>& tokens)
+{
+    runtime::program resolved;
+    std::map<std::string, unsigned int> variables; // Slots of the variables, by name.
+    std::map<std::string, unsigned int> constants; // Slots of the constants, by type and value.
+
+    // Special variables have fixed slots.
+    resolved.memory.resize(runtime::SLOT_FIRST_FREE, runtime::make_undefined());
+    resolved.names.resize(runtime::SLOT_FIRST_FREE);
+
+    resolved.names[runtime::SLOT_CMP_REGISTER] = "cmp_register";
+    resolved.names[runtime::SLOT_RANDOM_MAX] = "random_max";
+    resolved.names[runtime::SLOT_RANDOM_INT] = "random_int";
+    resolved.names[runtime::SLOT_RANDOM_NUM] = "random_num";
+    resolved.names[runtime::SLOT_ARRAY_INDEX] = "array_index";
+    resolved.names[runtime::SLOT_DOT_PRODUCT] = "dot_product";
+    resolved.names[runtime::SLOT_MAP_VALUE] = "map_value";
+    resolved.names[runtime::SLOT_MAP_CURSOR] = "map_cursor";
+
+    for(unsigned int slot(0) ; slot < runtime::SLOT_FIRST_FREE ; ++slot)
+        variables[resolved.names[slot]] = slot;
+
+    resolved.memory[runtime::SLOT_CMP_REGISTER] = runtime::make_integer(0);
+    resolved.memory[runtime::SLOT_RANDOM_MAX] = runtime::make_integer(10000);
+    resolved.memory[runtime::SLOT_RANDOM_INT] = runtime::make_integer(0); // Seeded by the runtime.
+    resolved.memory[runtime::SLOT_RANDOM_NUM] = runtime::make_numeric(0.0); // Seeded by the runtime.
+    resolved.memory[runtime::SLOT_ARRAY_INDEX] = runtime::make_integer(0);
+    resolved.memory[runtime::SLOT_DOT_PRODUCT] = runtime::make_numeric(0.0);
+    resolved.memory[runtime::SLOT_MAP_VALUE] = runtime::make_integer(0);
+    resolved.memory[runtime::SLOT_MAP_CURSOR] = runtime::make_integer(0);
+
+    resolved.instructions = instructions;
+
+    for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+    {
+        runtime::instruction& current = resolved.instructions.at(i);
+        const data::token* f_arg = (current.f_kind == runtime::AK_TOKEN) ? &tokens[current.f_slot] : nullptr;
+        const data::token* s_arg = (current.s_kind == runtime::AK_TOKEN) ? &tokens[current.s_slot] : nullptr;
+
+        // Label names are not variables, the label resolution pass already used them.
+        if(runtime::takes_label(current.op))
+            f_arg = nullptr;
+
+        current.f_kind = runtime::AK_NONE;
+        current.f_slot = 0;
+        current.s_kind = runtime::AK_NONE;
+        current.s_slot = 0;
+
+        // We test for special identifier endline, wich correspond to std::endl.
+        if(current.op == runtime::OUT && f_arg->type == data::TT_IDENTIFIER && f_arg->value == "endline")
+        {
+            current.op = runtime::OUT_ENDLINE;
+            continue;
+        }
+
+        // Printed values are printed as they were written.
+        if(f_arg)
+        {
+            current.f_slot = resolve_argument(*f_arg, current.op == runtime::OUT, variables, constants, resolved);
+            current.f_kind = (f_arg->type == data::TT_IDENTIFIER) ? runtime::AK_VARIABLE : runtime::AK_CONSTANT;
+        }
+
+        if(s_arg)
+        {
+            current.s_slot = resolve_argument(*s_arg, false, variables, constants, resolved);
+            current.s_kind = (s_arg->type == data::TT_IDENTIFIER) ? runtime::AK_VARIABLE : runtime::AK_CONSTANT;
+        }
+    }
+
+    return resolved;
+}
+
+/*
+    Label resolution pass, between the parser and the runtime.
+
+    Stores in every jump the index of the instruction following its label, then removes the labels
+    from the instruction list : the runtime never executes them nor looks them up by name.
+    The lines of the instructions (from the parser) are kept in step, the labels are remembered by line.
+    Returns false (after printing an error) if a jump refers to an unknown label.
+*/
+bool resolve_labels(std::vector<runtime::instruction>& instructions, const std::vector<data::token>& tokens, runtime::debug_info& debug, std::ostream& errors)
+{
+    std::map<std::string, unsigned int> labels; // The map of the labels.
+    std::vector<runtime::instruction> executed; // The instructions without the labels.
+    std::vector<unsigned int> executed_lines;
+
+    /* Remember the position of each label in the executed instructions. */
+    for(unsigned int i(0) ; i < instructions.size() ; ++i)
+    {
+        if(instructions.at(i).op == runtime::LABEL)
+        {
+            labels[tokens[instructions.at(i).f_slot].value.str()] = static_cast<unsigned int>(executed.size());
+            debug.labels.push_back(std::make_pair(debug.lines[i], tokens[instructions.at(i).f_slot].value.str()));
+        }
+        else
+        {
+            executed.push_back(instructions.at(i));
+            executed_lines.push_back(debug.lines[i]);
+        }
+    }
+
+    /* Link each jump to its label. */
+    for(unsigned int i(0) ; i < executed.size() ; ++i)
+    {
+        if(!runtime::takes_label(executed.at(i).op))
+            continue;
+
+        std::map<std::string, unsigned int>::iterator it = labels.find(tokens[executed.at(i).f_slot].value.str());
+
+        if(it == labels.end())
+        {
+            // Error.
+            errors << "[" << string_utils::uppercase(runtime::print_opcode(executed.at(i).op)) << "-LABEL][ERROR] Unknown label : " << tokens[executed.at(i).f_slot].value << std::endl;
+            return false;
+        }
+
+        executed.at(i).target = it->second;
+    }
+
+    instructions.swap(executed);
+    debug.lines.swap(executed_lines);
+
+    return true;
+}
+
+/*
+    Optimizer, run on the resolved program with -O.
+
+    Builds the control flow graph of the program from its jumps and lowers it to SSA form, then :
+        - propagates and folds constants, folds branches and removes unreachable blocks (sparse conditional constant propagation),
+        - removes dead stores and dead computations,
+        - moves loop invariant instructions before their loop.
+    The program stays a list of runtime::instruction : SSA form is only used to analyse it.
+    Values are computed with the functions of the runtime, so a folded value is exactly the one the runtime would compute.
+    An instruction which could fail on an undefined variable is never removed nor moved.
+*/
+namespace optimizer
+{
+    const unsigned int none = UINT_MAX;
+
+    /* A basic block : the instructions [first, last) of the program. */
+    struct block
+    {
+        unsigned int first;
+        unsigned int last;
+        std::vector<unsigned int> successors;
+        std::vector<unsigned int> predecessors;
+    };
+
+    /* Control flow graph of a program. Blocks are in program order, block 0 is the entry. */
+    struct control_flow_graph
+    {
+        std::vector<block> blocks;
+        std::vector<unsigned int> block_of; // Block of each instruction.
+    };
+
+    /* Slots read and written by an instruction. */
+    struct effects
+    {
+        unsigned int uses[3];
+        unsigned int uses_count;
+        unsigned int defs[3];
+        unsigned int defs_count;
+        bool pure; // No side effect : it can be removed when what it writes is never read.
+    };
+
+    /* Returns the slots read and written by an instruction. */
+    effects get_effects(const runtime::instruction& current)
+    {
+        effects result = {{0, 0, 0}, 0, {0, 0, 0}, 0, false};
+
+        // A specialized instruction has the effects of the generic one, for the profiler.
+        switch(runtime::generic_opcode(current.op))
+        {
+            case runtime::MOV:
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                result.pure = true;
+                break;
+            case runtime::ADD:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                result.pure = true;
+                break;
+            case runtime::MUL:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                result.pure = true;
+                break;
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = runtime::SLOT_CMP_REGISTER;
+                result.pure = true;
+                break;
+            case runtime::NEG:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                result.pure = true;
+                break;
+            case runtime::OUT:
+                result.uses[result.uses_count++] = current.f_slot;
+                break;
+            case runtime::IN:
+            case runtime::GET:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::JZ:
+            case runtime::JNZ:
+                result.uses[result.uses_count++] = runtime::SLOT_CMP_REGISTER;
+                break;
+            case runtime::SEED_RANDOM:
+                result.uses[result.uses_count++] = runtime::SLOT_RANDOM_MAX;
+                result.defs[result.defs_count++] = runtime::SLOT_RANDOM_INT;
+                result.defs[result.defs_count++] = runtime::SLOT_RANDOM_NUM;
+                break;
+            // The array opcodes may fail (not an array, out of range index...) : they are never removed nor moved.
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::ARRAY_GET:
+                result.uses[result.uses_count++] = current.s_slot;
+                result.uses[result.uses_count++] = runtime::SLOT_ARRAY_INDEX;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::ARRAY_SET:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.uses[result.uses_count++] = runtime::SLOT_ARRAY_INDEX;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::ARRAY_DOT:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = runtime::SLOT_DOT_PRODUCT;
+                break;
+            case runtime::ARRAY_SORT:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            // So are the map opcodes. A map variable holds a reference : putting or removing a key does not write it.
+            case runtime::MAP_NEW:
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::MAP_PUT:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.uses[result.uses_count++] = runtime::SLOT_MAP_VALUE;
+                break;
+            // map_value is only written when the key is found.
+            case runtime::MAP_GET:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.uses[result.uses_count++] = runtime::SLOT_MAP_VALUE;
+                result.defs[result.defs_count++] = runtime::SLOT_MAP_VALUE;
+                result.defs[result.defs_count++] = runtime::SLOT_CMP_REGISTER;
+                break;
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+                result.uses[result.uses_count++] = current.f_slot;
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = runtime::SLOT_CMP_REGISTER;
+                break;
+            case runtime::MAP_LEN:
+                result.uses[result.uses_count++] = current.s_slot;
+                result.defs[result.defs_count++] = current.f_slot;
+                break;
+            case runtime::MAP_NEXT:
+                result.uses[result.uses_count++] = current.s_slot;
+                result.uses[result.uses_count++] = runtime::SLOT_MAP_CURSOR;
+                result.defs[result.defs_count++] = current.f_slot;
+                result.defs[result.defs_count++] = runtime::SLOT_MAP_CURSOR;
+                result.defs[result.defs_count++] = runtime::SLOT_CMP_REGISTER;
+                break;
+            case runtime::FLUSH:
+            case runtime::FLUSH_OUT:
+            case runtime::STOP:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::OUT_ENDLINE:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::NONE:
+            default:
+                break;
+        }
+
+        return result;
+    }
+
+    /* Returns true if the instruction may jump. */
+    bool is_jump(runtime::opcode op)
+    {
+        op = runtime::generic_opcode(op);
+        return op == runtime::JMP || op == runtime::JZ || op == runtime::JNZ;
+    }
+
+    /* Builds the control flow graph of a program. */
+    control_flow_graph build_graph(const runtime::program& resolved)
+    {
+        const std::vector<runtime::instruction>& instructions = resolved.instructions;
+        const unsigned int size = static_cast<unsigned int>(instructions.size());
+        control_flow_graph graph;
+
+        // An instruction starts a block if it is jumped to or if it follows a jump.
+        std::vector<bool> leader(size + 1, false), jumped_to(size + 1, false);
+        leader[0] = true;
+
+        for(unsigned int i(0) ; i < size ; ++i)
+        {
+            if(is_jump(instructions[i].op))
+                leader[instructions[i].target] = jumped_to[instructions[i].target] = true;
+
+            if(is_jump(instructions[i].op) || instructions[i].op == runtime::STOP)
+                leader[i + 1] = true;
+        }
+
+        graph.block_of.resize(size);
+
+        // A loop on the first instruction needs an empty entry block before its header, so that the header merges the entry values with the back edges.
+        if(size > 0 && jumped_to[0])
+            graph.blocks.push_back(block{0, 0, std::vector<unsigned int>(), std::vector<unsigned int>()});
+
+        for(unsigned int i(0) ; i < size ; ++i)
+        {
+            if(leader[i])
+                graph.blocks.push_back(block{i, i, std::vector<unsigned int>(), std::vector<unsigned int>()});
+
+            graph.blocks.back().last = i + 1;
+            graph.block_of[i] = static_cast<unsigned int>(graph.blocks.size() - 1);
+        }
+
+        // Jumping to the end of the program, or falling from the last block, ends the program : there is no successor.
+        for(unsigned int b(0) ; b < graph.blocks.size() ; ++b)
+        {
+            std::vector<unsigned int>& successors = graph.blocks[b].successors;
+
+            if(graph.blocks[b].first == graph.blocks[b].last)
+            {
+                successors.push_back(b + 1);
+                graph.blocks[b + 1].predecessors.push_back(b);
+                continue;
+            }
+
+            const runtime::instruction& last = instructions[graph.blocks[b].last - 1];
+
+            if(is_jump(last.op) && last.target < size)
+                successors.push_back(graph.block_of[last.target]);
+
+            if(last.op != runtime::JMP && last.op != runtime::STOP && graph.blocks[b].last < size)
+                if(successors.empty() || successors[0] != b + 1)
+                    successors.push_back(b + 1);
+
+            for(unsigned int k(0) ; k < successors.size() ; ++k)
+                graph.blocks[successors[k]].predecessors.push_back(b);
+        }
+
+        return graph;
+    }
+
+    /* Immediate dominator of each block (none for unreachable blocks), computed with the algorithm of Cooper, Harvey and Kennedy. */
+    std::vector<unsigned int> find_dominators(const control_flow_graph& graph, std::vector<unsigned int>& reverse_postorder)
+    {
+        const unsigned int count = static_cast<unsigned int>(graph.blocks.size());
+        std::vector<unsigned int> order(count, none), idom(count, none);
+
+        // Iterative depth first search for the postorder.
+        std::vector<unsigned int> postorder;
+        std::vector<std::pair<unsigned int, unsigned int> > stack;
+        std::vector<bool> visited(count, false);
+
+        if(count > 0)
+        {
+            stack.push_back(std::make_pair(0u, 0u));
+            visited[0] = true;
+        }
+
+        while(!stack.empty())
+        {
+            unsigned int b = stack.back().first, k = stack.back().second;
+
+            if(k < graph.blocks[b].successors.size())
+            {
+                ++stack.back().second;
+                unsigned int successor = graph.blocks[b].successors[k];
+
+                if(!visited[successor])
+                {
+                    visited[successor] = true;
+                    stack.push_back(std::make_pair(successor, 0u));
+                }
+            }
+            else
+            {
+                postorder.push_back(b);
+                stack.pop_back();
+            }
+        }
+
+        reverse_postorder.assign(postorder.rbegin(), postorder.rend());
+
+        for(unsigned int i(0) ; i < postorder.size() ; ++i)
+            order[postorder[i]] = i;
+
+        if(count == 0)
+            return idom;
+
+        idom[0] = 0;
+        bool changed(true);
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int i(1) ; i < reverse_postorder.size() ; ++i)
+            {
+                unsigned int b = reverse_postorder[i], new_idom(none);
+
+                for(unsigned int k(0) ; k < graph.blocks[b].predecessors.size() ; ++k)
+                {
+                    unsigned int p = graph.blocks[b].predecessors[k];
+
+                    if(idom[p] == none)
+                        continue;
+
+                    if(new_idom == none)
+                    {
+                        new_idom = p;
+                        continue;
+                    }
+
+                    // Intersection of the two dominators chains.
+                    unsigned int first(p), second(new_idom);
+
+                    while(first != second)
+                    {
+                        while(order[first] < order[second])
+                            first = idom[first];
+
+                        while(order[second] < order[first])
+                            second = idom[second];
+                    }
+
+                    new_idom = first;
+                }
+
+                if(idom[b] != new_idom)
+                {
+                    idom[b] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+
+        return idom;
+    }
+
+    /* Returns true if block a dominates block b. */
+    bool dominates(const std::vector<unsigned int>& idom, unsigned int a, unsigned int b)
+    {
+        if(idom[b] == none)
+            return false;
+
+        while(b != a && b != 0)
+            b = idom[b];
+
+        return b == a;
+    }
+
+    /* A SSA value : the entry value of a slot, the result of an instruction or a phi. */
+    struct value
+    {
+        unsigned int slot;
+        unsigned int instruction; // Defining instruction, none for the entry values and the phis.
+        unsigned int block; // Block of the instruction or phi, none for the entry values.
+    };
+
+    /* A phi of a block : one operand by predecessor, in the same order. */
+    struct phi
+    {
+        unsigned int result;
+        std::vector<unsigned int> operands;
+    };
+
+    /* Values read and written by an instruction, in the order of get_effects(). */
+    struct instruction_values
+    {
+        unsigned int uses[3];
+        unsigned int defs[3];
+    };
+
+    /* The program lowered to SSA form. The entry value of a slot is the value with the same index. */
+    struct ssa_form
+    {
+        control_flow_graph graph;
+        std::vector<unsigned int> idom;
+        std::vector<unsigned int> reverse_postorder;
+        std::vector<unsigned int> preorder; // Preorder index of each block in the dominator tree.
+        std::vector<value> values;
+        std::vector<std::vector<phi> > phis; // Phis of each block.
+        std::vector<instruction_values> instructions;
+        std::vector<bool> maybe_undefined; // True if the value may be an undefined variable.
+        std::vector<bool> maybe_collection; // True if the value may be an array or a map.
+        std::vector<bool> maybe_string; // True if the value may be a string.
+    };
+
+    /* Returns true if the slot holds a constant rather than a variable. */
+    bool is_constant_slot(const runtime::program& resolved, unsigned int slot)
+    {
+        return resolved.names[slot].empty();
+    }
+
+    /* Lowers the program to SSA form (phis placed on the iterated dominance frontiers). */
+    ssa_form build_ssa(const runtime::program& resolved)
+    {
+        ssa_form ssa;
+        ssa.graph = build_graph(resolved);
+        ssa.idom = find_dominators(ssa.graph, ssa.reverse_postorder);
+
+        const std::vector<runtime::instruction>& instructions = resolved.instructions;
+        const unsigned int blocks_count = static_cast<unsigned int>(ssa.graph.blocks.size());
+        const unsigned int slots_count = static_cast<unsigned int>(resolved.memory.size());
+
+        // Entry values.
+        for(unsigned int slot(0) ; slot < slots_count ; ++slot)
+            ssa.values.push_back(value{slot, none, none});
+
+        // Dominance frontiers.
+        std::vector<std::vector<unsigned int> > frontiers(blocks_count);
+
+        for(unsigned int b(0) ; b < blocks_count ; ++b)
+        {
+            if(ssa.idom[b] == none || ssa.graph.blocks[b].predecessors.size() < 2)
+                continue;
+
+            for(unsigned int k(0) ; k < ssa.graph.blocks[b].predecessors.size() ; ++k)
+            {
+                unsigned int runner = ssa.graph.blocks[b].predecessors[k];
+
+                if(ssa.idom[runner] == none)
+                    continue;
+
+                while(runner != ssa.idom[b])
+                {
+                    if(frontiers[runner].empty() || frontiers[runner].back() != b)
+                        frontiers[runner].push_back(b);
+
+                    runner = ssa.idom[runner];
+                }
+            }
+        }
+
+        // Blocks writing each variable.
+        std::vector<std::vector<unsigned int> > def_blocks(slots_count);
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            effects current = get_effects(instructions[i]);
+            unsigned int b = ssa.graph.block_of[i];
+
+            if(ssa.idom[b] == none)
+                continue;
+
+            for(unsigned int d(0) ; d < current.defs_count ; ++d)
+                if(def_blocks[current.defs[d]].empty() || def_blocks[current.defs[d]].back() != b)
+                    def_blocks[current.defs[d]].push_back(b);
+        }
+
+        // Phis placement.
+        ssa.phis.resize(blocks_count);
+        std::vector<unsigned int> has_phi(blocks_count, none), queued(blocks_count, none);
+
+        for(unsigned int slot(0) ; slot < slots_count ; ++slot)
+        {
+            if(def_blocks[slot].empty())
+                continue;
+
+            std::vector<unsigned int> worklist(def_blocks[slot]);
+
+            for(unsigned int k(0) ; k < worklist.size() ; ++k)
+                queued[worklist[k]] = slot;
+
+            while(!worklist.empty())
+            {
+                unsigned int b = worklist.back();
+                worklist.pop_back();
+
+                for(unsigned int k(0) ; k < frontiers[b].size() ; ++k)
+                {
+                    unsigned int f = frontiers[b][k];
+
+                    if(has_phi[f] == slot)
+                        continue;
+
+                    has_phi[f] = slot;
+                    ssa.values.push_back(value{slot, none, f});
+                    ssa.phis[f].push_back(phi{static_cast<unsigned int>(ssa.values.size() - 1), std::vector<unsigned int>(ssa.graph.blocks[f].predecessors.size(), none)});
+
+                    if(queued[f] != slot)
+                    {
+                        queued[f] = slot;
+                        worklist.push_back(f);
+                    }
+                }
+            }
+        }
+
+        // Renaming, with an iterative walk of the dominator tree.
+        std::vector<std::vector<unsigned int> > children(blocks_count);
+
+        for(unsigned int k(1) ; k < ssa.reverse_postorder.size() ; ++k)
+            children[ssa.idom[ssa.reverse_postorder[k]]].push_back(ssa.reverse_postorder[k]);
+
+        std::vector<std::vector<unsigned int> > stacks(slots_count);
+
+        for(unsigned int slot(0) ; slot < slots_count ; ++slot)
+            stacks[slot].push_back(slot);
+
+        ssa.instructions.resize(instructions.size(), instruction_values{{none, none, none}, {none, none, none}});
+        ssa.preorder.assign(blocks_count, none);
+
+        std::vector<std::vector<unsigned int> > pushed(blocks_count);
+        std::vector<std::pair<unsigned int, bool> > walk;
+        unsigned int preorder_index(0);
+
+        if(blocks_count > 0)
+            walk.push_back(std::make_pair(0u, true));
+
+        while(!walk.empty())
+        {
+            unsigned int b = walk.back().first;
+            bool entering = walk.back().second;
+            walk.pop_back();
+
+            if(!entering)
+            {
+                for(unsigned int k(0) ; k < pushed[b].size() ; ++k)
+                    stacks[pushed[b][k]].pop_back();
+
+                continue;
+            }
+
+            ssa.preorder[b] = preorder_index++;
+
+            for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+            {
+                unsigned int slot = ssa.values[ssa.phis[b][k].result].slot;
+                stacks[slot].push_back(ssa.phis[b][k].result);
+                pushed[b].push_back(slot);
+            }
+
+            for(unsigned int i(ssa.graph.blocks[b].first) ; i < ssa.graph.blocks[b].last ; ++i)
+            {
+                effects current = get_effects(instructions[i]);
+
+                for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                    ssa.instructions[i].uses[u] = stacks[current.uses[u]].back();
+
+                for(unsigned int d(0) ; d < current.defs_count ; ++d)
+                {
+                    ssa.values.push_back(value{current.defs[d], i, b});
+                    ssa.instructions[i].defs[d] = static_cast<unsigned int>(ssa.values.size() - 1);
+                    stacks[current.defs[d]].push_back(ssa.instructions[i].defs[d]);
+                    pushed[b].push_back(current.defs[d]);
+                }
+            }
+
+            for(unsigned int s(0) ; s < ssa.graph.blocks[b].successors.size() ; ++s)
+            {
+                unsigned int successor = ssa.graph.blocks[b].successors[s];
+                const std::vector<unsigned int>& predecessors = ssa.graph.blocks[successor].predecessors;
+                unsigned int position = static_cast<unsigned int>(std::find(predecessors.begin(), predecessors.end(), b) - predecessors.begin());
+
+                for(unsigned int k(0) ; k < ssa.phis[successor].size() ; ++k)
+                    ssa.phis[successor][k].operands[position] = stacks[ssa.values[ssa.phis[successor][k].result].slot].back();
+            }
+
+            walk.push_back(std::make_pair(b, false));
+
+            for(unsigned int k(static_cast<unsigned int>(children[b].size())) ; k > 0 ; --k)
+                walk.push_back(std::make_pair(children[b][k - 1], true));
+        }
+
+        // A value may be undefined if it is the entry value of an unassigned variable, or a phi of such a value.
+        ssa.maybe_undefined.assign(ssa.values.size(), false);
+
+        for(unsigned int slot(0) ; slot < slots_count ; ++slot)
+            ssa.maybe_undefined[slot] = (resolved.memory[slot].type == runtime::DVT_UNDEFINED);
+
+        bool changed(true);
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int b(0) ; b < blocks_count ; ++b)
+                for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                {
+                    const phi& current = ssa.phis[b][k];
+
+                    if(ssa.maybe_undefined[current.result])
+                        continue;
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(current.operands[o] != none && ssa.maybe_undefined[current.operands[o]])
+                        {
+                            ssa.maybe_undefined[current.result] = true;
+                            changed = true;
+                            break;
+                        }
+                }
+        }
+
+        // A value may be an array or a map if an array opcode or map_new writes it in its first argument, if map_get writes it (a value
+        // of a map may be one), or if it is a copy or a phi of such a value.
+        ssa.maybe_collection.assign(ssa.values.size(), false);
+        changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int i(0) ; i < instructions.size() ; ++i)
+            {
+                const instruction_values& current = ssa.instructions[i];
+
+                if(current.defs[0] == none || ssa.maybe_collection[current.defs[0]])
+                    continue;
+
+                switch(runtime::generic_opcode(instructions[i].op))
+                {
+                    case runtime::MOV:
+                        if(current.uses[0] == none || !ssa.maybe_collection[current.uses[0]])
+                            continue;
+                        break;
+                    case runtime::ARRAY_NEW:
+                    case runtime::ARRAY_RESIZE:
+                    case runtime::ARRAY_SET:
+                    case runtime::ARRAY_SCALE:
+                    case runtime::ARRAY_ADD:
+                    case runtime::ARRAY_SORT:
+                    case runtime::MAP_NEW:
+                    case runtime::MAP_GET:
+                        break;
+                    case runtime::ADD:
+                    case runtime::MUL:
+                    case runtime::CMP_EQ:
+                    case runtime::CMP_GT:
+                    case runtime::CMP_LT:
+                    case runtime::NEG:
+                    case runtime::OUT:
+                    case runtime::IN:
+                    case runtime::GET:
+                    case runtime::STOP:
+                    case runtime::FLUSH:
+                    case runtime::LABEL:
+                    case runtime::JMP:
+                    case runtime::JNZ:
+                    case runtime::JZ:
+                    case runtime::NUM:
+                    case runtime::STR:
+                    case runtime::NUM_INT:
+                    case runtime::SEED_RANDOM:
+                    case runtime::FLUSH_OUT:
+                    case runtime::ARRAY_LEN:
+                    case runtime::ARRAY_GET:
+                    case runtime::ARRAY_SUM:
+                    case runtime::ARRAY_MIN:
+                    case runtime::ARRAY_MAX:
+                    case runtime::ARRAY_DOT:
+                    case runtime::MAP_PUT:
+                    case runtime::MAP_HAS:
+                    case runtime::MAP_DEL:
+                    case runtime::MAP_LEN:
+                    case runtime::MAP_NEXT:
+                    case runtime::OUT_ENDLINE:
+                    case runtime::ADD_NUMBER:
+                    case runtime::ADD_STRING:
+                    case runtime::MUL_NUMBER:
+                    case runtime::MUL_STRING:
+                    case runtime::CMP_EQ_NUMBER:
+                    case runtime::CMP_EQ_STRING:
+                    case runtime::CMP_GT_NUMBER:
+                    case runtime::CMP_GT_STRING:
+                    case runtime::CMP_LT_NUMBER:
+                    case runtime::CMP_LT_STRING:
+                    case runtime::JZ_FLAG:
+                    case runtime::JNZ_FLAG:
+                    case runtime::CMP_EQ_JZ:
+                    case runtime::CMP_EQ_JNZ:
+                    case runtime::CMP_GT_JZ:
+                    case runtime::CMP_GT_JNZ:
+                    case runtime::CMP_LT_JZ:
+                    case runtime::CMP_LT_JNZ:
+                    case runtime::MOV_ADD:
+                    case runtime::ADD_CMP_EQ_JZ:
+                    case runtime::ADD_CMP_EQ_JNZ:
+                    case runtime::JIT_LOOP:
+                    case runtime::TRACE_LOOP:
+                    case runtime::NONE:
+                    default:
+                        continue;
+                }
+
+                ssa.maybe_collection[current.defs[0]] = true;
+                changed = true;
+            }
+
+            for(unsigned int b(0) ; b < blocks_count ; ++b)
+                for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                {
+                    const phi& current = ssa.phis[b][k];
+
+                    if(ssa.maybe_collection[current.result])
+                        continue;
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(current.operands[o] != none && ssa.maybe_collection[current.operands[o]])
+                        {
+                            ssa.maybe_collection[current.result] = true;
+                            changed = true;
+                            break;
+                        }
+                }
+        }
+
+        // A value may be a string if it is the entry value of a string, if str, in, get, map_get or map_next writes it,
+        // or if mov, add, mul or neg writes it from such a value, or if it is a phi of such a value.
+        ssa.maybe_string.assign(ssa.values.size(), false);
+
+        for(unsigned int slot(0) ; slot < slots_count ; ++slot)
+            ssa.maybe_string[slot] = (resolved.memory[slot].type == runtime::DVT_STRING);
+
+        changed = true;
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int i(0) ; i < instructions.size() ; ++i)
+            {
+                const instruction_values& current = ssa.instructions[i];
+                runtime::opcode op = runtime::generic_opcode(instructions[i].op);
+
+                if(current.defs[0] == none || ssa.maybe_string[current.defs[0]])
+                    continue;
+
+                bool writes_string = (op == runtime::STR || op == runtime::IN || op == runtime::GET || op == runtime::MAP_GET || op == runtime::MAP_NEXT);
+
+                if(op == runtime::MOV || op == runtime::ADD || op == runtime::MUL || op == runtime::NEG)
+                    for(unsigned int u(0) ; u < 2 ; ++u)
+                        if(current.uses[u] != none && ssa.maybe_string[current.uses[u]])
+                            writes_string = true;
+
+                if(!writes_string)
+                    continue;
+
+                ssa.maybe_string[current.defs[0]] = true;
+                changed = true;
+            }
+
+            for(unsigned int b(0) ; b < blocks_count ; ++b)
+                for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                {
+                    const phi& current = ssa.phis[b][k];
+
+                    if(ssa.maybe_string[current.result])
+                        continue;
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(current.operands[o] != none && ssa.maybe_string[current.operands[o]])
+                        {
+                            ssa.maybe_string[current.result] = true;
+                            changed = true;
+                            break;
+                        }
+                }
+        }
+
+        return ssa;
+    }
+
+    /* Returns true if all the values read by the instruction are defined and are neither arrays nor maps, and if it does not repeat a string : the instruction
+    can not fail. A copy of an array or a map is kept too. */
+    bool cannot_fail(const ssa_form& ssa, const runtime::instruction& current, unsigned int index)
+    {
+        effects current_effects = get_effects(current);
+
+        for(unsigned int u(0) ; u < current_effects.uses_count ; ++u)
+            if(ssa.maybe_undefined[ssa.instructions[index].uses[u]] || ssa.maybe_collection[ssa.instructions[index].uses[u]])
+                return false;
+
+        // A repeated string may become too long.
+        if(runtime::generic_opcode(current.op) == runtime::MUL && ssa.maybe_string[ssa.instructions[index].uses[0]])
+            return false;
+
+        // So may a string added to.
+        if(runtime::generic_opcode(current.op) == runtime::ADD && (ssa.maybe_string[ssa.instructions[index].uses[0]] || ssa.maybe_string[ssa.instructions[index].uses[1]]))
+            return false;
+
+        return true;
+    }
+
+    /* State of a value for the constant propagation, prefixed by LS_ (LATTICE STATE_). */
+    enum lattice_state
+    {
+        LS_TOP, // Not known yet.
+        LS_UNDEFINED, // Always an undefined variable.
+        LS_CONSTANT, // Always the same value.
+        LS_BOTTOM // Not a constant.
+    };
+
+    struct lattice
+    {
+        lattice_state state;
+        runtime::dynamic_variable constant;
+    };
+
+    /* Returns true if both variables hold exactly the same value, with the same type. */
+    bool same_constant(const runtime::dynamic_variable& first, const runtime::dynamic_variable& second)
+    {
+        if(first.type != second.type)
+            return false;
+
+        if(first.type == runtime::DVT_STRING)
+            return first.value == second.value;
+
+        if(first.type == runtime::DVT_NUMERIC)
+            return std::memcmp(&first.number, &second.number, sizeof(double)) == 0;
+
+        return first.integer == second.integer;
+    }
+
+    /* Meet of two lattice values. Returns true if the first one changed. */
+    bool meet(lattice& into, const lattice& other)
+    {
+        if(other.state == LS_TOP || into.state == LS_BOTTOM)
+            return false;
+
+        if(into.state == LS_TOP)
+        {
+            into = other;
+            return true;
+        }
+
+        if(into.state == other.state && (into.state == LS_UNDEFINED || same_constant(into.constant, other.constant)))
+            return false;
+
+        into.state = LS_BOTTOM;
+        return true;
+    }
+
+    /* Computes what a pure instruction writes from constant arguments. Returns false if it is not a constant. */
+    bool evaluate(const runtime::instruction& current, const runtime::dynamic_variable* arguments, runtime::dynamic_variable& result)
+    {
+        switch(current.op)
+        {
+            case runtime::MOV:
+                result = arguments[0];
+                return true;
+            case runtime::ADD:
+                // A string too long is left to fail when running.
+                result = arguments[0];
+                return runtime::add(result, arguments[1]);
+            case runtime::MUL:
+                // Strings are not repeated at compile time.
+                if(!runtime::is_numeric(arguments[0]))
+                    return false;
+
+                result = arguments[0];
+                runtime::mul(result, arguments[1]);
+                return true;
+            case runtime::CMP_EQ:
+                result = runtime::make_integer(runtime::equals(arguments[0], arguments[1]) ? 1 : 0);
+                return true;
+            case runtime::CMP_GT:
+                result = runtime::make_integer(runtime::greater(arguments[0], arguments[1]) ? 1 : 0);
+                return true;
+            case runtime::CMP_LT:
+                result = runtime::make_integer(runtime::less(arguments[0], arguments[1]) ? 1 : 0);
+                return true;
+            case runtime::NEG:
+                result = arguments[0];
+                runtime::neg(result);
+                return true;
+            case runtime::NUM:
+                result = runtime::make_numeric(runtime::to_double(arguments[0]));
+                return true;
+            case runtime::STR:
+                result = runtime::make_string(runtime::to_string(arguments[0]));
+                return true;
+            case runtime::NUM_INT:
+                result = runtime::make_integer(runtime::to_integer(arguments[0]));
+                return true;
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::SEED_RANDOM:
+            case runtime::FLUSH_OUT:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                return false;
+        }
+    }
+
+    /* Sparse conditional constant propagation (Wegman and Zadeck). */
+    class constant_propagation
+    {
+        public:
+            constant_propagation(const runtime::program& resolved, const ssa_form& ssa) : m_program(resolved), m_ssa(ssa)
+            {
+                const unsigned int blocks_count = static_cast<unsigned int>(ssa.graph.blocks.size());
+
+                m_values.resize(ssa.values.size());
+                m_users.resize(ssa.values.size());
+                m_executable.assign(blocks_count, false);
+                m_edges.resize(blocks_count);
+
+                for(unsigned int b(0) ; b < blocks_count ; ++b)
+                    m_edges[b].assign(ssa.graph.blocks[b].predecessors.size(), false);
+
+                // Entry values : the initial register file, random values are not constants.
+                for(unsigned int v(0) ; v < ssa.values.size() ; ++v)
+                {
+                    m_values[v].state = LS_TOP;
+                    m_values[v].constant = runtime::make_undefined();
+                }
+
+                for(unsigned int slot(0) ; slot < resolved.memory.size() ; ++slot)
+                {
+                    if(slot == runtime::SLOT_RANDOM_INT || slot == runtime::SLOT_RANDOM_NUM)
+                        m_values[slot].state = LS_BOTTOM;
+                    else if(resolved.memory[slot].type == runtime::DVT_UNDEFINED)
+                        m_values[slot].state = LS_UNDEFINED;
+                    else
+                    {
+                        m_values[slot].state = LS_CONSTANT;
+                        m_values[slot].constant = resolved.memory[slot];
+                    }
+                }
+
+                // Users of each value : instructions (user) and phis (~block).
+                for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+                {
+                    effects current = get_effects(resolved.instructions[i]);
+
+                    for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                        if(ssa.instructions[i].uses[u] != none)
+                            m_users[ssa.instructions[i].uses[u]].push_back(i);
+                }
+
+                for(unsigned int b(0) ; b < blocks_count ; ++b)
+                    for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                        for(unsigned int o(0) ; o < ssa.phis[b][k].operands.size() ; ++o)
+                            if(ssa.phis[b][k].operands[o] != none)
+                                m_users[ssa.phis[b][k].operands[o]].push_back(~b);
+            }
+
+            void solve()
+            {
+                if(m_ssa.graph.blocks.empty())
+                    return;
+
+                visit_block(0);
+
+                while(!m_flow.empty() || !m_changed.empty())
+                {
+                    while(!m_flow.empty())
+                    {
+                        std::pair<unsigned int, unsigned int> edge = m_flow.back();
+                        m_flow.pop_back();
+
+                        const std::vector<unsigned int>& predecessors = m_ssa.graph.blocks[edge.second].predecessors;
+                        unsigned int position = static_cast<unsigned int>(std::find(predecessors.begin(), predecessors.end(), edge.first) - predecessors.begin());
+
+                        if(m_edges[edge.second][position])
+                            continue;
+
+                        m_edges[edge.second][position] = true;
+
+                        if(!m_executable[edge.second])
+                            visit_block(edge.second);
+                        else
+                            visit_phis(edge.second);
+                    }
+
+                    while(!m_changed.empty())
+                    {
+                        unsigned int changed = m_changed.back();
+                        m_changed.pop_back();
+
+                        for(unsigned int k(0) ; k < m_users[changed].size() ; ++k)
+                        {
+                            unsigned int user = m_users[changed][k];
+
+                            if(user >= m_program.instructions.size())
+                            {
+                                if(m_executable[~user])
+                                    visit_phis(~user);
+                            }
+                            else if(m_executable[m_ssa.graph.block_of[user]])
+                            {
+                                visit_instruction(user);
+                            }
+                        }
+                    }
+                }
+            }
+
+            const lattice& get(unsigned int v) const
+            {
+                return m_values[v];
+            }
+
+            bool is_executable(unsigned int b) const
+            {
+                return m_executable[b];
+            }
+
+        private:
+            void set(unsigned int v, const lattice& computed)
+            {
+                if(meet(m_values[v], computed))
+                    m_changed.push_back(v);
+            }
+
+            void visit_block(unsigned int b)
+            {
+                m_executable[b] = true;
+                visit_phis(b);
+
+                for(unsigned int i(m_ssa.graph.blocks[b].first) ; i < m_ssa.graph.blocks[b].last ; ++i)
+                    visit_instruction(i);
+
+                // The empty entry block falls into the first instruction.
+                if(m_ssa.graph.blocks[b].first == m_ssa.graph.blocks[b].last)
+                    for(unsigned int s(0) ; s < m_ssa.graph.blocks[b].successors.size() ; ++s)
+                        m_flow.push_back(std::make_pair(b, m_ssa.graph.blocks[b].successors[s]));
+            }
+
+            void visit_phis(unsigned int b)
+            {
+                for(unsigned int k(0) ; k < m_ssa.phis[b].size() ; ++k)
+                {
+                    const phi& current = m_ssa.phis[b][k];
+                    lattice computed = {LS_TOP, runtime::make_undefined()};
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(m_edges[b][o] && current.operands[o] != none)
+                            meet(computed, m_values[current.operands[o]]);
+
+                    set(current.result, computed);
+                }
+            }
+
+            void visit_instruction(unsigned int i)
+            {
+                const runtime::instruction& current = m_program.instructions[i];
+                effects current_effects = get_effects(current);
+                unsigned int b = m_ssa.graph.block_of[i];
+
+                // Values written.
+                if(current_effects.defs_count > 0)
+                {
+                    lattice computed = {LS_BOTTOM, runtime::make_undefined()};
+                    runtime::dynamic_variable arguments[3];
+                    bool constant(current_effects.pure), waiting(false);
+
+                    for(unsigned int u(0) ; u < current_effects.uses_count ; ++u)
+                    {
+                        const lattice& argument = m_values[m_ssa.instructions[i].uses[u]];
+
+                        if(argument.state == LS_TOP)
+                            waiting = true;
+                        else if(argument.state != LS_CONSTANT)
+                            constant = false;
+                        else
+                            arguments[u] = argument.constant;
+                    }
+
+                    // Arguments are given in the order of the instruction : (f, s), (s) for mov.
+                    if(waiting && constant)
+                        return;
+
+                    if(constant && current_effects.defs_count == 1 && evaluate(current, arguments, computed.constant))
+                        computed.state = LS_CONSTANT;
+
+                    for(unsigned int d(0) ; d < current_effects.defs_count ; ++d)
+                        set(m_ssa.instructions[i].defs[d], computed);
+                }
+
+                // Successors, at the end of the block.
+                if(i + 1 != m_ssa.graph.blocks[b].last)
+                    return;
+
+                const std::vector<unsigned int>& successors = m_ssa.graph.blocks[b].successors;
+
+                if((current.op == runtime::JZ || current.op == runtime::JNZ) && current.target < m_program.instructions.size())
+                {
+                    const lattice& condition = m_values[m_ssa.instructions[i].uses[0]];
+                    unsigned int taken = m_ssa.graph.block_of[current.target];
+
+                    if(condition.state == LS_TOP)
+                        return;
+
+                    if(condition.state == LS_CONSTANT)
+                    {
+                        bool jumps = (runtime::to_integer(condition.constant) != 0) == (current.op == runtime::JNZ);
+
+                        // A jump to the next block has a single successor for both ways.
+                        for(unsigned int s(0) ; s < successors.size() ; ++s)
+                            if(taken == b + 1 || (successors[s] == taken) == jumps)
+                                m_flow.push_back(std::make_pair(b, successors[s]));
+
+                        return;
+                    }
+                }
+
+                for(unsigned int s(0) ; s < successors.size() ; ++s)
+                    m_flow.push_back(std::make_pair(b, successors[s]));
+            }
+
+            const runtime::program& m_program;
+            const ssa_form& m_ssa;
+            std::vector<lattice> m_values;
+            std::vector<std::vector<unsigned int> > m_users;
+            std::vector<bool> m_executable;
+            std::vector<std::vector<bool> > m_edges; // Executable edges, by block and predecessor.
+            std::vector<std::pair<unsigned int, unsigned int> > m_flow;
+            std::vector<unsigned int> m_changed;
+    };
+
+    /* Constants of the register file, indexed by their type and exact value. */
+    class constant_pool
+    {
+        public:
+            explicit constant_pool(runtime::program& resolved) : m_program(resolved)
+            {
+                for(unsigned int slot(runtime::SLOT_FIRST_FREE) ; slot < resolved.memory.size() ; ++slot)
+                    if(is_constant_slot(resolved, slot))
+                        m_slots.insert(std::make_pair(key(resolved.memory[slot]), slot));
+            }
+
+            /* Returns the slot of a constant, adding it to the register file if needed. */
+            unsigned int slot(const runtime::dynamic_variable& constant)
+            {
+                std::map<std::string, unsigned int>::const_iterator found = m_slots.find(key(constant));
+
+                if(found != m_slots.end())
+                    return found->second;
+
+                m_program.memory.push_back(constant);
+                m_program.names.push_back("");
+
+                unsigned int added = static_cast<unsigned int>(m_program.memory.size() - 1);
+                m_slots[key(constant)] = added;
+
+                return added;
+            }
+
+        private:
+            static std::string key(const runtime::dynamic_variable& constant)
+            {
+                std::string result(1, static_cast<char>(constant.type));
+
+                if(constant.type == runtime::DVT_STRING)
+                    result += constant.value;
+                else
+                    result.append(reinterpret_cast<const char*>(&constant.integer), sizeof(constant.integer));
+
+                return result;
+            }
+
+            runtime::program& m_program;
+            std::map<std::string, unsigned int> m_slots;
+    };
+
+    /* Removes the marked instructions and moves the jump targets accordingly. Returns true if anything was removed. */
+    bool compact(runtime::program& resolved, const std::vector<bool>& removed)
+    {
+        std::vector<runtime::instruction>& instructions = resolved.instructions;
+        std::vector<unsigned int> kept_before(instructions.size() + 1, 0);
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+            kept_before[i + 1] = kept_before[i] + (removed[i] ? 0 : 1);
+
+        if(kept_before.back() == instructions.size())
+            return false;
+
+        std::vector<runtime::instruction> kept;
+        std::vector<unsigned int> kept_lines;
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            if(removed[i])
+                continue;
+
+            kept.push_back(instructions[i]);
+
+            if(!resolved.debug.lines.empty())
+                kept_lines.push_back(resolved.debug.lines[i]);
+
+            // A jump goes to the first instruction kept after its old target.
+            if(is_jump(kept.back().op))
+                kept.back().target = kept_before[kept.back().target];
+        }
+
+        instructions.swap(kept);
+        resolved.debug.lines.swap(kept_lines);
+
+        return true;
+    }
+
+    /* Removes the jumps to the next instruction. */
+    bool remove_useless_jumps(runtime::program& resolved)
+    {
+        bool changed(false);
+
+        while(true)
+        {
+            std::vector<bool> removed(resolved.instructions.size(), false);
+
+            for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+                if(is_jump(resolved.instructions[i].op) && resolved.instructions[i].target == i + 1)
+                    removed[i] = true;
+
+            if(!compact(resolved, removed))
+                return changed;
+
+            changed = true;
+        }
+    }
+
+    /* Constant propagation and folding, branch folding and unreachable blocks removal. Returns true if the program changed. */
+    bool propagate_constants(runtime::program& resolved)
+    {
+        ssa_form ssa = build_ssa(resolved);
+        constant_propagation propagation(resolved, ssa);
+        propagation.solve();
+
+        constant_pool constants(resolved);
+
+        std::vector<runtime::instruction>& instructions = resolved.instructions;
+        std::vector<bool> removed(instructions.size(), false);
+        bool changed(false);
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            runtime::instruction& current = instructions[i];
+            effects current_effects = get_effects(current);
+
+            // Unreachable.
+            if(!propagation.is_executable(ssa.graph.block_of[i]))
+            {
+                removed[i] = true;
+                continue;
+            }
+
+            // Folded : the instruction always writes the same value.
+            if(current_effects.pure && current_effects.defs_count == 1 && propagation.get(ssa.instructions[i].defs[0]).state == LS_CONSTANT)
+            {
+                unsigned int slot = constants.slot(propagation.get(ssa.instructions[i].defs[0]).constant);
+
+                if(current.op != runtime::MOV || current.s_slot != slot)
+                {
+                    current.op = runtime::MOV;
+                    current.f_slot = current_effects.defs[0];
+                    current.f_kind = runtime::AK_VARIABLE;
+                    current.s_slot = slot;
+                    current.s_kind = runtime::AK_CONSTANT;
+                    changed = true;
+                }
+
+                continue;
+            }
+
+            // Branch always or never taken.
+            if(current.op == runtime::JZ || current.op == runtime::JNZ)
+            {
+                const lattice& condition = propagation.get(ssa.instructions[i].uses[0]);
+
+                if(condition.state == LS_CONSTANT)
+                {
+                    if((runtime::to_integer(condition.constant) != 0) == (current.op == runtime::JNZ))
+                        current.op = runtime::JMP;
+                    else
+                        removed[i] = true;
+
+                    changed = true;
+                }
+
+                continue;
+            }
+
+            // Propagated : arguments which are only read are replaced by constants. The kind stays as written (see mul).
+            bool reads_first = (current.op == runtime::CMP_EQ || current.op == runtime::CMP_GT || current.op == runtime::CMP_LT || current.op == runtime::OUT);
+            bool reads_second = (current.op == runtime::MOV || current.op == runtime::ADD || current.op == runtime::MUL || current.op == runtime::CMP_EQ || current.op == runtime::CMP_GT || current.op == runtime::CMP_LT);
+
+            for(unsigned int u(0) ; u < current_effects.uses_count ; ++u)
+            {
+                const lattice& argument = propagation.get(ssa.instructions[i].uses[u]);
+
+                if(argument.state != LS_CONSTANT || is_constant_slot(resolved, current_effects.uses[u]))
+                    continue;
+
+                unsigned int slot = constants.slot(argument.constant);
+
+                if(reads_first && current_effects.uses[u] == current.f_slot)
+                {
+                    current.f_slot = slot;
+                    changed = true;
+                }
+
+                if(reads_second && current_effects.uses[u] == current.s_slot && (u > 0 || current.op == runtime::MOV))
+                {
+                    current.s_slot = slot;
+                    changed = true;
+                }
+            }
+        }
+
+        changed = compact(resolved, removed) || changed;
+        changed = remove_useless_jumps(resolved) || changed;
+
+        return changed;
+    }
+
+    /* Removes the pure instructions whose results are never read (mark and sweep on the SSA form). Returns true if the program changed. */
+    bool remove_dead_code(runtime::program& resolved)
+    {
+        ssa_form ssa = build_ssa(resolved);
+        const std::vector<runtime::instruction>& instructions = resolved.instructions;
+
+        std::vector<bool> live(instructions.size(), false), live_phi(ssa.values.size(), false);
+        std::vector<unsigned int> needed;
+
+        // Instructions with side effects or which could fail are always live, so are the values they read.
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            if(ssa.idom[ssa.graph.block_of[i]] == none)
+                continue;
+
+            if(get_effects(instructions[i]).pure && cannot_fail(ssa, instructions[i], i))
+                continue;
+
+            live[i] = true;
+            effects current = get_effects(instructions[i]);
+
+            for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                needed.push_back(ssa.instructions[i].uses[u]);
+        }
+
+        // Phis of each value, to find their operands.
+        std::vector<const phi*> phi_of(ssa.values.size(), nullptr);
+
+        for(unsigned int b(0) ; b < ssa.phis.size() ; ++b)
+            for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                phi_of[ssa.phis[b][k].result] = &ssa.phis[b][k];
+
+        while(!needed.empty())
+        {
+            unsigned int v = needed.back();
+            needed.pop_back();
+
+            if(v == none)
+                continue;
+
+            if(ssa.values[v].instruction != none && !live[ssa.values[v].instruction])
+            {
+                unsigned int i = ssa.values[v].instruction;
+                effects current = get_effects(instructions[i]);
+
+                live[i] = true;
+
+                for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                    needed.push_back(ssa.instructions[i].uses[u]);
+            }
+            else if(phi_of[v] && !live_phi[v])
+            {
+                live_phi[v] = true;
+
+                for(unsigned int o(0) ; o < phi_of[v]->operands.size() ; ++o)
+                    needed.push_back(phi_of[v]->operands[o]);
+            }
+        }
+
+        // Jumps and instructions of unreachable blocks are kept here, the constant propagation removes them.
+        std::vector<bool> removed(instructions.size(), false);
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+            removed[i] = !live[i] && ssa.idom[ssa.graph.block_of[i]] != none && get_effects(instructions[i]).pure;
+
+        bool changed = compact(resolved, removed);
+        changed = remove_useless_jumps(resolved) || changed;
+
+        return changed;
+    }
+
+    /* Moves the invariant instructions of one loop before it. Returns true if the program changed. */
+    bool hoist_loop_invariants(runtime::program& resolved)
+    {
+        ssa_form ssa = build_ssa(resolved);
+        const control_flow_graph& graph = ssa.graph;
+        const std::vector<runtime::instruction>& instructions = resolved.instructions;
+        const unsigned int blocks_count = static_cast<unsigned int>(graph.blocks.size());
+
+        // Natural loops, by header : the blocks which reach a back edge without going through the header.
+        std::vector<std::vector<unsigned int> > loops(blocks_count);
+        std::vector<bool> in_body(blocks_count, false);
+
+        for(unsigned int b(0) ; b < blocks_count ; ++b)
+        {
+            if(ssa.idom[b] == none)
+                continue;
+
+            for(unsigned int s(0) ; s < graph.blocks[b].successors.size() ; ++s)
+            {
+                unsigned int header = graph.blocks[b].successors[s];
+
+                if(!dominates(ssa.idom, header, b))
+                    continue;
+
+                std::vector<unsigned int>& body = loops[header];
+
+                if(body.empty())
+                    body.push_back(header);
+
+                std::fill(in_body.begin(), in_body.end(), false);
+
+                for(unsigned int k(0) ; k < body.size() ; ++k)
+                    in_body[body[k]] = true;
+
+                std::vector<unsigned int> worklist(1, b);
+
+                while(!worklist.empty())
+                {
+                    unsigned int current = worklist.back();
+                    worklist.pop_back();
+
+                    if(in_body[current])
+                        continue;
+
+                    in_body[current] = true;
+                    body.push_back(current);
+
+                    for(unsigned int p(0) ; p < graph.blocks[current].predecessors.size() ; ++p)
+                        if(ssa.idom[graph.blocks[current].predecessors[p]] != none)
+                            worklist.push_back(graph.blocks[current].predecessors[p]);
+                }
+            }
+        }
+
+        // Inner loops first.
+        std::vector<std::pair<std::size_t, unsigned int> > headers;
+
+        for(unsigned int b(0) ; b < blocks_count ; ++b)
+            if(!loops[b].empty())
+                headers.push_back(std::make_pair(loops[b].size(), b));
+
+        std::sort(headers.begin(), headers.end());
+
+        for(unsigned int l(0) ; l < headers.size() ; ++l)
+        {
+            unsigned int header = headers[l].second;
+            std::vector<bool> in_loop(blocks_count, false);
+
+            for(unsigned int k(0) ; k < loops[header].size() ; ++k)
+                in_loop[loops[header][k]] = true;
+
+            // The instructions are moved just before the header : nothing in the loop may fall into it.
+            if(header > 0 && in_loop[header - 1])
+                continue;
+
+            // Blocks leaving the loop, to a block outside of it.
+            std::vector<unsigned int> exits;
+
+            for(unsigned int k(0) ; k < loops[header].size() ; ++k)
+            {
+                unsigned int b = loops[header][k];
+
+                for(unsigned int s(0) ; s < graph.blocks[b].successors.size() ; ++s)
+                    if(!in_loop[graph.blocks[b].successors[s]])
+                        exits.push_back(b);
+            }
+
+            std::vector<bool> invariant(instructions.size(), false), banned(resolved.memory.size(), false);
+            bool stable(false);
+
+            while(!stable)
+            {
+                stable = true;
+                std::fill(invariant.begin(), invariant.end(), false);
+
+                // Invariant : pure, can not fail, and only reads values computed outside of the loop or by invariant instructions.
+                bool changed(true);
+
+                while(changed)
+                {
+                    changed = false;
+
+                    for(unsigned int k(0) ; k < loops[header].size() ; ++k)
+                    {
+                        const block& current_block = graph.blocks[loops[header][k]];
+
+                        for(unsigned int i(current_block.first) ; i < current_block.last ; ++i)
+                        {
+                            effects current = get_effects(instructions[i]);
+
+                            if(invariant[i] || !current.pure || current.defs_count != 1 || banned[current.defs[0]] || !cannot_fail(ssa, instructions[i], i))
+                                continue;
+
+                            bool reads_invariant(true);
+
+                            for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                            {
+                                const value& read = ssa.values[ssa.instructions[i].uses[u]];
+
+                                if(read.block != none && in_loop[read.block] && (read.instruction == none || !invariant[read.instruction]))
+                                    reads_invariant = false;
+                            }
+
+                            if(reads_invariant)
+                            {
+                                invariant[i] = true;
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+
+                // A variable is moved out only if all its writes in the loop are invariant, in the same block, and dominate the exits,
+                // and if the instructions left in the loop only read the value of the last of these writes : once moved, the others are
+                // overwritten before the loop. The moved instructions keep their order, they may read any of them.
+                for(unsigned int slot(0) ; slot < resolved.memory.size() && stable ; ++slot)
+                {
+                    if(banned[slot])
+                        continue;
+
+                    bool written(false), valid(true);
+                    unsigned int def_block(none), last_def(none);
+                    std::vector<unsigned int> read_defs;
+
+                    // Every instruction is visited : a read before the first write still bans the variable.
+                    for(unsigned int k(0) ; k < loops[header].size() ; ++k)
+                    {
+                        const block& current_block = graph.blocks[loops[header][k]];
+
+                        for(unsigned int i(current_block.first) ; i < current_block.last ; ++i)
+                        {
+                            effects current = get_effects(instructions[i]);
+
+                            for(unsigned int d(0) ; d < current.defs_count ; ++d)
+                            {
+                                if(current.defs[d] != slot)
+                                    continue;
+
+                                if(!invariant[i] || (def_block != none && def_block != loops[header][k]))
+                                    valid = false;
+
+                                written = true;
+                                def_block = loops[header][k];
+                                last_def = i;
+                            }
+
+                            for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                            {
+                                const value& read = ssa.values[ssa.instructions[i].uses[u]];
+
+                                if(read.slot != slot)
+                                    continue;
+
+                                if(read.block == none || !in_loop[read.block] || read.instruction == none || !invariant[read.instruction])
+                                    valid = false;
+                                else if(!invariant[i])
+                                    read_defs.push_back(read.instruction);
+                            }
+                        }
+                    }
+
+                    if(!written)
+                        continue;
+
+                    // The writes are in one block, visited in program order : the last one visited is the last one run.
+                    for(unsigned int r(0) ; r < read_defs.size() && valid ; ++r)
+                        if(read_defs[r] != last_def)
+                            valid = false;
+
+                    for(unsigned int e(0) ; e < exits.size() && valid ; ++e)
+                        if(!dominates(ssa.idom, def_block, exits[e]))
+                            valid = false;
+
+                    if(!valid)
+                    {
+                        banned[slot] = true;
+                        stable = false;
+                    }
+                }
+            }
+
+            std::vector<unsigned int> hoisted;
+
+            for(unsigned int i(0) ; i < instructions.size() ; ++i)
+                if(invariant[i])
+                    hoisted.push_back(i);
+
+            if(hoisted.empty())
+                continue;
+
+            // A value is computed before it is read : sort by dominator tree order, then program order.
+            std::vector<std::pair<std::pair<unsigned int, unsigned int>, unsigned int> > ordered;
+
+            for(unsigned int k(0) ; k < hoisted.size() ; ++k)
+                ordered.push_back(std::make_pair(std::make_pair(ssa.preorder[graph.block_of[hoisted[k]]], hoisted[k]), hoisted[k]));
+
+            std::sort(ordered.begin(), ordered.end());
+
+            // New program : the hoisted instructions go in a preheader, just before the header.
+            const unsigned int size = static_cast<unsigned int>(instructions.size());
+            const unsigned int header_first = graph.blocks[header].first;
+            std::vector<runtime::instruction> moved;
+            std::vector<unsigned int> moved_lines;
+            std::vector<unsigned int> new_index(size + 1, 0), next_kept(size + 1, size);
+            std::vector<unsigned int> origin;
+            unsigned int preheader(0);
+
+            for(unsigned int i(size) ; i > 0 ; --i)
+                next_kept[i - 1] = invariant[i - 1] ? next_kept[i] : i - 1;
+
+            for(unsigned int i(0) ; i < size ; ++i)
+            {
+                if(i == header_first)
+                {
+                    preheader = static_cast<unsigned int>(moved.size());
+
+                    for(unsigned int k(0) ; k < ordered.size() ; ++k)
+                    {
+                        moved.push_back(instructions[ordered[k].second]);
+                        origin.push_back(none);
+
+                        if(!resolved.debug.lines.empty())
+                            moved_lines.push_back(resolved.debug.lines[ordered[k].second]);
+                    }
+                }
+
+                if(invariant[i])
+                    continue;
+
+                new_index[i] = static_cast<unsigned int>(moved.size());
+                moved.push_back(instructions[i]);
+                origin.push_back(i);
+
+                if(!resolved.debug.lines.empty())
+                    moved_lines.push_back(resolved.debug.lines[i]);
+            }
+
+            new_index[size] = static_cast<unsigned int>(moved.size());
+
+            for(unsigned int k(0) ; k < moved.size() ; ++k)
+            {
+                if(origin[k] == none || !is_jump(moved[k].op))
+                    continue;
+
+                // Entering the loop goes through the preheader, the back edges do not.
+                if(moved[k].target == header_first && !in_loop[graph.block_of[origin[k]]])
+                    moved[k].target = preheader;
+                else
+                    moved[k].target = new_index[next_kept[moved[k].target]];
+            }
+
+            resolved.instructions.swap(moved);
+            resolved.debug.lines.swap(moved_lines);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /* Removes the constants which are not read anymore from the register file. */
+    void remove_unused_constants(runtime::program& resolved)
+    {
+        std::vector<bool> used(resolved.memory.size(), false);
+
+        for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+        {
+            used[resolved.instructions[i].f_slot] = true;
+            used[resolved.instructions[i].s_slot] = true;
+        }
+
+        std::vector<unsigned int> new_slot(resolved.memory.size(), none);
+        unsigned int kept(0);
+
+        for(unsigned int slot(0) ; slot < resolved.memory.size() ; ++slot)
+        {
+            if(slot >= runtime::SLOT_FIRST_FREE && is_constant_slot(resolved, slot) && !used[slot])
+                continue;
+
+            new_slot[slot] = kept;
+            resolved.memory[kept] = resolved.memory[slot];
+            resolved.names[kept] = resolved.names[slot];
+            ++kept;
+        }
+
+        resolved.memory.resize(kept);
+        resolved.names.resize(kept);
+
+        for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+        {
+            resolved.instructions[i].f_slot = new_slot[resolved.instructions[i].f_slot];
+            resolved.instructions[i].s_slot = new_slot[resolved.instructions[i].s_slot];
+        }
+    }
+
+    /* Runs all the optimizations until the program does not change anymore. */
+    void optimize(runtime::program& resolved)
+    {
+        // Each round can only remove or move instructions, a bound keeps the worst cases fast.
+        for(unsigned int round(0) ; round < 16 ; ++round)
+        {
+            bool changed = propagate_constants(resolved);
+            changed = remove_dead_code(resolved) || changed;
+            changed = hoist_loop_invariants(resolved) || changed;
+
+            if(!changed)
+                break;
+        }
+
+        remove_unused_constants(resolved);
+    }
+
+} // optimizer namespace.
+
+/* Prints an argument of an instruction : the name of a variable, or a constant (strings are quoted). */
+void dump_argument(const runtime::program& resolved, unsigned int slot, std::ostream& stream)
+{
+    if(!resolved.names[slot].empty())
+        stream << resolved.names[slot];
+    else if(resolved.memory[slot].type == runtime::DVT_STRING)
+        stream << "\"" << resolved.memory[slot].value << "\"";
+    else
+        stream << runtime::to_string(resolved.memory[slot]);
+}
+
+/* Prints the instructions of a resolved program, one by line : index, opcode, arguments and jump target. */
+void dump(const runtime::program& resolved, std::ostream& stream)
+{
+    for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+    {
+        const runtime::instruction& current = resolved.instructions[i];
+
+        stream << i << "\t" << runtime::print_opcode(current.op);
+
+        switch(runtime::generic_opcode(current.op))
+        {
+            case runtime::MOV:
+            case runtime::ADD:
+            case runtime::MUL:
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+                stream << " ";
+                dump_argument(resolved, current.f_slot, stream);
+                stream << ", ";
+                dump_argument(resolved, current.s_slot, stream);
+                break;
+            case runtime::NEG:
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+                stream << " ";
+                dump_argument(resolved, current.f_slot, stream);
+                break;
+            case runtime::JMP:
+            case runtime::JZ:
+            case runtime::JNZ:
+                stream << " -> " << current.target;
+                break;
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::SEED_RANDOM:
+            case runtime::FLUSH_OUT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                break;
+        }
+
+        stream << std::endl;
+    }
+}
+
+/*
+    Types pass, run after the JIT and before the superinstructions pass.
+
+    Infers the types each variable may hold at each instruction, on the SSA form of the optimizer : the entry values are typed
+    by the initial register file, each instruction types what it writes from what it reads (num, str, num_int, in and get always
+    write the same type), and a phi may hold any type of its operands. The analysis is iterated until nothing changes.
+    Then the add, mul and cmp_* instructions whose arguments have a single type (numbers, integer or floating, or strings) and are
+    always defined are replaced by specialized instructions, which do not check the types at runtime. The others keep the generic handler.
+    The jz and jnz reached only by the cmp_register of comparisons test the flag of the runtime instead of reading cmp_register back.
+    The JIT_LOOP and TRACE_LOOP instructions fall through to their loop : the native code and the traces leave the variables as the loop would.
+*/
+namespace types
+{
+    /* Set of the types a value may have, one bit by type, prefixed by TS_ (TYPE SET_). */
+    enum type_set : unsigned char
+    {
+        TS_NONE = 0, // Not known yet, or never reached.
+        TS_INTEGER = 1,
+        TS_NUMERIC = 2,
+        TS_STRING = 4,
+        TS_UNDEFINED = 8,
+        TS_ARRAY = 16,
+        TS_MAP = 32,
+        TS_NUMBER = TS_INTEGER | TS_NUMERIC
+    };
+
+    /* Types of the arguments of an instruction when it runs. */
+    struct site
+    {
+        unsigned char first;
+        unsigned char second;
+    };
+
+    /* Returns the type of a variable. */
+    unsigned char type_of(const runtime::dynamic_variable& variable)
+    {
+        switch(variable.type)
+        {
+            case runtime::DVT_INTEGER:
+                return TS_INTEGER;
+            case runtime::DVT_NUMERIC:
+                return TS_NUMERIC;
+            case runtime::DVT_STRING:
+                return TS_STRING;
+            case runtime::DVT_ARRAY:
+                return TS_ARRAY;
+            case runtime::DVT_MAP:
+                return TS_MAP;
+            case runtime::DVT_UNDEFINED:
+            default:
+                return TS_UNDEFINED;
+        }
+    }
+
+    /* Computes the types written by an instruction (in the order of get_effects()) from the types it reads. */
+    void transfer(runtime::opcode op, const unsigned char* uses, unsigned char* defs)
+    {
+        // An instruction reading an undefined variable, or an array or a map where it expects a value, stops the program : it writes nothing.
+        switch(op)
+        {
+            case runtime::MOV:
+                defs[0] = uses[0] & ~TS_UNDEFINED;
+                break;
+            case runtime::ADD:
+                defs[0] = uses[0] & TS_STRING;
+
+                // num + num, an integer overflow gives a floating number.
+                if((uses[0] & TS_NUMBER) && (uses[1] & TS_NUMBER))
+                    defs[0] |= TS_NUMERIC | ((uses[0] & uses[1]) & TS_INTEGER);
+
+                // num + str.
+                if((uses[0] & TS_NUMBER) && (uses[1] & TS_STRING))
+                    defs[0] |= TS_STRING;
+                break;
+            case runtime::MUL:
+                defs[0] = uses[0] & TS_STRING;
+
+                // num * num, a string is converted to a floating number.
+                if((uses[0] & TS_NUMBER) && (uses[1] & (TS_NUMBER | TS_STRING)))
+                    defs[0] |= TS_NUMERIC | ((uses[0] & uses[1]) & TS_INTEGER);
+                break;
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+                defs[0] = ((uses[0] & (TS_NUMBER | TS_STRING)) && (uses[1] & (TS_NUMBER | TS_STRING))) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::NEG:
+                defs[0] = (uses[0] & TS_STRING) | ((uses[0] & TS_NUMBER) ? TS_NUMERIC : TS_NONE) | ((uses[0] & TS_INTEGER) ? TS_INTEGER : TS_NONE);
+                break;
+            case runtime::NUM:
+                defs[0] = (uses[0] & (TS_NUMBER | TS_STRING)) ? TS_NUMERIC : TS_NONE;
+                break;
+            case runtime::STR:
+                defs[0] = (uses[0] & (TS_NUMBER | TS_STRING)) ? TS_STRING : TS_NONE;
+                break;
+            case runtime::IN:
+            case runtime::GET:
+                defs[0] = (uses[0] & ~TS_UNDEFINED) ? TS_STRING : TS_NONE;
+                break;
+            case runtime::NUM_INT:
+                defs[0] = (uses[0] & (TS_NUMBER | TS_STRING)) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::SEED_RANDOM:
+                defs[0] = TS_INTEGER;
+                defs[1] = TS_NUMERIC;
+                break;
+            case runtime::ARRAY_NEW:
+                defs[0] = (uses[0] & (TS_NUMBER | TS_STRING)) ? TS_ARRAY : TS_NONE;
+                break;
+            case runtime::ARRAY_LEN:
+                defs[0] = (uses[0] & TS_ARRAY) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+                defs[0] = (uses[0] & TS_ARRAY) ? TS_NUMERIC : TS_NONE;
+                break;
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_SORT:
+                defs[0] = uses[0] & TS_ARRAY;
+                break;
+            case runtime::ARRAY_DOT:
+                defs[0] = (uses[0] & uses[1] & TS_ARRAY) ? TS_NUMERIC : TS_NONE;
+                break;
+            case runtime::MAP_NEW:
+                defs[0] = TS_MAP;
+                break;
+            // A value of a map may have any type but undefined.
+            case runtime::MAP_GET:
+                defs[0] = (uses[0] & TS_MAP) ? (TS_NUMBER | TS_STRING | TS_ARRAY | TS_MAP) : TS_NONE;
+                defs[1] = (uses[0] & TS_MAP) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+                defs[0] = (uses[0] & TS_MAP) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::MAP_NEXT:
+                defs[0] = (uses[0] & TS_MAP) ? TS_STRING : TS_NONE;
+                defs[1] = (uses[0] & TS_MAP) ? TS_INTEGER : TS_NONE;
+                defs[2] = (uses[0] & TS_MAP) ? TS_INTEGER : TS_NONE;
+                break;
+            case runtime::OUT:
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::FLUSH_OUT:
+            case runtime::MAP_PUT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                break;
+        }
+    }
+
+    /* Returns the types of the arguments of each instruction. The instructions of unreachable blocks read TS_NONE. */
+    std::vector<site> infer(const runtime::program& resolved, const optimizer::ssa_form& ssa)
+    {
+        const std::vector<runtime::instruction>& instructions = resolved.instructions;
+        std::vector<unsigned char> values(ssa.values.size(), TS_NONE);
+
+        // Entry values : the initial register file, the random values are seeded with the same types.
+        for(unsigned int slot(0) ; slot < resolved.memory.size() ; ++slot)
+            values[slot] = type_of(resolved.memory[slot]);
+
+        bool changed(true);
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int k(0) ; k < ssa.reverse_postorder.size() ; ++k)
+            {
+                unsigned int b = ssa.reverse_postorder[k];
+
+                for(unsigned int p(0) ; p < ssa.phis[b].size() ; ++p)
+                {
+                    const optimizer::phi& current = ssa.phis[b][p];
+                    unsigned char joined = values[current.result];
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(current.operands[o] != optimizer::none)
+                            joined |= values[current.operands[o]];
+
+                    if(joined != values[current.result])
+                    {
+                        values[current.result] = joined;
+                        changed = true;
+                    }
+                }
+
+                for(unsigned int i(ssa.graph.blocks[b].first) ; i < ssa.graph.blocks[b].last ; ++i)
+                {
+                    optimizer::effects current = optimizer::get_effects(instructions[i]);
+                    unsigned char uses[3] = {TS_NONE, TS_NONE, TS_NONE}, defs[3] = {TS_NONE, TS_NONE, TS_NONE};
+
+                    for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                        uses[u] = values[ssa.instructions[i].uses[u]];
+
+                    transfer(instructions[i].op, uses, defs);
+
+                    for(unsigned int d(0) ; d < current.defs_count ; ++d)
+                    {
+                        unsigned int v = ssa.instructions[i].defs[d];
+
+                        if((values[v] | defs[d]) != values[v])
+                        {
+                            values[v] |= defs[d];
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<site> sites(instructions.size(), site{TS_NONE, TS_NONE});
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            if(ssa.idom[ssa.graph.block_of[i]] == optimizer::none)
+                continue;
+
+            const runtime::instruction& current = instructions[i];
+            optimizer::effects current_effects = optimizer::get_effects(current);
+
+            // An argument which is only written (the first one of mov) has no types.
+            for(unsigned int u(0) ; u < current_effects.uses_count ; ++u)
+            {
+                if(current.f_kind != runtime::AK_NONE && current.op != runtime::MOV && current_effects.uses[u] == current.f_slot && sites[i].first == TS_NONE)
+                    sites[i].first = values[ssa.instructions[i].uses[u]];
+
+                if(current.s_kind != runtime::AK_NONE && current_effects.uses[u] == current.s_slot && sites[i].second == TS_NONE)
+                    sites[i].second = values[ssa.instructions[i].uses[u]];
+            }
+        }
+
+        return sites;
+    }
+
+    /* Returns the specialized opcode of an instruction whose arguments have the given types, or the opcode itself. */
+    runtime::opcode specialized(runtime::opcode op, const site& types)
+    {
+        bool numbers = (types.first != TS_NONE && (types.first & ~TS_NUMBER) == 0) && (types.second != TS_NONE && (types.second & ~TS_NUMBER) == 0);
+        bool strings = (types.first == TS_STRING && types.second == TS_STRING);
+
+        switch(op)
+        {
+            case runtime::ADD:
+                if(numbers)
+                    return runtime::ADD_NUMBER;
+
+                // str + any value is appended.
+                if(types.first == TS_STRING && types.second != TS_NONE && (types.second & (TS_UNDEFINED | TS_ARRAY | TS_MAP)) == 0)
+                    return runtime::ADD_STRING;
+                break;
+            case runtime::MUL:
+                if(numbers)
+                    return runtime::MUL_NUMBER;
+
+                // str * any value is repeated.
+                if(types.first == TS_STRING && types.second != TS_NONE && (types.second & (TS_UNDEFINED | TS_ARRAY | TS_MAP)) == 0)
+                    return runtime::MUL_STRING;
+                break;
+            case runtime::CMP_EQ:
+                if(numbers)
+                    return runtime::CMP_EQ_NUMBER;
+
+                if(strings)
+                    return runtime::CMP_EQ_STRING;
+                break;
+            case runtime::CMP_GT:
+                if(numbers)
+                    return runtime::CMP_GT_NUMBER;
+
+                if(strings)
+                    return runtime::CMP_GT_STRING;
+                break;
+            case runtime::CMP_LT:
+                if(numbers)
+                    return runtime::CMP_LT_NUMBER;
+
+                if(strings)
+                    return runtime::CMP_LT_STRING;
+                break;
+            case runtime::MOV:
+            case runtime::NEG:
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+            case runtime::SEED_RANDOM:
+            case runtime::FLUSH_OUT:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                break;
+        }
+
+        return op;
+    }
+
+    /* Returns true if the instruction is an add, a mul or a cmp_*, which have specialized opcodes. */
+    bool is_specializable(runtime::opcode op)
+    {
+        return op == runtime::ADD || op == runtime::MUL || op == runtime::CMP_EQ || op == runtime::CMP_GT || op == runtime::CMP_LT;
+    }
+
+    /*
+        Returns, for each value of cmp_register, true if the flag of the runtime holds it : it always comes from a comparison,
+        or from the initial register file (zero, like the initial flag). A phi holds it if all its operands do.
+    */
+    std::vector<bool> flag_values(const runtime::program& resolved, const optimizer::ssa_form& ssa)
+    {
+        std::vector<bool> flagged(ssa.values.size(), false);
+
+        flagged[runtime::SLOT_CMP_REGISTER] = (resolved.memory[runtime::SLOT_CMP_REGISTER].type == runtime::DVT_INTEGER && resolved.memory[runtime::SLOT_CMP_REGISTER].integer == 0);
+
+        for(unsigned int v(runtime::SLOT_FIRST_FREE) ; v < ssa.values.size() ; ++v)
+        {
+            if(ssa.values[v].slot != runtime::SLOT_CMP_REGISTER)
+                continue;
+
+            // Phis are assumed to hold it until an operand does not.
+            if(ssa.values[v].instruction == optimizer::none)
+                flagged[v] = (ssa.values[v].block != optimizer::none);
+            else
+            {
+                runtime::opcode op = resolved.instructions[ssa.values[v].instruction].op;
+                flagged[v] = (op == runtime::CMP_EQ || op == runtime::CMP_GT || op == runtime::CMP_LT);
+            }
+        }
+
+        bool changed(true);
+
+        while(changed)
+        {
+            changed = false;
+
+            for(unsigned int b(0) ; b < ssa.phis.size() ; ++b)
+                for(unsigned int k(0) ; k < ssa.phis[b].size() ; ++k)
+                {
+                    const optimizer::phi& current = ssa.phis[b][k];
+
+                    if(!flagged[current.result])
+                        continue;
+
+                    for(unsigned int o(0) ; o < current.operands.size() ; ++o)
+                        if(current.operands[o] != optimizer::none && !flagged[current.operands[o]])
+                        {
+                            flagged[current.result] = false;
+                            changed = true;
+                            break;
+                        }
+                }
+        }
+
+        return flagged;
+    }
+
+    /* Replaces the instructions whose types are known by specialized ones, and the jz and jnz which can test the flag. */
+    void specialize(runtime::program& resolved)
+    {
+        std::vector<runtime::instruction>& instructions = resolved.instructions;
+        optimizer::ssa_form ssa = optimizer::build_ssa(resolved);
+        std::vector<site> sites = infer(resolved, ssa);
+        std::vector<bool> flagged = flag_values(resolved, ssa);
+
+        for(unsigned int i(0) ; i < instructions.size() ; ++i)
+        {
+            runtime::opcode op = instructions[i].op;
+
+            if(is_specializable(op))
+                instructions[i].op = specialized(op, sites[i]);
+            else if((op == runtime::JZ || op == runtime::JNZ) && ssa.idom[ssa.graph.block_of[i]] != optimizer::none && flagged[ssa.instructions[i].uses[0]])
+                instructions[i].op = (op == runtime::JZ) ? runtime::JZ_FLAG : runtime::JNZ_FLAG;
+        }
+    }
+
+    /* Prints a set of types, like "integer|string". */
+    void print_types(unsigned char types, std::ostream& stream)
+    {
+        const char* names[] = {"integer", "numeric", "string", "undefined", "array", "map"};
+        bool first(true);
+
+        for(unsigned int k(0) ; k < 6 ; ++k)
+        {
+            if((types & (1 << k)) == 0)
+                continue;
+
+            stream << (first ? "" : "|") << names[k];
+            first = false;
+        }
+    }
+
+    /*
+        Prints the add, mul and cmp_* instructions which keep the generic handler (polymorphic, or mixing numbers and strings), with the types of their arguments.
+        The program must not be fused.
+    */
+    void explain(const runtime::program& resolved, std::ostream& stream)
+    {
+        std::vector<site> sites = infer(resolved, optimizer::build_ssa(resolved));
+        std::vector<unsigned int> generic;
+        unsigned int count(0);
+
+        for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+        {
+            runtime::opcode op = runtime::generic_opcode(resolved.instructions[i].op);
+
+            // Never reached.
+            if(!is_specializable(op) || sites[i].first == TS_NONE)
+                continue;
+
+            ++count;
+
+            if(specialized(op, sites[i]) == op)
+                generic.push_back(i);
+        }
+
+        stream << "[TYPES] " << (count - generic.size()) << " of " << count << " add, mul and cmp_* instructions specialized, " << generic.size() << " generic." << std::endl;
+
+        if(generic.empty())
+            return;
+
+        stream << "index\tline\tlabel\tinstruction\tfirst\tsecond" << std::endl;
+
+        for(unsigned int k(0) ; k < generic.size() ; ++k)
+        {
+            unsigned int i = generic[k];
+            const runtime::instruction& current = resolved.instructions[i];
+
+            stream << i << "\t";
+
+            if(resolved.debug.lines.empty())
+                stream << "-\t-\t";
+            else
+                stream << resolved.debug.lines[i] << "\t" << (resolved.debug.label_of(resolved.debug.lines[i]).empty() ? "-" : resolved.debug.label_of(resolved.debug.lines[i])) << "\t";
+
+            stream << runtime::print_opcode(runtime::generic_opcode(current.op)) << " ";
+            dump_argument(resolved, current.f_slot, stream);
+            stream << ", ";
+            dump_argument(resolved, current.s_slot, stream);
+            stream << "\t";
+            print_types(sites[i].first, stream);
+            stream << "\t";
+            print_types(sites[i].second, stream);
+            stream << std::endl;
+        }
+    }
+
+} // types namespace.
+
+/*
+    Superinstructions pass, run just before the runtime.
+
+    Recognizes common sequences of instructions and replaces the opcode of the first one by a superinstruction,
+    which executes the whole sequence with a single dispatch and reads the arguments of the next instructions.
+    The other instructions are kept in place : a jump in the middle of a sequence still works and no jump target changes.
+*/
+void fuse(runtime::program& resolved)
+{
+    std::vector<runtime::instruction>& instructions = resolved.instructions;
+
+    // Going forward, the next instructions still have their original opcode when a sequence is matched.
+    // A superinstruction takes the place of a specialized instruction : the next ones stay specialized, for the jumps in the middle.
+    for(unsigned int i(0) ; i + 1 < instructions.size() ; ++i)
+    {
+        runtime::opcode first = runtime::generic_opcode(instructions[i].op), second = runtime::generic_opcode(instructions[i + 1].op);
+        runtime::opcode third = (i + 2 < instructions.size()) ? runtime::generic_opcode(instructions[i + 2].op) : runtime::NONE;
+
+        // add, cmp_eq, jz|jnz.
+        if(first == runtime::ADD && second == runtime::CMP_EQ && third == runtime::JZ)
+            instructions[i].op = runtime::ADD_CMP_EQ_JZ;
+        else if(first == runtime::ADD && second == runtime::CMP_EQ && third == runtime::JNZ)
+            instructions[i].op = runtime::ADD_CMP_EQ_JNZ;
+        // mov x, a then add x, b.
+        else if(first == runtime::MOV && second == runtime::ADD && instructions[i].f_slot == instructions[i + 1].f_slot)
+            instructions[i].op = runtime::MOV_ADD;
+        // cmp_*, jz|jnz.
+        else if(first == runtime::CMP_EQ && second == runtime::JZ)
+            instructions[i].op = runtime::CMP_EQ_JZ;
+        else if(first == runtime::CMP_EQ && second == runtime::JNZ)
+            instructions[i].op = runtime::CMP_EQ_JNZ;
+        else if(first == runtime::CMP_GT && second == runtime::JZ)
+            instructions[i].op = runtime::CMP_GT_JZ;
+        else if(first == runtime::CMP_GT && second == runtime::JNZ)
+            instructions[i].op = runtime::CMP_GT_JNZ;
+        else if(first == runtime::CMP_LT && second == runtime::JZ)
+            instructions[i].op = runtime::CMP_LT_JZ;
+        else if(first == runtime::CMP_LT && second == runtime::JNZ)
+            instructions[i].op = runtime::CMP_LT_JNZ;
+    }
+}
+
+/*
+    JIT compiler for the loops which only compute numbers (mov, add, mul, neg, cmp_* and jumps).
+
+    Each loop is compiled to native x86-64 code working directly on the register file, and a JIT_LOOP instruction is inserted before it.
+    When the runtime reaches JIT_LOOP, the native code checks that the variables read by the loop hold numbers, runs the loop,
+    and returns the index of the next instruction : the runtime goes on from there. If a check fails, the loop is interpreted.
+    Integers and floating numbers are computed inline, any other case (mixed types, integer overflow) calls the function of the runtime.
+    The values are always stored back in the register file, so leaving the native code at any instruction is safe.
+*/
+namespace jit
+{
+#ifdef SMALLTHINK_JIT
+    /* Native code of the compiled loops, in executable memory. */
+    class executable_memory
+    {
+        public:
+            executable_memory() : m_data(nullptr), m_size(0)
+            {
+            }
+
+            ~executable_memory()
+            {
+                if(m_data)
+                    munmap(m_data, m_size);
+            }
+
+            /* Copies the code in executable memory. Returns false if the memory can not be mapped. */
+            bool load(const std::vector<unsigned char>& code)
+            {
+                void* address = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                if(address == MAP_FAILED)
+                    return false;
+
+                std::memcpy(address, code.data(), code.size());
+
+                // The code is never written again.
+                if(mprotect(address, code.size(), PROT_READ | PROT_EXEC) != 0)
+                {
+                    munmap(address, code.size());
+                    return false;
+                }
+
+                m_data = address;
+                m_size = code.size();
+
+                return true;
+            }
+
+            const unsigned char* data() const
+            {
+                return static_cast<const unsigned char*>(m_data);
+            }
+
+        private:
+            // Not copyable, the mapping is owned.
+            executable_memory(const executable_memory&);
+            executable_memory& operator=(const executable_memory&);
+
+            void* m_data;
+            std::size_t m_size;
+    };
+
+    /* Conditions of the jumps, prefixed by CC_ (CONDITION CODE_). The values are the x86 condition codes. */
+    enum condition_code
+    {
+        CC_OVERFLOW = 0x0,
+        CC_EQUAL = 0x4,
+        CC_NOT_EQUAL = 0x5,
+        CC_ABOVE = 0x7,
+        CC_LESS = 0xC,
+        CC_GREATER = 0xF,
+        CC_ALWAYS = 0x10
+    };
+
+    /* x86-64 registers used by the JIT. */
+    enum register_code
+    {
+        REG_RAX = 0,
+        REG_RSI = 6,
+        REG_RDI = 7
+    };
+
+    /*
+        Minimal x86-64 assembler : only the instructions needed by the JIT.
+        Memory operands are always [rbx + displacement] : rbx holds the address of the register file.
+    */
+    class assembler
+    {
+        public:
+            unsigned int new_label()
+            {
+                m_labels.push_back(std::numeric_limits<std::size_t>::max());
+                return static_cast<unsigned int>(m_labels.size() - 1);
+            }
+
+            void bind(unsigned int label)
+            {
+                m_labels[label] = m_code.size();
+            }
+
+            std::size_t position() const
+            {
+                return m_code.size();
+            }
+
+            /* Resolves the jumps once every label is bound, and returns the code. */
+            const std::vector<unsigned char>& finish()
+            {
+                for(unsigned int i(0) ; i < m_fixups.size() ; ++i)
+                {
+                    std::int32_t relative = static_cast<std::int32_t>(m_labels[m_fixups[i].second] - (m_fixups[i].first + 4));
+                    std::memcpy(&m_code[m_fixups[i].first], &relative, sizeof(relative));
+                }
+
+                m_fixups.clear();
+
+                return m_code;
+            }
+
+            // push rbx ; mov rbx, rdi
+            void prologue()
+            {
+                emit({0x53, 0x48, 0x89, 0xFB});
+            }
+
+            // mov eax, value ; pop rbx ; ret
+            void leave(unsigned int value)
+            {
+                emit({0xB8});
+                immediate32(static_cast<std::int32_t>(value));
+                emit({0x5B, 0xC3});
+            }
+
+            // jmp label, or jcc label.
+            void jump(condition_code condition, unsigned int label)
+            {
+                if(condition == CC_ALWAYS)
+                    emit({0xE9});
+                else
+                    emit({0x0F, static_cast<unsigned char>(0x80 | condition)});
+
+                m_fixups.push_back(std::make_pair(m_code.size(), label));
+                immediate32(0);
+            }
+
+            // cmp dword [rbx + displacement], value
+            void compare_dword(std::int32_t displacement, std::int32_t value)
+            {
+                memory({0x81}, 7, displacement);
+                immediate32(value);
+            }
+
+            // cmp qword [rbx + displacement], 0
+            void compare_qword_zero(std::int32_t displacement)
+            {
+                memory({0x48, 0x83}, 7, displacement);
+                emit({0x00});
+            }
+
+            // mov dword [rbx + displacement], value
+            void store_dword(std::int32_t displacement, std::int32_t value)
+            {
+                memory({0xC7}, 0, displacement);
+                immediate32(value);
+            }
+
+            // mov eax, [rbx + displacement]
+            void load_eax(std::int32_t displacement)
+            {
+                memory({0x8B}, REG_RAX, displacement);
+            }
+
+            // mov [rbx + displacement], eax
+            void store_eax(std::int32_t displacement)
+            {
+                memory({0x89}, REG_RAX, displacement);
+            }
+
+            // mov rax, [rbx + displacement]
+            void load_rax(std::int32_t displacement)
+            {
+                memory({0x48, 0x8B}, REG_RAX, displacement);
+            }
+
+            // mov [rbx + displacement], rax
+            void store_rax(std::int32_t displacement)
+            {
+                memory({0x48, 0x89}, REG_RAX, displacement);
+            }
+
+            // add rax, [rbx + displacement]
+            void add_rax(std::int32_t displacement)
+            {
+                memory({0x48, 0x03}, REG_RAX, displacement);
+            }
+
+            // imul rax, [rbx + displacement]
+            void imul_rax(std::int32_t displacement)
+            {
+                memory({0x48, 0x0F, 0xAF}, REG_RAX, displacement);
+            }
+
+            // cmp rax, [rbx + displacement]
+            void compare_rax(std::int32_t displacement)
+            {
+                memory({0x48, 0x3B}, REG_RAX, displacement);
+            }
+
+            // neg rax
+            void negate_rax()
+            {
+                emit({0x48, 0xF7, 0xD8});
+            }
+
+            // btc rax, 63 : flips the sign of a floating number.
+            void flip_sign_rax()
+            {
+                emit({0x48, 0x0F, 0xBA, 0xF8, 0x3F});
+            }
+
+            // movsd xmm0, [rbx + displacement]
+            void load_xmm0(std::int32_t displacement)
+            {
+                memory({0xF2, 0x0F, 0x10}, 0, displacement);
+            }
+
+            // movsd [rbx + displacement], xmm0
+            void store_xmm0(std::int32_t displacement)
+            {
+                memory({0xF2, 0x0F, 0x11}, 0, displacement);
+            }
+
+            // addsd xmm0, [rbx + displacement]
+            void add_xmm0(std::int32_t displacement)
+            {
+                memory({0xF2, 0x0F, 0x58}, 0, displacement);
+            }
+
+            // mulsd xmm0, [rbx + displacement]
+            void mul_xmm0(std::int32_t displacement)
+            {
+                memory({0xF2, 0x0F, 0x59}, 0, displacement);
+            }
+
+            // ucomisd xmm0, [rbx + displacement] : equal or unordered sets ZF.
+            void compare_xmm0(std::int32_t displacement)
+            {
+                memory({0x66, 0x0F, 0x2E}, 0, displacement);
+            }
+
+            // setcc al
+            void set_al(condition_code condition)
+            {
+                emit({0x0F, static_cast<unsigned char>(0x90 | condition), 0xC0});
+            }
+
+            // movzx eax, al
+            void extend_al()
+            {
+                emit({0x0F, 0xB6, 0xC0});
+            }
+
+            // test eax, eax
+            void test_eax()
+            {
+                emit({0x85, 0xC0});
+            }
+
+            // lea reg, [rbx + displacement]
+            void address(register_code reg, std::int32_t displacement)
+            {
+                memory({0x48, 0x8D}, reg, displacement);
+            }
+
+            // mov rax, function ; call rax
+            void call(std::uintptr_t function)
+            {
+                emit({0x48, 0xB8});
+
+                for(unsigned int i(0) ; i < 8 ; ++i)
+                    m_code.push_back(static_cast<unsigned char>((static_cast<std::uint64_t>(function) >> (8 * i)) & 0xFF));
+
+                emit({0xFF, 0xD0});
+            }
+
+        private:
+            void emit(std::initializer_list<unsigned char> bytes)
+            {
+                m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+            }
+
+            void immediate32(std::int32_t value)
+            {
+                unsigned char bytes[4];
+                std::memcpy(bytes, &value, sizeof(value));
+                m_code.insert(m_code.end(), bytes, bytes + 4);
+            }
+
+            // Opcode, then ModRM for [rbx + disp32] (mod 10, rm 011) and the displacement.
+            void memory(std::initializer_list<unsigned char> opcode, unsigned int reg, std::int32_t displacement)
+            {
+                emit(opcode);
+                m_code.push_back(static_cast<unsigned char>(0x80 | (reg << 3) | 0x3));
+                immediate32(displacement);
+            }
+
+            std::vector<unsigned char> m_code;
+            std::vector<std::size_t> m_labels;
+            std::vector<std::pair<std::size_t, unsigned int> > m_fixups;
+    };
+
+    /* Runtime functions called by the native code for the cases it does not compute inline. */
+    void add_helper(runtime::dynamic_variable* first, const runtime::dynamic_variable* second)
+    {
+        runtime::add(*first, *second);
+    }
+
+    void mul_helper(runtime::dynamic_variable* first, const runtime::dynamic_variable* second)
+    {
+        runtime::mul(*first, *second);
+    }
+
+    void neg_helper(runtime::dynamic_variable* variable)
+    {
+        runtime::neg(*variable);
+    }
+
+    int equals_helper(const runtime::dynamic_variable* first, const runtime::dynamic_variable* second)
+    {
+        return runtime::equals(*first, *second) ? 1 : 0;
+    }
+
+    int greater_helper(const runtime::dynamic_variable* first, const runtime::dynamic_variable* second)
+    {
+        return runtime::greater(*first, *second) ? 1 : 0;
+    }
+
+    int less_helper(const runtime::dynamic_variable* first, const runtime::dynamic_variable* second)
+    {
+        return runtime::less(*first, *second) ? 1 : 0;
+    }
+
+    int truth_helper(const runtime::dynamic_variable* variable)
+    {
+        return runtime::to_integer(*variable) != 0 ? 1 : 0;
+    }
+
+    /* Compiles the loops of one program. */
+    class compiler
+    {
+        public:
+            explicit compiler(const runtime::program& resolved) : m_program(resolved)
+            {
+                runtime::dynamic_variable probe;
+                const char* base = reinterpret_cast<const char*>(&probe);
+
+                m_type_offset = static_cast<std::int32_t>(reinterpret_cast<const char*>(&probe.type) - base);
+                m_payload_offset = static_cast<std::int32_t>(reinterpret_cast<const char*>(&probe.integer) - base);
+            }
+
+            /* Returns true if the JIT can compile the instruction. Arithmetic reads numbers and only writes variables. */
+            bool is_compilable(const runtime::instruction& current) const
+            {
+                switch(current.op)
+                {
+                    case runtime::MOV:
+                    case runtime::ADD:
+                    case runtime::MUL:
+                        return is_variable(current.f_slot) && (is_variable(current.s_slot) || runtime::is_numeric(m_program.memory[current.s_slot]));
+                    case runtime::NEG:
+                        return is_variable(current.f_slot);
+                    case runtime::CMP_EQ:
+                    case runtime::CMP_GT:
+                    case runtime::CMP_LT:
+                        return (is_variable(current.f_slot) || runtime::is_numeric(m_program.memory[current.f_slot]))
+                            && (is_variable(current.s_slot) || runtime::is_numeric(m_program.memory[current.s_slot]));
+                    case runtime::JMP:
+                    case runtime::JZ:
+                    case runtime::JNZ:
+                        return true;
+                    case runtime::OUT:
+                    case runtime::IN:
+                    case runtime::GET:
+                    case runtime::STOP:
+                    case runtime::FLUSH:
+                    case runtime::LABEL:
+                    case runtime::NUM:
+                    case runtime::STR:
+                    case runtime::NUM_INT:
+                    case runtime::SEED_RANDOM:
+                    case runtime::FLUSH_OUT:
+                    case runtime::ARRAY_NEW:
+                    case runtime::ARRAY_RESIZE:
+                    case runtime::ARRAY_LEN:
+                    case runtime::ARRAY_GET:
+                    case runtime::ARRAY_SET:
+                    case runtime::ARRAY_SUM:
+                    case runtime::ARRAY_MIN:
+                    case runtime::ARRAY_MAX:
+                    case runtime::ARRAY_SCALE:
+                    case runtime::ARRAY_ADD:
+                    case runtime::ARRAY_DOT:
+                    case runtime::ARRAY_SORT:
+                    case runtime::MAP_NEW:
+                    case runtime::MAP_PUT:
+                    case runtime::MAP_GET:
+                    case runtime::MAP_HAS:
+                    case runtime::MAP_DEL:
+                    case runtime::MAP_LEN:
+                    case runtime::MAP_NEXT:
+                    case runtime::OUT_ENDLINE:
+                    case runtime::ADD_NUMBER:
+                    case runtime::ADD_STRING:
+                    case runtime::MUL_NUMBER:
+                    case runtime::MUL_STRING:
+                    case runtime::CMP_EQ_NUMBER:
+                    case runtime::CMP_EQ_STRING:
+                    case runtime::CMP_GT_NUMBER:
+                    case runtime::CMP_GT_STRING:
+                    case runtime::CMP_LT_NUMBER:
+                    case runtime::CMP_LT_STRING:
+                    case runtime::JZ_FLAG:
+                    case runtime::JNZ_FLAG:
+                    case runtime::CMP_EQ_JZ:
+                    case runtime::CMP_EQ_JNZ:
+                    case runtime::CMP_GT_JZ:
+                    case runtime::CMP_GT_JNZ:
+                    case runtime::CMP_LT_JZ:
+                    case runtime::CMP_LT_JNZ:
+                    case runtime::MOV_ADD:
+                    case runtime::ADD_CMP_EQ_JZ:
+                    case runtime::ADD_CMP_EQ_JNZ:
+                    case runtime::JIT_LOOP:
+                    case runtime::TRACE_LOOP:
+                    case runtime::NONE:
+                    default:
+                        return false;
+                }
+            }
+
+            /*
+                Compiles the loop [first, last] (first is the instruction after its JIT_LOOP).
+                Returns the position of its entry in the code.
+            */
+            std::size_t compile(unsigned int first, unsigned int last)
+            {
+                const std::vector<runtime::instruction>& instructions = m_program.instructions;
+
+                m_first = first;
+                m_last = last;
+                m_exits.clear();
+                m_labels.clear();
+
+                for(unsigned int i(first) ; i <= last ; ++i)
+                    m_labels.push_back(m_code.new_label());
+
+                std::size_t entry = m_code.position();
+                m_code.prologue();
+
+                // The variables read before being written must hold numbers, else the loop is interpreted.
+                std::vector<unsigned int> checked = read_first();
+
+                for(unsigned int k(0) ; k < checked.size() ; ++k)
+                {
+                    unsigned int is_number = m_code.new_label();
+
+                    m_code.compare_dword(type(checked[k]), runtime::DVT_INTEGER);
+                    m_code.jump(CC_EQUAL, is_number);
+                    m_code.compare_dword(type(checked[k]), runtime::DVT_NUMERIC);
+                    m_code.jump(CC_NOT_EQUAL, exit(first));
+                    m_code.bind(is_number);
+                }
+
+                for(unsigned int i(first) ; i <= last ; ++i)
+                {
+                    m_code.bind(m_labels[i - first]);
+                    emit(instructions[i]);
+                }
+
+                m_code.jump(CC_ALWAYS, exit(last + 1));
+
+                for(std::map<unsigned int, unsigned int>::const_iterator it = m_exits.begin() ; it != m_exits.end() ; ++it)
+                {
+                    m_code.bind(it->second);
+                    m_code.leave(it->first);
+                }
+
+                return entry;
+            }
+
+            const std::vector<unsigned char>& finish()
+            {
+                return m_code.finish();
+            }
+
+        private:
+            bool is_variable(unsigned int slot) const
+            {
+                return !m_program.names[slot].empty();
+            }
+
+            std::int32_t type(unsigned int slot) const
+            {
+                return static_cast<std::int32_t>(slot * sizeof(runtime::dynamic_variable)) + m_type_offset;
+            }
+
+            std::int32_t payload(unsigned int slot) const
+            {
+                return static_cast<std::int32_t>(slot * sizeof(runtime::dynamic_variable)) + m_payload_offset;
+            }
+
+            /* Label leaving the native code, the runtime goes on at the given instruction. */
+            unsigned int exit(unsigned int cip)
+            {
+                std::map<unsigned int, unsigned int>::const_iterator found = m_exits.find(cip);
+
+                if(found != m_exits.end())
+                    return found->second;
+
+                return m_exits[cip] = m_code.new_label();
+            }
+
+            /* Label of a jump target : inside of the loop, or leaving it. The JIT_LOOP before the loop is its first instruction. */
+            unsigned int target(unsigned int cip)
+            {
+                if(cip + 1 == m_first)
+                    cip = m_first;
+
+                if(cip >= m_first && cip <= m_last)
+                    return m_labels[cip - m_first];
+
+                return exit(cip);
+            }
+
+            /* Variables of the loop which may be read before being written, from its first instruction. */
+            std::vector<unsigned int> read_first() const
+            {
+                const std::vector<runtime::instruction>& instructions = m_program.instructions;
+                std::vector<unsigned int> slots, result;
+
+                for(unsigned int i(m_first) ; i <= m_last ; ++i)
+                {
+                    optimizer::effects current = optimizer::get_effects(instructions[i]);
+
+                    for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                        if(is_variable(current.uses[u]) && std::find(slots.begin(), slots.end(), current.uses[u]) == slots.end())
+                            slots.push_back(current.uses[u]);
+                }
+
+                // For each variable, a walk from the first instruction which stops on writes.
+                for(unsigned int k(0) ; k < slots.size() ; ++k)
+                {
+                    std::vector<bool> visited(m_last - m_first + 1, false);
+                    std::vector<unsigned int> worklist(1, m_first);
+                    bool read(false);
+
+                    while(!worklist.empty() && !read)
+                    {
+                        unsigned int i = worklist.back();
+                        worklist.pop_back();
+
+                        if(i < m_first || i > m_last || visited[i - m_first])
+                            continue;
+
+                        visited[i - m_first] = true;
+                        optimizer::effects current = optimizer::get_effects(instructions[i]);
+
+                        for(unsigned int u(0) ; u < current.uses_count ; ++u)
+                            if(current.uses[u] == slots[k])
+                                read = true;
+
+                        bool written(false);
+
+                        for(unsigned int d(0) ; d < current.defs_count ; ++d)
+                            if(current.defs[d] == slots[k])
+                                written = true;
+
+                        if(written)
+                            continue;
+
+                        if(optimizer::is_jump(instructions[i].op))
+                            worklist.push_back(instructions[i].target + 1 == m_first ? m_first : instructions[i].target);
+
+                        if(instructions[i].op != runtime::JMP)
+                            worklist.push_back(i + 1);
+                    }
+
+                    if(read)
+                        result.push_back(slots[k]);
+                }
+
+                return result;
+            }
+
+            /* Calls a runtime function with the addresses of two slots. */
+            void call(std::uintptr_t function, unsigned int f_slot, unsigned int s_slot)
+            {
+                m_code.address(REG_RDI, payload(f_slot) - m_payload_offset);
+                m_code.address(REG_RSI, payload(s_slot) - m_payload_offset);
+                m_code.call(function);
+            }
+
+            /* Stores the comparison result (in al) in cmp_register. */
+            void store_comparison()
+            {
+                m_code.extend_al();
+                m_code.store_rax(payload(runtime::SLOT_CMP_REGISTER));
+                m_code.store_dword(type(runtime::SLOT_CMP_REGISTER), runtime::DVT_INTEGER);
+            }
+
+            void emit(const runtime::instruction& current)
+            {
+                unsigned int f_slot = current.f_slot, s_slot = current.s_slot;
+
+                switch(current.op)
+                {
+                    case runtime::MOV:
+                        m_code.load_eax(type(s_slot));
+                        m_code.store_eax(type(f_slot));
+                        m_code.load_rax(payload(s_slot));
+                        m_code.store_rax(payload(f_slot));
+                        break;
+                    case runtime::ADD:
+                    case runtime::MUL:
+                    {
+                        unsigned int floating = m_code.new_label(), slow = m_code.new_label(), done = m_code.new_label();
+
+                        m_code.compare_dword(type(f_slot), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, floating);
+                        m_code.compare_dword(type(s_slot), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, slow);
+                        m_code.load_rax(payload(f_slot));
+
+                        if(current.op == runtime::ADD)
+                            m_code.add_rax(payload(s_slot));
+                        else
+                            m_code.imul_rax(payload(s_slot));
+
+                        m_code.jump(CC_OVERFLOW, slow);
+                        m_code.store_rax(payload(f_slot));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        m_code.bind(floating);
+                        m_code.compare_dword(type(s_slot), runtime::DVT_NUMERIC);
+                        m_code.jump(CC_NOT_EQUAL, slow);
+                        m_code.load_xmm0(payload(f_slot));
+
+                        if(current.op == runtime::ADD)
+                            m_code.add_xmm0(payload(s_slot));
+                        else
+                            m_code.mul_xmm0(payload(s_slot));
+
+                        m_code.store_xmm0(payload(f_slot));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        // Mixed types and integer overflow.
+                        m_code.bind(slow);
+                        call(reinterpret_cast<std::uintptr_t>(current.op == runtime::ADD ? &add_helper : &mul_helper), f_slot, s_slot);
+                        m_code.bind(done);
+                        break;
+                    }
+                    case runtime::NEG:
+                    {
+                        unsigned int floating = m_code.new_label(), slow = m_code.new_label(), done = m_code.new_label();
+
+                        m_code.compare_dword(type(f_slot), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, floating);
+                        m_code.load_rax(payload(f_slot));
+                        m_code.negate_rax();
+                        m_code.jump(CC_OVERFLOW, slow);
+                        m_code.store_rax(payload(f_slot));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        m_code.bind(floating);
+                        m_code.load_rax(payload(f_slot));
+                        m_code.flip_sign_rax();
+                        m_code.store_rax(payload(f_slot));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        m_code.bind(slow);
+                        call(reinterpret_cast<std::uintptr_t>(&neg_helper), f_slot, f_slot);
+                        m_code.bind(done);
+                        break;
+                    }
+                    case runtime::CMP_EQ:
+                    case runtime::CMP_GT:
+                    case runtime::CMP_LT:
+                    {
+                        unsigned int floating = m_code.new_label(), slow = m_code.new_label(), done = m_code.new_label();
+
+                        m_code.compare_dword(type(f_slot), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, floating);
+                        m_code.compare_dword(type(s_slot), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, slow);
+                        m_code.load_rax(payload(f_slot));
+                        m_code.compare_rax(payload(s_slot));
+                        m_code.set_al(current.op == runtime::CMP_EQ ? CC_EQUAL : (current.op == runtime::CMP_GT ? CC_GREATER : CC_LESS));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        // Two floating numbers are equal if none is lower than the other : unordered is equal too.
+                        // Unordered is neither greater nor less : first > second is tested as "above", and first < second as second "above" first.
+                        m_code.bind(floating);
+                        m_code.compare_dword(type(s_slot), runtime::DVT_NUMERIC);
+                        m_code.jump(CC_NOT_EQUAL, slow);
+
+                        if(current.op == runtime::CMP_LT)
+                        {
+                            m_code.load_xmm0(payload(s_slot));
+                            m_code.compare_xmm0(payload(f_slot));
+                        }
+                        else
+                        {
+                            m_code.load_xmm0(payload(f_slot));
+                            m_code.compare_xmm0(payload(s_slot));
+                        }
+
+                        m_code.set_al(current.op == runtime::CMP_EQ ? CC_EQUAL : CC_ABOVE);
+                        m_code.jump(CC_ALWAYS, done);
+
+                        // Mixed types and strings.
+                        m_code.bind(slow);
+
+                        if(current.op == runtime::CMP_EQ)
+                            call(reinterpret_cast<std::uintptr_t>(&equals_helper), f_slot, s_slot);
+                        else
+                            call(reinterpret_cast<std::uintptr_t>(current.op == runtime::CMP_GT ? &greater_helper : &less_helper), f_slot, s_slot);
+
+                        m_code.bind(done);
+                        store_comparison();
+                        break;
+                    }
+                    case runtime::JMP:
+                        m_code.jump(CC_ALWAYS, target(current.target));
+                        break;
+                    case runtime::JZ:
+                    case runtime::JNZ:
+                    {
+                        condition_code taken = (current.op == runtime::JZ) ? CC_EQUAL : CC_NOT_EQUAL;
+                        unsigned int slow = m_code.new_label(), done = m_code.new_label();
+
+                        m_code.compare_dword(type(runtime::SLOT_CMP_REGISTER), runtime::DVT_INTEGER);
+                        m_code.jump(CC_NOT_EQUAL, slow);
+                        m_code.compare_qword_zero(payload(runtime::SLOT_CMP_REGISTER));
+                        m_code.jump(taken, target(current.target));
+                        m_code.jump(CC_ALWAYS, done);
+
+                        m_code.bind(slow);
+                        call(reinterpret_cast<std::uintptr_t>(&truth_helper), runtime::SLOT_CMP_REGISTER, runtime::SLOT_CMP_REGISTER);
+                        m_code.test_eax();
+                        m_code.jump(taken, target(current.target));
+                        m_code.bind(done);
+                        break;
+                    }
+                    case runtime::OUT:
+                    case runtime::IN:
+                    case runtime::GET:
+                    case runtime::STOP:
+                    case runtime::FLUSH:
+                    case runtime::LABEL:
+                    case runtime::NUM:
+                    case runtime::STR:
+                    case runtime::NUM_INT:
+                    case runtime::SEED_RANDOM:
+                    case runtime::FLUSH_OUT:
+                    case runtime::ARRAY_NEW:
+                    case runtime::ARRAY_RESIZE:
+                    case runtime::ARRAY_LEN:
+                    case runtime::ARRAY_GET:
+                    case runtime::ARRAY_SET:
+                    case runtime::ARRAY_SUM:
+                    case runtime::ARRAY_MIN:
+                    case runtime::ARRAY_MAX:
+                    case runtime::ARRAY_SCALE:
+                    case runtime::ARRAY_ADD:
+                    case runtime::ARRAY_DOT:
+                    case runtime::ARRAY_SORT:
+                    case runtime::MAP_NEW:
+                    case runtime::MAP_PUT:
+                    case runtime::MAP_GET:
+                    case runtime::MAP_HAS:
+                    case runtime::MAP_DEL:
+                    case runtime::MAP_LEN:
+                    case runtime::MAP_NEXT:
+                    case runtime::OUT_ENDLINE:
+                    case runtime::ADD_NUMBER:
+                    case runtime::ADD_STRING:
+                    case runtime::MUL_NUMBER:
+                    case runtime::MUL_STRING:
+                    case runtime::CMP_EQ_NUMBER:
+                    case runtime::CMP_EQ_STRING:
+                    case runtime::CMP_GT_NUMBER:
+                    case runtime::CMP_GT_STRING:
+                    case runtime::CMP_LT_NUMBER:
+                    case runtime::CMP_LT_STRING:
+                    case runtime::JZ_FLAG:
+                    case runtime::JNZ_FLAG:
+                    case runtime::CMP_EQ_JZ:
+                    case runtime::CMP_EQ_JNZ:
+                    case runtime::CMP_GT_JZ:
+                    case runtime::CMP_GT_JNZ:
+                    case runtime::CMP_LT_JZ:
+                    case runtime::CMP_LT_JNZ:
+                    case runtime::MOV_ADD:
+                    case runtime::ADD_CMP_EQ_JZ:
+                    case runtime::ADD_CMP_EQ_JNZ:
+                    case runtime::JIT_LOOP:
+                    case runtime::TRACE_LOOP:
+                    case runtime::NONE:
+                    default:
+                        break;
+                }
+            }
+
+            const runtime::program& m_program;
+            assembler m_code;
+            std::int32_t m_type_offset;
+            std::int32_t m_payload_offset;
+
+            // Loop being compiled.
+            unsigned int m_first;
+            unsigned int m_last;
+            std::vector<unsigned int> m_labels;
+            std::map<unsigned int, unsigned int> m_exits;
+    };
+#else
+    /* No JIT on this platform. */
+    class executable_memory
+    {
+    };
+#endif
+
+    /*
+        Compiles the loops of the program which only compute numbers, and inserts a JIT_LOOP instruction before each of them.
+        A loop is the instructions between a backward jump and its target. The largest loops are compiled first, without overlapping.
+        Returns false if nothing was compiled.
+    */
+    bool compile(runtime::program& resolved, executable_memory& native_code)
+    {
+#ifdef SMALLTHINK_JIT
+        std::vector<runtime::instruction>& instructions = resolved.instructions;
+        const unsigned int size = static_cast<unsigned int>(instructions.size());
+
+        // The native code reads the type as a 32 bits integer, and addresses the register file with 32 bits displacements.
+        if(sizeof(runtime::dynamic_variable_type) != 4 || resolved.memory.size() >= static_cast<std::size_t>(INT_MAX) / sizeof(runtime::dynamic_variable))
+            return false;
+
+        std::vector<unsigned int> not_compilable_before(size + 1, 0);
+
+        {
+            compiler checker(resolved);
+
+            for(unsigned int i(0) ; i < size ; ++i)
+                not_compilable_before[i + 1] = not_compilable_before[i] + (checker.is_compilable(instructions[i]) ? 0 : 1);
+        }
+
+        std::vector<std::pair<unsigned int, unsigned int> > candidates;
+
+        for(unsigned int i(0) ; i < size ; ++i)
+            if(optimizer::is_jump(instructions[i].op) && instructions[i].target <= i && not_compilable_before[i + 1] == not_compilable_before[instructions[i].target])
+                candidates.push_back(std::make_pair(i - instructions[i].target, instructions[i].target));
+
+        std::sort(candidates.rbegin(), candidates.rend());
+
+        std::vector<bool> taken(size, false);
+        std::vector<unsigned int> loop_of(size, optimizer::none), first(size, 0);
+        std::vector<std::pair<unsigned int, unsigned int> > loops;
+
+        for(unsigned int c(0) ; c < candidates.size() ; ++c)
+        {
+            unsigned int start = candidates[c].second, end = start + candidates[c].first;
+            bool free(true);
+
+            for(unsigned int i(start) ; i <= end && free ; ++i)
+                free = !taken[i];
+
+            if(!free)
+                continue;
+
+            for(unsigned int i(start) ; i <= end ; ++i)
+                taken[i] = true;
+
+            loops.push_back(std::make_pair(start, end));
+        }
+
+        if(loops.empty())
+            return false;
+
+        std::sort(loops.begin(), loops.end());
+
+        for(unsigned int l(0) ; l < loops.size() ; ++l)
+            loop_of[loops[l].first] = l;
+
+        // JIT_LOOP instructions : the jumps to a loop now go to its JIT_LOOP, its back edges too.
+        std::vector<runtime::instruction> with_loops;
+        std::vector<unsigned int> with_loops_lines;
+        std::vector<unsigned int> new_index(size + 1, 0), position(size, 0);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+        {
+            new_index[i] = static_cast<unsigned int>(with_loops.size());
+
+            if(loop_of[i] != optimizer::none)
+            {
+                runtime::instruction enter = {runtime::JIT_LOOP, runtime::AK_NONE, runtime::AK_NONE, 0, 0, loop_of[i]};
+                with_loops.push_back(enter);
+
+                // A JIT_LOOP is on the line of the first instruction of its loop.
+                if(!resolved.debug.lines.empty())
+                    with_loops_lines.push_back(resolved.debug.lines[i]);
+            }
+
+            position[i] = static_cast<unsigned int>(with_loops.size());
+            with_loops.push_back(instructions[i]);
+
+            if(!resolved.debug.lines.empty())
+                with_loops_lines.push_back(resolved.debug.lines[i]);
+        }
+
+        new_index[size] = static_cast<unsigned int>(with_loops.size());
+
+        for(unsigned int i(0) ; i < with_loops.size() ; ++i)
+            if(optimizer::is_jump(with_loops[i].op))
+                with_loops[i].target = new_index[with_loops[i].target];
+
+        instructions.swap(with_loops);
+
+        compiler native(resolved);
+        std::vector<std::size_t> entries;
+
+        for(unsigned int l(0) ; l < loops.size() ; ++l)
+            entries.push_back(native.compile(position[loops[l].first], position[loops[l].second]));
+
+        if(!native_code.load(native.finish()))
+        {
+            // The program is left as it was.
+            instructions.swap(with_loops);
+            return false;
+        }
+
+        resolved.native_loops.resize(loops.size());
+        resolved.debug.lines.swap(with_loops_lines);
+
+        for(unsigned int l(0) ; l < loops.size() ; ++l)
+        {
+            // Object pointer to function pointer, copied as the standard does not allow a cast.
+            const void* address = native_code.data() + entries[l];
+            std::memcpy(&resolved.native_loops[l], &address, sizeof(address));
+        }
+
+        return true;
+#else
+        (void)resolved;
+        (void)native_code;
+        return false;
+#endif
+    }
+
+} // jit namespace.
+
+/*
+    Tracing tier, a pass run before the JIT (both insert instructions, and the native code returns fixed indices), then a part of the runtime.
+
+    The pass inserts a TRACE_LOOP instruction before each loop the JIT will not compile, and the jumps to the loop now go to it. When the types
+    pass runs, only the loops holding an add, mul or cmp_* it leaves generic are traced : the other ones are as fast in the interpreter.
+    When the runtime reaches TRACE_LOOP, the entries of the loop are counted (its back edges, and the first one). Once the loop is hot,
+    its next iteration is run by the recorder, which notes each instruction done with the types of its arguments : the path taken is a trace.
+    A trace is a straight list of steps : the add, mul and cmp_* are specialized for the types seen, the jmp disappear, and the jz and jnz
+    become exits, which leave the trace when the jump does not go the way it went while recording.
+    A guard checks the types of an argument before the step which reads it, unless an earlier step of the iteration already tells them.
+    The trace then runs the loop, and leaves at the first exit or guard which fails : the variables are always in the register file,
+    so the interpreter goes on from the instruction of the step as if it had run the loop itself.
+    A trace which keeps leaving before a whole iteration is recorded again, a few times, then its loop is left to the interpreter.
+    The traces belong to a run : the program is only read, and virtual machines running at once share nothing.
+*/
+namespace tracing
+{
+    const unsigned int hot_loop = 64; // Entries of a loop before its path is recorded.
+    const unsigned int max_length = 256; // Longest trace, in steps.
+    const unsigned int max_failures = 16; // Entries of a trace left before a whole iteration, before it is recorded again.
+    const unsigned int max_recordings = 4; // Recordings of a loop before it is left to the interpreter.
+
+    // Types of a variable which has been assigned a value, and of one not checked yet. The traces never run the array and map opcodes.
+    const unsigned char defined = types::TS_NUMBER | types::TS_STRING;
+    const unsigned char unknown = defined | types::TS_UNDEFINED | types::TS_ARRAY | types::TS_MAP;
+
+    /* Returns the generic opcode of the first instruction run by an instruction : a superinstruction keeps the next ones in place. */
+    runtime::opcode first_opcode(runtime::opcode op)
+    {
+        switch(op)
+        {
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+                return runtime::CMP_EQ;
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+                return runtime::CMP_GT;
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+                return runtime::CMP_LT;
+            case runtime::MOV_ADD:
+                return runtime::MOV;
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+                return runtime::ADD;
+            case runtime::MOV:
+            case runtime::ADD:
+            case runtime::MUL:
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+            case runtime::NEG:
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+            case runtime::SEED_RANDOM:
+            case runtime::FLUSH_OUT:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                return runtime::generic_opcode(op);
+        }
+    }
+
+    /* Returns true if a trace can run the instruction. stop, seed_random, the array and map opcodes, and the loops of the JIT or of another trace, are left to the interpreter. */
+    bool is_traceable(runtime::opcode op)
+    {
+        switch(first_opcode(op))
+        {
+            case runtime::STOP:
+            case runtime::SEED_RANDOM:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+                return false;
+            case runtime::MOV:
+            case runtime::ADD:
+            case runtime::MUL:
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+            case runtime::NEG:
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+            case runtime::FLUSH_OUT:
+            case runtime::OUT_ENDLINE:
+            case runtime::ADD_NUMBER:
+            case runtime::ADD_STRING:
+            case runtime::MUL_NUMBER:
+            case runtime::MUL_STRING:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_NUMBER:
+            case runtime::CMP_LT_STRING:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::NONE:
+            default:
+                return true;
+        }
+    }
+
+    /* Returns the types an argument must have for a step to run it : the specialized opcodes need their types, the others a defined variable. TS_NONE if it is not read. */
+    unsigned char required(runtime::opcode op, bool second)
+    {
+        switch(op)
+        {
+            case runtime::ADD_NUMBER:
+            case runtime::MUL_NUMBER:
+            case runtime::CMP_EQ_NUMBER:
+            case runtime::CMP_GT_NUMBER:
+            case runtime::CMP_LT_NUMBER:
+                return types::TS_NUMBER;
+            case runtime::CMP_EQ_STRING:
+            case runtime::CMP_GT_STRING:
+            case runtime::CMP_LT_STRING:
+                return types::TS_STRING;
+            case runtime::ADD_STRING:
+            case runtime::MUL_STRING:
+                if(second)
+                    return defined;
+
+                return types::TS_STRING;
+            case runtime::ADD:
+            case runtime::MUL:
+            case runtime::CMP_EQ:
+            case runtime::CMP_GT:
+            case runtime::CMP_LT:
+                return defined;
+            case runtime::MOV:
+                if(second)
+                    return defined;
+
+                return types::TS_NONE;
+            case runtime::NEG:
+            case runtime::OUT:
+            case runtime::IN:
+            case runtime::GET:
+            case runtime::NUM:
+            case runtime::STR:
+            case runtime::NUM_INT:
+                if(second)
+                    return types::TS_NONE;
+
+                return defined;
+            case runtime::STOP:
+            case runtime::FLUSH:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::JNZ:
+            case runtime::JZ:
+            case runtime::SEED_RANDOM:
+            case runtime::FLUSH_OUT:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+            case runtime::OUT_ENDLINE:
+            case runtime::JZ_FLAG:
+            case runtime::JNZ_FLAG:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            case runtime::NONE:
+            default:
+                return types::TS_NONE;
+        }
+    }
+
+    // What a step does to the trace, prefixed by SR_ (STEP_RESULT_).
+    enum step_result
+    {
+        SR_NEXT, // The trace goes on with the next step.
+        SR_EXIT, // An exit whose condition holds : the interpreter goes on from its target.
+        SR_LEAVE // A guard fails, or a string would be too long : it is left as it was, the interpreter runs the instruction again and reports it.
+    };
+
+    /*
+        Runs a step, its arguments having the types it requires, with a single dispatch. The comparisons set the flag and cmp_register,
+        the jz and jnz are the exits of the trace, and a guard is a step whose opcode is NONE.
+    */
+    SMALLTHINK_ALWAYS_INLINE step_result perform(const runtime::instruction& current, runtime::dynamic_variable* memory, input_buffer& input, output_buffer& output, bool& flag)
+    {
+        runtime::dynamic_variable& first = memory[current.f_slot];
+        const runtime::dynamic_variable& second = memory[current.s_slot];
+
+        switch(current.op)
+        {
+            case runtime::NONE:
+                // A type set has the bit 1 << type of each type it holds.
+                return ((1u << first.type) & current.target) != 0 ? SR_NEXT : SR_LEAVE;
+            case runtime::JZ:
+                return (runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) == 0) ? SR_EXIT : SR_NEXT;
+            case runtime::JNZ:
+                return (runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) != 0) ? SR_EXIT : SR_NEXT;
+            case runtime::JZ_FLAG:
+                return flag ? SR_NEXT : SR_EXIT;
+            case runtime::JNZ_FLAG:
+                return flag ? SR_EXIT : SR_NEXT;
+            case runtime::MOV:
+                first = second;
+                break;
+            case runtime::ADD:
+                return runtime::add(first, second) ? SR_NEXT : SR_LEAVE;
+            case runtime::ADD_NUMBER:
+                runtime::add_number(first, second);
+                break;
+            case runtime::ADD_STRING:
+                return runtime::append(first.value, second) ? SR_NEXT : SR_LEAVE;
+            case runtime::MUL:
+                return runtime::mul(first, second) ? SR_NEXT : SR_LEAVE;
+            case runtime::MUL_NUMBER:
+                runtime::mul_number(first, second);
+                break;
+            case runtime::MUL_STRING:
+                return runtime::repeat(first.value, runtime::to_integer(second)) ? SR_NEXT : SR_LEAVE;
+            case runtime::CMP_EQ:
+                flag = runtime::equals(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_EQ_NUMBER:
+                flag = runtime::equals_number(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_EQ_STRING:
+                flag = first.value == second.value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_GT:
+                flag = runtime::greater(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_GT_NUMBER:
+                flag = runtime::greater_number(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_GT_STRING:
+                flag = first.value > second.value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_LT:
+                flag = runtime::less(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_LT_NUMBER:
+                flag = runtime::less_number(first, second);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::CMP_LT_STRING:
+                flag = first.value < second.value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                break;
+            case runtime::NEG:
+                runtime::neg(first);
+                break;
+            case runtime::OUT:
+                runtime::print(output, first);
+                break;
+            case runtime::OUT_ENDLINE:
+                output.newline();
+                break;
+            case runtime::IN:
+                first.type = runtime::DVT_STRING;
+                input.read_word(first.value);
+                break;
+            case runtime::GET:
+                {
+                    int character = input.get();
+                    first.type = runtime::DVT_STRING;
+
+                    if(character < 0)
+                        first.value.clear();
+                    else
+                        first.value.assign(1, static_cast<char>(character));
+                }
+                break;
+            case runtime::FLUSH:
+                input.ignore_line();
+                break;
+            case runtime::FLUSH_OUT:
+                output.flush();
+                break;
+            case runtime::NUM:
+                first = runtime::make_numeric(runtime::to_double(first));
+                break;
+            case runtime::STR:
+                first = runtime::make_string(runtime::to_string(first));
+                break;
+            case runtime::NUM_INT:
+                first = runtime::make_integer(runtime::to_integer(first));
+                break;
+            case runtime::STOP:
+            case runtime::LABEL:
+            case runtime::JMP:
+            case runtime::SEED_RANDOM:
+            case runtime::ARRAY_NEW:
+            case runtime::ARRAY_RESIZE:
+            case runtime::ARRAY_LEN:
+            case runtime::ARRAY_GET:
+            case runtime::ARRAY_SET:
+            case runtime::ARRAY_SUM:
+            case runtime::ARRAY_MIN:
+            case runtime::ARRAY_MAX:
+            case runtime::ARRAY_SCALE:
+            case runtime::ARRAY_ADD:
+            case runtime::ARRAY_DOT:
+            case runtime::ARRAY_SORT:
+            case runtime::MAP_NEW:
+            case runtime::MAP_PUT:
+            case runtime::MAP_GET:
+            case runtime::MAP_HAS:
+            case runtime::MAP_DEL:
+            case runtime::MAP_LEN:
+            case runtime::MAP_NEXT:
+            case runtime::CMP_EQ_JZ:
+            case runtime::CMP_EQ_JNZ:
+            case runtime::CMP_GT_JZ:
+            case runtime::CMP_GT_JNZ:
+            case runtime::CMP_LT_JZ:
+            case runtime::CMP_LT_JNZ:
+            case runtime::MOV_ADD:
+            case runtime::ADD_CMP_EQ_JZ:
+            case runtime::ADD_CMP_EQ_JNZ:
+            case runtime::JIT_LOOP:
+            case runtime::TRACE_LOOP:
+            default:
+                break;
+        }
+
+        return SR_NEXT;
+    }
+
+    /*
+        A step of a trace : an instruction of the loop, specialized for the types seen while recording, or a guard before one. A guard is
+        a NONE instruction which checks the types of its first slot, its target is the type set they must be in.
+    */
+    struct step
+    {
+        runtime::instruction instruction; // A jz or jnz is an exit : it goes to its target when its condition holds, else the trace goes on.
+        unsigned int index; // Instruction of the program, where the interpreter goes on when a guard fails.
+        unsigned int retired; // Instructions retired and branches taken by the iteration before the step, for the counters.
+        unsigned int taken;
+    };
+
+    /*
+        Tracing state of a loop during a run. The trace has two copies of the steps : the first iteration checks the types of what it reads,
+        the next ones start from the types the previous iteration left, so a loop whose types do not change has few guards left.
+    */
+    struct loop
+    {
+        unsigned int entries; // Entries since the last recording.
+        unsigned int failures; // Entries of the trace which left it before a whole iteration.
+        unsigned int recordings;
+        std::vector<step> entry; // The first iteration, empty until the loop is hot.
+        std::vector<step> body; // The next iterations.
+        unsigned int retired; // Instructions retired and branches taken by a whole iteration.
+        unsigned int taken;
+
+        loop() : entries(0), failures(0), recordings(0), retired(0), taken(0)
+        {
+        }
+    };
+
+    /*
+        The tracing tier of a run : it counts, records and runs the loops of the TRACE_LOOP instructions.
+        The instructions of the traces are counted in the counters when given, like the interpreted ones.
+    */
+    class tracer
+    {
+        public:
+            tracer(const runtime::program& resolved, std::vector<runtime::dynamic_variable>& memory, input_buffer& input, output_buffer& output, smallthink::run_counters* counters) : m_resolved(resolved), m_memory(memory), m_input(input), m_output(output), m_counters(counters), m_loops(resolved.traced_loops)
+            {
+            }
+
+            /*
+                Runs the loop of a TRACE_LOOP instruction, by its trace once it is hot. The loop begins at head, just after its TRACE_LOOP.
+                Returns the index of the next instruction to interpret.
+            */
+            unsigned int enter(unsigned int number, unsigned int head)
+            {
+                loop& current = m_loops[number];
+
+                if(!current.entry.empty())
+                    return replay(current);
+
+                if(current.recordings == max_recordings || ++current.entries < hot_loop)
+                    return head;
+
+                return record(current, head);
+            }
+
+        private:
+            /*
+                Runs an iteration of the loop from its first instruction and records it, until the path comes back to the TRACE_LOOP before it.
+                Then runs the trace. An instruction which can not be traced, a variable not assigned yet or a too long trace
+                stop the recording : the interpreter goes on from that instruction, and the loop will be recorded again when hot.
+            */
+            unsigned int record(loop& current, unsigned int head)
+            {
+                const std::vector<runtime::instruction>& instructions = m_resolved.instructions;
+                runtime::dynamic_variable* memory = m_memory.data();
+                std::vector<step> steps;
+                bool flag(false);
+                unsigned int index(head), retired(0), taken(0);
+
+                ++current.recordings;
+                current.entries = 0;
+                current.failures = 0;
+
+                while(index != head - 1)
+                {
+                    if(index >= instructions.size() || steps.size() == max_length || !is_traceable(instructions[index].op))
+                        return stop(retired, taken, index);
+
+                    const runtime::instruction& source = instructions[index];
+                    step recorded = {source, index, retired, taken};
+                    runtime::opcode op = first_opcode(source.op);
+                    unsigned int next = index + 1;
+
+                    if(op == runtime::JMP)
+                    {
+                        next = source.target;
+                    }
+                    else if(op == runtime::JZ || op == runtime::JNZ)
+                    {
+                        // The exit goes where the jump did not go while recording.
+                        bool zero = runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) == 0;
+                        bool jumps = (op == runtime::JZ) == zero;
+
+                        if(jumps)
+                            next = source.target;
+
+                        recorded.instruction.op = (jumps == (op == runtime::JZ)) ? runtime::JNZ : runtime::JZ;
+                        recorded.instruction.target = jumps ? index + 1 : source.target;
+
+                        if(source.target != index + 1)
+                            steps.push_back(recorded);
+                    }
+                    else
+                    {
+                        unsigned char first = types::type_of(memory[source.f_slot]), second = types::type_of(memory[source.s_slot]);
+
+                        // The interpreter reports the variables not assigned yet, and copies or prints the arrays.
+                        if((required(op, false) != types::TS_NONE && (required(op, false) & first) == 0) || (required(op, true) != types::TS_NONE && (required(op, true) & second) == 0))
+                            return stop(retired, taken, index);
+
+                        // Numbers are specialized whether they are integers or floating, an overflow does not leave the trace.
+                        types::site seen = {(first & types::TS_NUMBER) ? static_cast<unsigned char>(types::TS_NUMBER) : first, (second & types::TS_NUMBER) ? static_cast<unsigned char>(types::TS_NUMBER) : second};
+                        recorded.instruction.op = types::specialized(op, seen);
+
+                        if(perform(recorded.instruction, memory, m_input, m_output, flag) == SR_LEAVE)
+                            return stop(retired, taken, index);
+
+                        steps.push_back(recorded);
+                    }
+
+                    ++retired;
+                    taken += (next != index + 1) ? 1 : 0;
+                    index = next;
+                }
+
+                stop(retired, taken, index);
+
+                // A trace made only of jumps never leaves.
+                if(steps.empty())
+                {
+                    current.recordings = max_recordings;
+                    return head;
+                }
+
+                // The constants never change, nothing else is known before the first iteration.
+                std::vector<unsigned char> known(m_memory.size(), unknown);
+
+                for(unsigned int slot(runtime::SLOT_FIRST_FREE) ; slot < known.size() ; ++slot)
+                    if(optimizer::is_constant_slot(m_resolved, slot))
+                        known[slot] = types::type_of(m_resolved.memory[slot]);
+
+                current.entry = steps;
+                place_guards(current.entry, known);
+
+                // The next iterations start from what the first one leaves, if they leave no more than that themselves.
+                std::vector<unsigned char> left = known;
+                current.body.swap(steps);
+                place_guards(current.body, known);
+
+                for(unsigned int slot(0) ; slot < known.size() ; ++slot)
+                    if((known[slot] & ~left[slot]) != 0)
+                    {
+                        current.body = current.entry;
+                        break;
+                    }
+
+                current.retired = retired;
+                current.taken = taken;
+                return replay(current);
+            }
+
+            /*
+                Places the guards of an iteration of the trace, from the types known before it, and updates them to the types known after it.
+                An argument is checked when the types known are not the ones its step requires : then they are. The jz and jnz test the flag
+                when cmp_register comes from a comparison of the iteration.
+            */
+            static void place_guards(std::vector<step>& steps, std::vector<unsigned char>& known)
+            {
+                std::vector<step> guarded;
+                bool compared(false);
+
+                for(unsigned int s(0) ; s < steps.size() ; ++s)
+                {
+                    runtime::instruction& instruction = steps[s].instruction;
+
+                    if(instruction.op == runtime::JZ || instruction.op == runtime::JNZ)
+                    {
+                        if(compared)
+                            instruction.op = (instruction.op == runtime::JZ) ? runtime::JZ_FLAG : runtime::JNZ_FLAG;
+                    }
+                    else
+                    {
+                        guard(guarded, steps[s], instruction.f_slot, known, required(instruction.op, false));
+                        guard(guarded, steps[s], instruction.s_slot, known, required(instruction.op, true));
+                        learn(instruction, known, compared);
+                    }
+
+                    guarded.push_back(steps[s]);
+                }
+
+                steps.swap(guarded);
+            }
+
+            /* Adds a guard before a step if the types known of a slot are not the ones it requires. The guard then tells them. */
+            static void guard(std::vector<step>& guarded, const step& checked, unsigned int slot, std::vector<unsigned char>& known, unsigned char needed)
+            {
+                if(needed == types::TS_NONE || (known[slot] & ~needed) == 0)
+                    return;
+
+                step check = {{runtime::NONE, runtime::AK_NONE, runtime::AK_NONE, slot, 0, needed}, checked.index, checked.retired, checked.taken};
+                guarded.push_back(check);
+                known[slot] &= needed;
+            }
+
+            /* Updates the types known after a step, and whether cmp_register comes from a comparison of the iteration. */
+            static void learn(const runtime::instruction& done, std::vector<unsigned char>& known, bool& compared)
+            {
+                runtime::instruction generic = done;
+                generic.op = runtime::generic_opcode(done.op);
+
+                optimizer::effects effects = optimizer::get_effects(generic);
+                unsigned char uses[3], defs[3] = {unknown, unknown, unknown};
+
+                for(unsigned int u(0) ; u < effects.uses_count ; ++u)
+                    uses[u] = known[effects.uses[u]];
+
+                types::transfer(generic.op, uses, defs);
+
+                for(unsigned int d(0) ; d < effects.defs_count ; ++d)
+                {
+                    known[effects.defs[d]] = defs[d];
+
+                    if(effects.defs[d] == runtime::SLOT_CMP_REGISTER)
+                        compared = (generic.op == runtime::CMP_EQ || generic.op == runtime::CMP_GT || generic.op == runtime::CMP_LT);
+                }
+            }
+
+            /* Counts the instructions run out of the interpreter, and returns the next one to interpret. */
+            unsigned int stop(std::uint64_t retired, std::uint64_t taken, unsigned int next)
+            {
+                if(m_counters)
+                {
+                    m_counters->instructions += retired;
+                    m_counters->taken_branches += taken;
+                }
+
+                return next;
+            }
+
+            /* Runs the trace of a loop until an exit or a guard fails. Returns the index of the next instruction to interpret. */
+            unsigned int replay(loop& current)
+            {
+                runtime::dynamic_variable* memory = m_memory.data();
+                bool flag(false);
+
+                if(m_counters)
+                    ++m_counters->traced_loops;
+
+                for(std::uint64_t iterations(0) ; ; ++iterations)
+                {
+                    const std::vector<step>& steps = (iterations == 0) ? current.entry : current.body;
+                    const step* end = steps.data() + steps.size();
+
+                    for(const step* at(steps.data()) ; at != end ; ++at)
+                    {
+                        step_result result = perform(at->instruction, memory, m_input, m_output, flag);
+
+                        if(result != SR_NEXT)
+                            return leave(current, at, iterations, result == SR_EXIT);
+                    }
+                }
+            }
+
+            /*
+                Leaves a trace at a step : after it for an exit, before it for a guard. Returns the index of the next instruction to interpret.
+                A trace left before a whole iteration too many times is dropped, the loop will be recorded again when hot.
+            */
+            unsigned int leave(loop& current, const step* at, std::uint64_t iterations, bool exit)
+            {
+                unsigned int next = exit ? at->instruction.target : at->index;
+                std::uint64_t retired = iterations * current.retired + at->retired + (exit ? 1 : 0);
+                std::uint64_t taken = iterations * current.taken + at->taken + ((exit && next != at->index + 1) ? 1 : 0);
+
+                if(iterations == 0 && ++current.failures == max_failures)
+                {
+                    current.entry.clear();
+                    current.body.clear();
+                    current.entries = 0;
+                    current.failures = 0;
+                }
+
+                return stop(retired, taken, next);
+            }
+
+            const runtime::program& m_resolved;
+            std::vector<runtime::dynamic_variable>& m_memory;
+            input_buffer& m_input;
+            output_buffer& m_output;
+            smallthink::run_counters* m_counters;
+            std::vector<loop> m_loops;
+    };
+
+    /*
+        Inserts a TRACE_LOOP instruction before each loop which only holds instructions a trace can run. With native, the loops the JIT
+        can compile are left to it, with the loops around them. With typed, the types pass will run : a loop must also hold an add, mul
+        or cmp_* whose argument types it can not infer, the other loops run faster in the interpreter with the specialized handlers.
+        A loop is the instructions between a backward jump and its target. The innermost loops are taken first, without overlapping.
+        Returns false if there is no such loop.
+    */
+    bool mark(runtime::program& resolved, bool native, bool typed)
+    {
+        std::vector<runtime::instruction>& instructions = resolved.instructions;
+        const unsigned int size = static_cast<unsigned int>(instructions.size());
+        std::vector<unsigned int> not_traceable_before(size + 1, 0), not_compilable_before(size + 1, 0), generic_before(size + 1, 0);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+            not_traceable_before[i + 1] = not_traceable_before[i] + (is_traceable(instructions[i].op) ? 0 : 1);
+
+        if(typed)
+        {
+            std::vector<types::site> sites = types::infer(resolved, optimizer::build_ssa(resolved));
+
+            // The instructions never reached have no types.
+            for(unsigned int i(0) ; i < size ; ++i)
+            {
+                runtime::opcode op = instructions[i].op;
+                bool generic = types::is_specializable(op) && sites[i].first != types::TS_NONE && types::specialized(op, sites[i]) == op;
+
+                generic_before[i + 1] = generic_before[i] + (generic ? 1 : 0);
+            }
+        }
+
+#ifdef SMALLTHINK_JIT
+        jit::compiler checker(resolved);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+            not_compilable_before[i + 1] = not_compilable_before[i] + (checker.is_compilable(instructions[i]) ? 0 : 1);
+#else
+        native = false;
+#endif
+
+        std::vector<std::pair<unsigned int, unsigned int> > candidates;
+        std::vector<bool> taken(size, false);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+        {
+            unsigned int target = instructions[i].target;
+
+            if(!optimizer::is_jump(instructions[i].op) || target > i)
+                continue;
+
+            // A trace could not run the loops around a JIT_LOOP.
+            if(native && not_compilable_before[i + 1] == not_compilable_before[target])
+                std::fill(taken.begin() + target, taken.begin() + i + 1, true);
+            else if(not_traceable_before[i + 1] == not_traceable_before[target] && (!typed || generic_before[i + 1] != generic_before[target]))
+                candidates.push_back(std::make_pair(i - target, target));
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<unsigned int> loop_of(size, optimizer::none);
+        std::vector<std::pair<unsigned int, unsigned int> > loops;
+
+        for(unsigned int c(0) ; c < candidates.size() ; ++c)
+        {
+            unsigned int start = candidates[c].second, end = start + candidates[c].first;
+            bool free(true);
+
+            for(unsigned int i(start) ; i <= end && free ; ++i)
+                free = !taken[i];
+
+            if(!free)
+                continue;
+
+            for(unsigned int i(start) ; i <= end ; ++i)
+                taken[i] = true;
+
+            loops.push_back(std::make_pair(start, end));
+        }
+
+        if(loops.empty())
+            return false;
+
+        std::sort(loops.begin(), loops.end());
+
+        for(unsigned int l(0) ; l < loops.size() ; ++l)
+            loop_of[loops[l].first] = l;
+
+        // TRACE_LOOP instructions : the jumps to a loop now go to its TRACE_LOOP, its back edges too.
+        std::vector<runtime::instruction> with_loops;
+        std::vector<unsigned int> with_loops_lines;
+        std::vector<unsigned int> new_index(size + 1, 0);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+        {
+            new_index[i] = static_cast<unsigned int>(with_loops.size());
+
+            if(loop_of[i] != optimizer::none)
+            {
+                runtime::instruction enter = {runtime::TRACE_LOOP, runtime::AK_NONE, runtime::AK_NONE, 0, 0, loop_of[i]};
+                with_loops.push_back(enter);
+
+                // A TRACE_LOOP is on the line of the first instruction of its loop.
+                if(!resolved.debug.lines.empty())
+                    with_loops_lines.push_back(resolved.debug.lines[i]);
+            }
+
+            with_loops.push_back(instructions[i]);
+
+            if(!resolved.debug.lines.empty())
+                with_loops_lines.push_back(resolved.debug.lines[i]);
+        }
+
+        new_index[size] = static_cast<unsigned int>(with_loops.size());
+
+        for(unsigned int i(0) ; i < with_loops.size() ; ++i)
+            if(optimizer::is_jump(with_loops[i].op))
+                with_loops[i].target = new_index[with_loops[i].target];
+
+        instructions.swap(with_loops);
+        resolved.debug.lines.swap(with_loops_lines);
+        resolved.traced_loops = static_cast<unsigned int>(loops.size());
+        return true;
+    }
+
+} // tracing namespace.
+
+/*
+    SmallThink bytecode.
+
+    A compiled program is saved as a single binary file, so it can be run again without lexing nor parsing.
+    All the integers are written in native byte order, the header tells the byte order used.
+
+    Layout (version 4, the map opcodes were added before the internal opcodes, and map_value and map_cursor before the free slots) :
+        header          "STBC", version, byte order mark, instructions count, slots count, strings size (6 x 4 bytes).
+        instructions    op, f_kind, s_kind, padding (4 x 1 byte), f_slot, s_slot, target (3 x 4 bytes).
+        slots           type, padding (4 x 1 byte), value offset, value size, name offset, name size, padding (5 x 4 bytes), integer or number (8 bytes).
+        strings         the bytes of the string constants and of the variable names.
+*/
+namespace bytecode
+{
+    const char magic[4] = {'S', 'T', 'B', 'C'};
+    const std::uint32_t version = 4;
+    const std::uint32_t byte_order_mark = 0x01020304;
+
+    const std::size_t header_size = 24;
+    const std::size_t instruction_size = 16;
+    const std::size_t slot_size = 32;
+
+    /* Appends the binary form of a value to the buffer. */
+    template <typename T>
+    void put(std::string& buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /* Reads the binary form of a value at the given position. The caller checks the bounds. */
+    template <typename T>
+    T get(const char* data, std::size_t position)
+    {
+        T value;
+        std::memcpy(&value, data + position, sizeof(T));
+
+        return value;
+    }
+
+    /* Returns true if the given data starts like a bytecode file. */
+    bool is_bytecode(const char* data, std::size_t size)
+    {
+        return size >= sizeof(magic) && std::memcmp(data, magic, sizeof(magic)) == 0;
+    }
+
+    /* Returns the bytecode of a resolved program. */
+    std::string write(const runtime::program& resolved)
+    {
+        std::string instructions, slots, strings;
+
+        for(unsigned int i(0) ; i < resolved.instructions.size() ; ++i)
+        {
+            const runtime::instruction& current = resolved.instructions.at(i);
+
+            put<std::uint8_t>(instructions, static_cast<std::uint8_t>(current.op));
+            put<std::uint8_t>(instructions, static_cast<std::uint8_t>(current.f_kind));
+            put<std::uint8_t>(instructions, static_cast<std::uint8_t>(current.s_kind));
+            put<std::uint8_t>(instructions, 0);
+            put<std::uint32_t>(instructions, current.f_slot);
+            put<std::uint32_t>(instructions, current.s_slot);
+            put<std::uint32_t>(instructions, current.target);
+        }
+
+        for(unsigned int slot(0) ; slot < resolved.memory.size() ; ++slot)
+        {
+            const runtime::dynamic_variable& variable = resolved.memory.at(slot);
+
+            put<std::uint8_t>(slots, static_cast<std::uint8_t>(variable.type));
+            put<std::uint8_t>(slots, 0);
+            put<std::uint8_t>(slots, 0);
+            put<std::uint8_t>(slots, 0);
+
+            put<std::uint32_t>(slots, static_cast<std::uint32_t>(strings.size()));
+            put<std::uint32_t>(slots, static_cast<std::uint32_t>(variable.type == runtime::DVT_STRING ? variable.value.size() : 0));
+
+            if(variable.type == runtime::DVT_STRING)
+                strings += variable.value;
+
+            put<std::uint32_t>(slots, static_cast<std::uint32_t>(strings.size()));
+            put<std::uint32_t>(slots, static_cast<std::uint32_t>(resolved.names.at(slot).size()));
+            put<std::uint32_t>(slots, 0);
+            strings += resolved.names.at(slot);
+
+            if(variable.type == runtime::DVT_NUMERIC)
+                put<double>(slots, variable.number);
+            else
+                put<std::int64_t>(slots, variable.type == runtime::DVT_INTEGER ? variable.integer : 0);
+        }
+
+        std::string header(magic, sizeof(magic));
+        put<std::uint32_t>(header, version);
+        put<std::uint32_t>(header, byte_order_mark);
+        put<std::uint32_t>(header, static_cast<std::uint32_t>(resolved.instructions.size()));
+        put<std::uint32_t>(header, static_cast<std::uint32_t>(resolved.memory.size()));
+        put<std::uint32_t>(header, static_cast<std::uint32_t>(strings.size()));
+
+        return header + instructions + slots + strings;
+    }
+
+    /* Saves a resolved program as bytecode. Returns false if the file can not be written. */
+    bool save(const runtime::program& resolved, const std::string& filename)
+    {
+        std::ofstream outputfile(filename.c_str(), std::ios::binary | std::ios::trunc);
+        outputfile << write(resolved);
+
+        return static_cast<bool>(outputfile);
+    }
+
+    /* Prints a bytecode error and returns false. */
+    bool invalid(std::ostream& errors, const std::string& reason)
+    {
+        errors << "[BYTECODE][ERROR] " << reason << std::endl;
+        return false;
+    }
+
+    /*
+        Loads a program from bytecode (usually a mapped file). Nothing is tokenized : the tables are read in place.
+        Returns false (after printing an error) if the data is not a valid bytecode of this version.
+    */
+    bool load(const char* data, std::size_t size, runtime::program& loaded, std::ostream& errors)
+    {
+        if(size < header_size || !is_bytecode(data, size))
+            return invalid(errors, "Not a SmallThink bytecode file.");
+
+        if(get<std::uint32_t>(data, 4) != version)
+            return invalid(errors, "Unsupported bytecode version : " + string_utils::from<std::uint32_t>(get<std::uint32_t>(data, 4)) + ".");
+
+        if(get<std::uint32_t>(data, 8) != byte_order_mark)
+            return invalid(errors, "Bytecode compiled on a machine with another byte order.");
+
+        std::size_t instructions_count = get<std::uint32_t>(data, 12);
+        std::size_t slots_count = get<std::uint32_t>(data, 16);
+        std::size_t strings_size = get<std::uint32_t>(data, 20);
+
+        std::size_t instructions_position = header_size;
+        std::size_t slots_position = instructions_position + instructions_count * instruction_size;
+        std::size_t strings_position = slots_position + slots_count * slot_size;
+
+        if(strings_position + strings_size != size || slots_count < runtime::SLOT_FIRST_FREE)
+            return invalid(errors, "Truncated or corrupted bytecode file.");
+
+        const char* strings = data + strings_position;
+
+        loaded.instructions.resize(instructions_count);
+        loaded.memory.resize(slots_count);
+        loaded.names.resize(slots_count);
+
+        for(std::size_t i(0) ; i < instructions_count ; ++i)
+        {
+            std::size_t position = instructions_position + i * instruction_size;
+            runtime::instruction& current = loaded.instructions[i];
+
+            std::uint8_t op = get<std::uint8_t>(data, position);
+            std::uint8_t f_kind = get<std::uint8_t>(data, position + 1);
+            std::uint8_t s_kind = get<std::uint8_t>(data, position + 2);
+
+            if(op > runtime::OUT_ENDLINE || f_kind > runtime::AK_CONSTANT || s_kind > runtime::AK_CONSTANT)
+                return invalid(errors, "Invalid instruction " + string_utils::from<std::size_t>(i) + ".");
+
+            current.op = static_cast<runtime::opcode>(op);
+            current.f_kind = static_cast<runtime::argument_kind>(f_kind);
+            current.s_kind = static_cast<runtime::argument_kind>(s_kind);
+            current.f_slot = get<std::uint32_t>(data, position + 4);
+            current.s_slot = get<std::uint32_t>(data, position + 8);
+            current.target = get<std::uint32_t>(data, position + 12);
+
+            if(current.f_slot >= slots_count || current.s_slot >= slots_count || current.target > instructions_count)
+                return invalid(errors, "Invalid instruction " + string_utils::from<std::size_t>(i) + ".");
+        }
+
+        for(std::size_t slot(0) ; slot < slots_count ; ++slot)
+        {
+            std::size_t position = slots_position + slot * slot_size;
+
+            std::uint8_t type = get<std::uint8_t>(data, position);
+            std::size_t value_offset = get<std::uint32_t>(data, position + 4);
+            std::size_t value_size = get<std::uint32_t>(data, position + 8);
+            std::size_t name_offset = get<std::uint32_t>(data, position + 12);
+            std::size_t name_size = get<std::uint32_t>(data, position + 16);
+
+            if(type > runtime::DVT_UNDEFINED || value_offset + value_size > strings_size || name_offset + name_size > strings_size)
+                return invalid(errors, "Invalid slot " + string_utils::from<std::size_t>(slot) + ".");
+
+            runtime::dynamic_variable& variable = loaded.memory[slot];
+            variable.type = static_cast<runtime::dynamic_variable_type>(type);
+
+            if(variable.type == runtime::DVT_NUMERIC)
+                variable.number = get<double>(data, position + 24);
+            else
+                variable.integer = get<std::int64_t>(data, position + 24);
+
+            if(variable.type == runtime::DVT_STRING)
+                variable.value.assign(strings + value_offset, value_size);
+
+            loaded.names[slot].assign(strings + name_offset, name_size);
+        }
+
+        return true;
+    }
+
+} // bytecode namespace.
+
+/*
+    Compile cache.
+
+    A compiled source is saved in the cache directory, keyed by its size and a hash of its content, -O, the version of the entries and
+    the version of the bytecode. It is only used when a cache directory is given (-cache).
+    The next compilations of the same source load it instead of lexing, parsing, resolving and optimizing it again.
+
+    Layout of an entry (native byte order, like bytecode) :
+        header          "STCC", version, bytecode version, optimized (4 x 4 bytes), source size, source hash, bytecode size (3 x 8 bytes).
+        bytecode        the program, see the bytecode namespace.
+        debug           lines count, the line of each instruction, labels count, then line, name size and name of each label (4 bytes each, then the name).
+
+    An entry is written in a temporary file then renamed, so a concurrent reader sees a whole entry or none.
+    Anything unexpected when reading (missing entry, other key, truncated file) falls back to a normal compilation.
+*/
+namespace cache
+{
+    const char magic[4] = {'S', 'T', 'C', 'C'};
+    const std::size_t header_size = 40;
+
+    // Version of the entries : bump it with any change of the programs the front end or the optimizer make, an entry is then never
+    // read by an interpreter which would compile its source differently. Changes of the bytecode format bump bytecode::version.
+    const std::uint32_t version = 2;
+
+    /* Hashes the data by words of 8 bytes, like FNV-1a does by bytes. */
+    std::uint64_t hash(const char* data, std::size_t size)
+    {
+        std::uint64_t result = 0xCBF29CE484222325ULL ^ size;
+        std::size_t i(0);
+
+        for( ; i + 8 <= size ; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            result = (result ^ word) * 0x100000001B3ULL;
+            result ^= result >> 32;
+        }
+
+        for( ; i < size ; ++i)
+            result = (result ^ static_cast<unsigned char>(data[i])) * 0x100000001B3ULL;
+
+        return result;
+    }
+
+    /* Returns the path of the entry of a source. */
+    std::string entry_path(const std::string& directory, const char* source, std::size_t size, bool optimized)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "%016llx%s.stcc", static_cast<unsigned long long>(hash(source, size)), optimized ? "-O" : "");
+
+        return directory + "/" + name;
+    }
+
+    /* Returns the header of the entry of a source, without the bytecode size. */
+    std::string header(const char* source, std::size_t size, bool optimized)
+    {
+        std::string result(magic, sizeof(magic));
+        bytecode::put<std::uint32_t>(result, version);
+        bytecode::put<std::uint32_t>(result, bytecode::version);
+        bytecode::put<std::uint32_t>(result, optimized ? 1 : 0);
+        bytecode::put<std::uint64_t>(result, size);
+        bytecode::put<std::uint64_t>(result, hash(source, size));
+
+        return result;
+    }
+
+    /* Loads the program of a source from its entry. Returns false if there is no valid entry for this source. */
+    bool load(const std::string& path, const char* source, std::size_t size, bool optimized, runtime::program& loaded)
+    {
+        mapped_file file;
+
+        if(!file.open(path) || file.size() < header_size)
+            return false;
+
+        const char* data = file.data();
+        std::string expected = header(source, size, optimized);
+
+        // Both the size and the hash of the source must match : the name of the entry is only the hash.
+        if(std::memcmp(data, expected.data(), expected.size()) != 0)
+            return false;
+
+        std::uint64_t bytecode_size = bytecode::get<std::uint64_t>(data, expected.size());
+        std::size_t position = header_size + static_cast<std::size_t>(bytecode_size);
+
+        // The errors of an invalid entry are not printed : the source is compiled again.
+        std::ostringstream ignored;
+
+        if(bytecode_size > file.size() - header_size || !bytecode::load(data + header_size, static_cast<std::size_t>(bytecode_size), loaded, ignored))
+            return false;
+
+        if(position + 4 > file.size())
+            return false;
+
+        std::size_t lines_count = bytecode::get<std::uint32_t>(data, position);
+        position += 4;
+
+        if(lines_count != loaded.instructions.size() || position + lines_count * 4 + 4 > file.size())
+            return false;
+
+        loaded.debug.lines.resize(lines_count);
+
+        for(std::size_t i(0) ; i < lines_count ; ++i, position += 4)
+            loaded.debug.lines[i] = bytecode::get<std::uint32_t>(data, position);
+
+        std::size_t labels_count = bytecode::get<std::uint32_t>(data, position);
+        position += 4;
+
+        for(std::size_t i(0) ; i < labels_count ; ++i)
+        {
+            if(position + 8 > file.size())
+                return false;
+
+            unsigned int line = bytecode::get<std::uint32_t>(data, position);
+            std::size_t name_size = bytecode::get<std::uint32_t>(data, position + 4);
+            position += 8;
+
+            if(name_size > file.size() - position)
+                return false;
+
+            loaded.debug.labels.push_back(std::make_pair(line, std::string(data + position, name_size)));
+            position += name_size;
+        }
+
+        return position == file.size();
+    }
+
+    /* Creates the directory and its parents. Returns false if it does not exist afterwards. */
+    bool create_directory(const std::string& directory)
+    {
+#ifndef _WIN32
+        for(std::size_t slash(directory.find('/', 1)) ; slash != std::string::npos ; slash = directory.find('/', slash + 1))
+            mkdir(directory.substr(0, slash).c_str(), 0755);
+
+        return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+#else
+        (void)directory;
+        return false;
+#endif
+    }
+
+    /* Saves the program of a source as its entry. Failures are silent : the cache is only an optimization. */
+    void store(const std::string& directory, const std::string& path, const char* source, std::size_t size, bool optimized, const runtime::program& resolved)
+    {
+        static std::atomic<unsigned int> stored(0);
+
+        if(!create_directory(directory))
+            return;
+
+        std::string code = bytecode::write(resolved);
+        std::string entry = header(source, size, optimized);
+        bytecode::put<std::uint64_t>(entry, code.size());
+        entry += code;
+
+        bytecode::put<std::uint32_t>(entry, static_cast<std::uint32_t>(resolved.debug.lines.size()));
+
+        for(std::size_t i(0) ; i < resolved.debug.lines.size() ; ++i)
+            bytecode::put<std::uint32_t>(entry, resolved.debug.lines[i]);
+
+        bytecode::put<std::uint32_t>(entry, static_cast<std::uint32_t>(resolved.debug.labels.size()));
+
+        for(std::size_t i(0) ; i < resolved.debug.labels.size() ; ++i)
+        {
+            bytecode::put<std::uint32_t>(entry, resolved.debug.labels[i].first);
+            bytecode::put<std::uint32_t>(entry, static_cast<std::uint32_t>(resolved.debug.labels[i].second.size()));
+            entry += resolved.debug.labels[i].second;
+        }
+
+        // Unique among the processes and the threads writing at once.
+        std::string temporary = path + ".tmp" + string_utils::from<long>(static_cast<long>(getpid())) + "." + string_utils::from<unsigned int>(++stored);
+
+        {
+            std::ofstream output(temporary.c_str(), std::ios::binary | std::ios::trunc);
+            output << entry;
+
+            if(!output.flush())
+            {
+                output.close();
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+
+        if(std::rename(temporary.c_str(), path.c_str()) != 0)
+            std::remove(temporary.c_str());
+    }
+
+} // cache namespace.
+
+/*
+    Profiler of the runtime, used with -profile.
+
+    The runtime calls enter() before each instruction : the time since the previous call is given to the previous instruction,
+    along with the conversions between strings and numbers it did. Time is read from the time stamp counter where available
+    (in cycles), else from std::chrono::steady_clock (in nanoseconds).
+    The runtime is instantiated without these calls when the profiler is off.
+*/
+namespace profiler
+{
+    /* Returns the current time, in the unit of the profile. */
+    inline std::uint64_t now()
+    {
+#ifdef SMALLTHINK_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /* Unit of the times of the profile. */
+    const char* unit()
+    {
+#ifdef SMALLTHINK_RDTSC
+        return "cycles";
+#else
+        return "ns";
+#endif
+    }
+
+    /* Number of register file slots an instruction reads or writes, the undefined checks included. */
+    unsigned int slot_accesses(const runtime::instruction& current)
+    {
+        optimizer::effects accessed = optimizer::get_effects(current);
+        return accessed.uses_count + accessed.defs_count;
+    }
+
+    /* Counters of one instruction, or of one opcode. */
+    struct counters
+    {
+        std::uint64_t executed;
+        std::uint64_t time;
+        std::uint64_t slots;
+        std::uint64_t conversions;
+
+        counters() : executed(0), time(0), slots(0), conversions(0)
+        {
+        }
+    };
+
+    class profile
+    {
+        public:
+            // The end of the program is entered like an instruction after the last one.
+            explicit profile(const runtime::program& resolved) : m_program(resolved), m_instructions(resolved.instructions.size() + 1), m_current(optimizer::none), m_start(0), m_conversions(0)
+            {
+            }
+
+            /* Starts the given instruction, the previous one is done. */
+            inline void enter(unsigned int index)
+            {
+                std::uint64_t time = now();
+
+                done(time);
+
+                m_current = index;
+                ++m_instructions[index].executed;
+                m_start = time;
+                m_conversions = runtime::conversions;
+            }
+
+            /* The program is done. */
+            void finish()
+            {
+                done(now());
+                m_current = optimizer::none;
+            }
+
+            /* Prints the instructions sorted by time, then the opcodes. */
+            void report(std::ostream& stream) const
+            {
+                const std::vector<runtime::instruction>& instructions = m_program.instructions;
+                const runtime::debug_info& debug = m_program.debug;
+                std::vector<counters> opcodes(runtime::NONE + 1);
+                std::vector<std::pair<std::uint64_t, unsigned int> > order; // Time and index, sorted by time.
+                counters total;
+
+                for(unsigned int i(0) ; i < instructions.size() ; ++i)
+                {
+                    if(m_instructions[i].executed == 0)
+                        continue;
+
+                    counters& opcode = opcodes[instructions[i].op];
+                    std::uint64_t slots = m_instructions[i].executed * slot_accesses(instructions[i]);
+
+                    opcode.executed += m_instructions[i].executed;
+                    opcode.time += m_instructions[i].time;
+                    opcode.slots += slots;
+                    opcode.conversions += m_instructions[i].conversions;
+
+                    total.executed += m_instructions[i].executed;
+                    total.time += m_instructions[i].time;
+
+                    order.push_back(std::make_pair(m_instructions[i].time, i));
+                }
+
+                std::sort(order.begin(), order.end(), slower);
+
+                stream << "----------------------------------" << std::endl;
+                stream << "[PROFILE] " << total.executed << " instructions, " << total.time << " " << unit() << "." << std::endl;
+                stream << "index\tline\tlabel\topcode\texecuted\t" << unit() << "\t%\tslots\tconversions" << std::endl;
+
+                for(unsigned int k(0) ; k < order.size() ; ++k)
+                {
+                    unsigned int i = order[k].second;
+                    const counters& current = m_instructions[i];
+
+                    stream << i << "\t";
+
+                    if(debug.lines.empty())
+                        stream << "-\t-\t";
+                    else
+                        stream << debug.lines[i] << "\t" << (debug.label_of(debug.lines[i]).empty() ? "-" : debug.label_of(debug.lines[i])) << "\t";
+
+                    stream << runtime::print_opcode(instructions[i].op) << "\t" << current.executed << "\t" << current.time << "\t" << percent(current.time, total.time)
+                        << "\t" << current.executed * slot_accesses(instructions[i]) << "\t" << current.conversions << std::endl;
+                }
+
+                stream << "----------------------------------" << std::endl;
+                stream << "opcode\texecuted\t" << unit() << "\t%\tslots\tconversions" << std::endl;
+
+                order.clear();
+
+                for(unsigned int op(0) ; op < opcodes.size() ; ++op)
+                    if(opcodes[op].executed > 0)
+                        order.push_back(std::make_pair(opcodes[op].time, op));
+
+                std::sort(order.begin(), order.end(), slower);
+
+                for(unsigned int k(0) ; k < order.size() ; ++k)
+                {
+                    const counters& current = opcodes[order[k].second];
+
+                    stream << runtime::print_opcode(static_cast<runtime::opcode>(order[k].second)) << "\t" << current.executed << "\t" << current.time << "\t" << percent(current.time, total.time)
+                        << "\t" << current.slots << "\t" << current.conversions << std::endl;
+                }
+            }
+
+        private:
+            /* Gives the time since the start of the current instruction to it. */
+            inline void done(std::uint64_t time)
+            {
+                if(m_current == optimizer::none)
+                    return;
+
+                m_instructions[m_current].time += time - m_start;
+                m_instructions[m_current].conversions += runtime::conversions - m_conversions;
+            }
+
+            /* Orders by decreasing time, then by increasing index. */
+            static bool slower(const std::pair<std::uint64_t, unsigned int>& first, const std::pair<std::uint64_t, unsigned int>& second)
+            {
+                return first.first > second.first || (first.first == second.first && first.second < second.second);
+            }
+
+            /* Returns the part of the total, in percent with one decimal. */
+            static std::string percent(std::uint64_t part, std::uint64_t total)
+            {
+                char text[16];
+                snprintf(text, sizeof(text), "%.1f", total > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0);
+                return text;
+            }
+
+            const runtime::program& m_program;
+            std::vector<counters> m_instructions;
+            unsigned int m_current;
+            std::uint64_t m_start;
+            std::uint64_t m_conversions;
+    };
+
+} // profiler namespace.
+
+/*
+    Very basic runtime.
+
+    The same handlers are used by two dispatch engines :
+        - switch : a portable loop around a switch on the opcode.
+        - threaded : the address of the handler of each instruction is resolved once before running,
+          then each handler jumps directly to the handler of the next instruction (computed goto).
+
+    The program runs on the given register file, a copy of the initial one of the program, and draws its random numbers from the given generator.
+    The arrays and maps it builds are added to the given heap, an array or map variable holding the index of its storage : the ones no variable reaches anymore are freed.
+    It reads from the given input buffer, prints in the given output buffer and prints its errors in the given stream.
+    When instrumented, the instructions retired and the branches taken are counted in the given counters,
+    and when profiled each instruction is also counted and timed in the given profile.
+*/
+template <bool threaded, runtime::instrumentation level>
+smallthink::status execute(const runtime::program& resolved, std::vector<runtime::dynamic_variable>& memory, runtime::random_generator& random, runtime::heap& heap, input_buffer& input, output_buffer& output, std::ostream& errors, smallthink::run_counters* counters, profiler::profile* profile)
+{
+    const runtime::instruction* instructions = resolved.instructions.data();
+    const unsigned int size = static_cast<unsigned int>(resolved.instructions.size());
+
+    // Prepare memory : the register file comes from the resolution pass, we only seed the random values.
+    memory[runtime::SLOT_RANDOM_INT] = runtime::make_integer(random.next() % 1000);
+    memory[runtime::SLOT_RANDOM_NUM] = runtime::make_numeric(static_cast<double>(random.next() % 10000));
+
+    /*
+        cip : current instruction pointer
+            -> index of the next instruction in the instructions vector.
+    */
+    unsigned int cip(0);
+    const runtime::instruction* current(nullptr);
+
+    /*
+        flag : result of the last comparison, a native boolean.
+            -> the comparisons set it with cmp_register, jz flag and jnz flag test it instead of reading cmp_register back.
+            The types pass only uses them where cmp_register always comes from a comparison.
+    */
+    bool flag(false);
+
+    // Text of a number used as a map key, formatted in place.
+    std::string key_text;
+
+    // Counts, records and runs the loops of the TRACE_LOOP instructions.
+    tracing::tracer traces(resolved, memory, input, output, counters);
+
+    // Counts the instruction just done, cip being the index of the next one.
+    #define RETIRE() if(level != runtime::INSTRUMENT_NONE) runtime::retire(*counters, *current, static_cast<unsigned int>(current - instructions), cip)
+
+#ifdef SMALLTHINK_THREADED_CODE
+    // Address of the handler of each instruction, the last one ends the program.
+    std::vector<const void*> handlers;
+
+    if(threaded)
+    {
+        const void* opcode_handlers[runtime::NONE + 1];
+
+        opcode_handlers[runtime::MOV] = &&handle_MOV;
+        opcode_handlers[runtime::ADD] = &&handle_ADD;
+        opcode_handlers[runtime::MUL] = &&handle_MUL;
+        opcode_handlers[runtime::CMP_EQ] = &&handle_CMP_EQ;
+        opcode_handlers[runtime::CMP_GT] = &&handle_CMP_GT;
+        opcode_handlers[runtime::CMP_LT] = &&handle_CMP_LT;
+        opcode_handlers[runtime::NEG] = &&handle_NEG;
+        opcode_handlers[runtime::OUT] = &&handle_OUT;
+        opcode_handlers[runtime::IN] = &&handle_IN;
+        opcode_handlers[runtime::GET] = &&handle_GET;
+        opcode_handlers[runtime::STOP] = &&handle_STOP;
+        opcode_handlers[runtime::FLUSH] = &&handle_FLUSH;
+        opcode_handlers[runtime::LABEL] = &&handle_LABEL;
+        opcode_handlers[runtime::JMP] = &&handle_JMP;
+        opcode_handlers[runtime::JNZ] = &&handle_JNZ;
+        opcode_handlers[runtime::JZ] = &&handle_JZ;
+        opcode_handlers[runtime::NUM] = &&handle_NUM;
+        opcode_handlers[runtime::STR] = &&handle_STR;
+        opcode_handlers[runtime::NUM_INT] = &&handle_NUM_INT;
+        opcode_handlers[runtime::SEED_RANDOM] = &&handle_SEED_RANDOM;
+        opcode_handlers[runtime::FLUSH_OUT] = &&handle_FLUSH_OUT;
+        opcode_handlers[runtime::OUT_ENDLINE] = &&handle_OUT_ENDLINE;
+        opcode_handlers[runtime::ARRAY_NEW] = &&handle_ARRAY_NEW;
+        opcode_handlers[runtime::ARRAY_RESIZE] = &&handle_ARRAY_RESIZE;
+        opcode_handlers[runtime::ARRAY_LEN] = &&handle_ARRAY_LEN;
+        opcode_handlers[runtime::ARRAY_GET] = &&handle_ARRAY_GET;
+        opcode_handlers[runtime::ARRAY_SET] = &&handle_ARRAY_SET;
+        opcode_handlers[runtime::ARRAY_SUM] = &&handle_ARRAY_SUM;
+        opcode_handlers[runtime::ARRAY_MIN] = &&handle_ARRAY_MIN;
+        opcode_handlers[runtime::ARRAY_MAX] = &&handle_ARRAY_MAX;
+        opcode_handlers[runtime::ARRAY_SCALE] = &&handle_ARRAY_SCALE;
+        opcode_handlers[runtime::ARRAY_ADD] = &&handle_ARRAY_ADD;
+        opcode_handlers[runtime::ARRAY_DOT] = &&handle_ARRAY_DOT;
+        opcode_handlers[runtime::ARRAY_SORT] = &&handle_ARRAY_SORT;
+        opcode_handlers[runtime::MAP_NEW] = &&handle_MAP_NEW;
+        opcode_handlers[runtime::MAP_PUT] = &&handle_MAP_PUT;
+        opcode_handlers[runtime::MAP_GET] = &&handle_MAP_GET;
+        opcode_handlers[runtime::MAP_HAS] = &&handle_MAP_HAS;
+        opcode_handlers[runtime::MAP_DEL] = &&handle_MAP_DEL;
+        opcode_handlers[runtime::MAP_LEN] = &&handle_MAP_LEN;
+        opcode_handlers[runtime::MAP_NEXT] = &&handle_MAP_NEXT;
+        opcode_handlers[runtime::ADD_NUMBER] = &&handle_ADD_NUMBER;
+        opcode_handlers[runtime::ADD_STRING] = &&handle_ADD_STRING;
+        opcode_handlers[runtime::MUL_NUMBER] = &&handle_MUL_NUMBER;
+        opcode_handlers[runtime::MUL_STRING] = &&handle_MUL_STRING;
+        opcode_handlers[runtime::CMP_EQ_NUMBER] = &&handle_CMP_EQ_NUMBER;
+        opcode_handlers[runtime::CMP_EQ_STRING] = &&handle_CMP_EQ_STRING;
+        opcode_handlers[runtime::CMP_GT_NUMBER] = &&handle_CMP_GT_NUMBER;
+        opcode_handlers[runtime::CMP_GT_STRING] = &&handle_CMP_GT_STRING;
+        opcode_handlers[runtime::CMP_LT_NUMBER] = &&handle_CMP_LT_NUMBER;
+        opcode_handlers[runtime::CMP_LT_STRING] = &&handle_CMP_LT_STRING;
+        opcode_handlers[runtime::JZ_FLAG] = &&handle_JZ_FLAG;
+        opcode_handlers[runtime::JNZ_FLAG] = &&handle_JNZ_FLAG;
+        opcode_handlers[runtime::CMP_EQ_JZ] = &&handle_CMP_EQ_JZ;
+        opcode_handlers[runtime::CMP_EQ_JNZ] = &&handle_CMP_EQ_JNZ;
+        opcode_handlers[runtime::CMP_GT_JZ] = &&handle_CMP_GT_JZ;
+        opcode_handlers[runtime::CMP_GT_JNZ] = &&handle_CMP_GT_JNZ;
+        opcode_handlers[runtime::CMP_LT_JZ] = &&handle_CMP_LT_JZ;
+        opcode_handlers[runtime::CMP_LT_JNZ] = &&handle_CMP_LT_JNZ;
+        opcode_handlers[runtime::MOV_ADD] = &&handle_MOV_ADD;
+        opcode_handlers[runtime::ADD_CMP_EQ_JZ] = &&handle_ADD_CMP_EQ_JZ;
+        opcode_handlers[runtime::ADD_CMP_EQ_JNZ] = &&handle_ADD_CMP_EQ_JNZ;
+        opcode_handlers[runtime::JIT_LOOP] = &&handle_JIT_LOOP;
+        opcode_handlers[runtime::TRACE_LOOP] = &&handle_TRACE_LOOP;
+        opcode_handlers[runtime::NONE] = &&handle_NONE;
+
+        handlers.resize(size + 1);
+
+        for(unsigned int i(0) ; i < size ; ++i)
+            handlers[i] = opcode_handlers[instructions[i].op];
+
+        handlers[size] = &&handle_end;
+    }
+
+    // A handler is also a label for the threaded engine.
+    #define HANDLER(op) case runtime::op: handle_##op:
+
+    // Goes to the next instruction : straight to its handler for the threaded engine, back to the switch else.
+    #define NEXT() if(threaded) { RETIRE(); if(level == runtime::INSTRUMENT_PROFILE) profile->enter(cip); current = instructions + cip; goto *handlers[cip++]; } break
+
+    // Let's go ! \o/
+    if(threaded)
+    {
+        if(level == runtime::INSTRUMENT_PROFILE)
+            profile->enter(cip);
+
+        current = instructions + cip;
+        goto *handlers[cip++];
+    }
+#else
+    #define HANDLER(op) case runtime::op:
+    #define NEXT() break
+#endif
+
+    while(cip < size)
+    {
+        if(level == runtime::INSTRUMENT_PROFILE)
+            profile->enter(cip);
+
+        current = instructions + cip++;
+
+        switch(current->op)
+        {
+            HANDLER(MOV)
+                // Constants have their own slots, so a value is copied like a variable.
+                if(memory[current->s_slot].type == runtime::DVT_UNDEFINED)
+                    return runtime::unknown_variable(errors, "MOV-VAR-VAR", resolved.names[current->s_slot]);
+
+                // We add it to the memory (or overwrite the old one with the same name).
+                memory[current->f_slot] = memory[current->s_slot];
+                NEXT();
+            HANDLER(ADD)
+                // Add a variable and a value or two variable.
+                // First arg must be a variable (used to store the result).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // The result is stored in place in the first variable.
+                if(!runtime::add(memory[current->f_slot], memory[current->s_slot]))
+                    return runtime::string_too_long(errors, "ADD-VAR", resolved.names[current->f_slot]);
+
+                NEXT();
+            HANDLER(MUL)
+                // Mul a variable and a value or two variable.
+                // First arg must be a variable (used to store the result).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MUL-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MUL-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // The result is stored in place in the first variable, a string is repeated in its own memory.
+                if(!runtime::mul(memory[current->f_slot], memory[current->s_slot]))
+                    return runtime::string_too_long(errors, "MUL-VAR", resolved.names[current->f_slot]);
+
+                NEXT();
+            HANDLER(CMP_EQ)
+                // Compare a variable and a value or two variable.
+                // Check if equals.
+                // Numbers are compared by value, anything else by representation.
+                // First arg must be a variable.
+                // Result is stored into special variable "cmp_register".
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                flag = runtime::equals(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_GT)
+                // Compare a variable and a value or two variable.
+                // Check if first > second.
+                // Numbers are compared by value, anything else by representation.
+                // First arg must be a variable.
+                // Result is stored into special variable "cmp_register".
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                flag = runtime::greater(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_LT)
+                // Compare a variable and a value or two variable.
+                // Check if first < second.
+                // Numbers are compared by value, anything else by representation.
+                // First arg must be a variable.
+                // Result is stored into special variable "cmp_register".
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                flag = runtime::less(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(NEG)
+                // Negate a variable.
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "NEG-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                runtime::neg(memory[current->f_slot]);
+                NEXT();
+            HANDLER(OUT)
+                // Prints the given argument.
+                // Values were kept as they were written by the resolution pass.
+                // Arrays are printed, maps are not.
+                if(memory[current->f_slot].type == runtime::DVT_ARRAY)
+                    runtime::print_array(output, heap.array(memory[current->f_slot]));
+                else if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "OUT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+                else
+                    runtime::print(output, memory[current->f_slot]);
+
+                NEXT();
+            HANDLER(OUT_ENDLINE)
+                // Special identifier endline. The flush policy decides if the line is written now.
+                output.newline();
+                NEXT();
+            HANDLER(IN)
+                // Gets input from user (one word).
+                if(memory[current->f_slot].type == runtime::DVT_UNDEFINED)
+                    return runtime::unknown_variable(errors, "IN-VAR", resolved.names[current->f_slot]);
+
+                // At the end of the input, the variable keeps its characters.
+                memory[current->f_slot].type = runtime::DVT_STRING;
+                input.read_word(memory[current->f_slot].value);
+                NEXT();
+            HANDLER(GET)
+                // Gets input from user (one character).
+                if(memory[current->f_slot].type == runtime::DVT_UNDEFINED)
+                    return runtime::unknown_variable(errors, "IN-VAR", resolved.names[current->f_slot]);
+
+                memory[current->f_slot].type = runtime::DVT_STRING;
+
+                {
+                    // Gets only one char, the variable is an empty string at the end of the input.
+                    int character = input.get();
+
+                    if(character < 0)
+                        memory[current->f_slot].value.clear();
+                    else
+                        memory[current->f_slot].value.assign(1, static_cast<char>(character));
+                }
+                NEXT();
+            HANDLER(FLUSH)
+                // Discards the rest of the line.
+                input.ignore_line();
+                NEXT();
+            HANDLER(FLUSH_OUT)
+                // Writes the buffered output now, whatever the flush policy.
+                output.flush();
+                NEXT();
+            HANDLER(STOP)
+                // Stop the runtime.
+                return smallthink::ST_OK;
+            HANDLER(LABEL)
+                // Labels were removed by the label resolution pass.
+                NEXT();
+            HANDLER(NONE)
+                // Null instruction, never produced by the parser.
+                NEXT();
+            HANDLER(JMP)
+                // Jump to the indicated label.
+                cip = current->target;
+                NEXT();
+            HANDLER(JNZ)
+                // Jump to the indicated label if special variable "cmp_register" is different than 0.
+                if(runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) != 0)
+                    cip = current->target;
+                NEXT();
+            HANDLER(JZ)
+                // Jump to the indicated label if special variable "cmp_register" equals 0.
+                if(runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) == 0)
+                    cip = current->target;
+                NEXT();
+            HANDLER(NUM)
+                // Try to convert variable to a floating number.
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "NUM-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                memory[current->f_slot] = runtime::make_numeric(runtime::to_double(memory[current->f_slot]));
+                NEXT();
+            HANDLER(STR)
+                // Try to convert variable. Numbers are formatted only here.
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "STR-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                memory[current->f_slot] = runtime::make_string(runtime::to_string(memory[current->f_slot]));
+                NEXT();
+            HANDLER(NUM_INT)
+                // Try to convert variable to an integer.
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "NUM_INT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                memory[current->f_slot] = runtime::make_integer(runtime::to_integer(memory[current->f_slot]));
+                NEXT();
+            HANDLER(SEED_RANDOM)
+                {
+                    std::int64_t random_max = runtime::to_integer(memory[runtime::SLOT_RANDOM_MAX]);
+
+                    if(random_max <= 0)
+                        return runtime::invalid_random_max(errors, "SEED_RANDOM", random_max);
+
+                    memory[runtime::SLOT_RANDOM_INT] = runtime::make_integer(random.next() % random_max);
+                    memory[runtime::SLOT_RANDOM_NUM] = runtime::make_numeric(static_cast<double>(random.next() % random_max));
+                }
+                NEXT();
+            HANDLER(ARRAY_NEW)
+                // Makes the first variable a new array of the given size, filled with zeros.
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_NEW-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    runtime::dynamic_variable created = heap.make_array(memory);
+
+                    if(!runtime::resize_array(heap.array(created), runtime::to_integer(memory[current->s_slot])))
+                        return runtime::array_too_long(errors, "ARRAY_NEW-VAR", resolved.names[current->f_slot]);
+
+                    memory[current->f_slot] = created;
+                }
+                NEXT();
+            HANDLER(ARRAY_RESIZE)
+                // Keeps the first elements of the array, the new ones are zeros.
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_RESIZE-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_RESIZE-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(!runtime::resize_array(heap.array(memory[current->f_slot]), runtime::to_integer(memory[current->s_slot])))
+                    return runtime::array_too_long(errors, "ARRAY_RESIZE-VAR", resolved.names[current->f_slot]);
+
+                NEXT();
+            HANDLER(ARRAY_LEN)
+                // Number of elements of the array in the second argument, as an integer.
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_LEN-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                memory[current->f_slot] = runtime::make_integer(static_cast<std::int64_t>(heap.array(memory[current->s_slot]).size()));
+                NEXT();
+            HANDLER(ARRAY_GET)
+                // Element of the array in the second argument at the index held by special variable "array_index".
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_GET-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(memory[runtime::SLOT_ARRAY_INDEX].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_GET-VAR-VAR", resolved.names[runtime::SLOT_ARRAY_INDEX], memory[runtime::SLOT_ARRAY_INDEX]);
+
+                {
+                    const std::vector<double>& elements = heap.array(memory[current->s_slot]);
+                    std::int64_t index = runtime::to_integer(memory[runtime::SLOT_ARRAY_INDEX]);
+
+                    if(index < 0 || static_cast<std::uint64_t>(index) >= elements.size())
+                        return runtime::out_of_range(errors, "ARRAY_GET-VAR-VAR", resolved.names[current->s_slot], index);
+
+                    memory[current->f_slot] = runtime::make_numeric(elements[static_cast<std::size_t>(index)]);
+                }
+                NEXT();
+            HANDLER(ARRAY_SET)
+                // Sets the element at the index held by special variable "array_index", the value is converted to a floating number.
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_SET-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_SET-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(memory[runtime::SLOT_ARRAY_INDEX].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_SET-VAR", resolved.names[runtime::SLOT_ARRAY_INDEX], memory[runtime::SLOT_ARRAY_INDEX]);
+
+                {
+                    std::vector<double>& elements = heap.array(memory[current->f_slot]);
+                    std::int64_t index = runtime::to_integer(memory[runtime::SLOT_ARRAY_INDEX]);
+
+                    if(index < 0 || static_cast<std::uint64_t>(index) >= elements.size())
+                        return runtime::out_of_range(errors, "ARRAY_SET-VAR", resolved.names[current->f_slot], index);
+
+                    elements[static_cast<std::size_t>(index)] = runtime::to_double(memory[current->s_slot]);
+                }
+                NEXT();
+            HANDLER(ARRAY_SUM)
+                // Sum of the elements, zero for an empty array.
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_SUM-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const std::vector<double>& elements = heap.array(memory[current->s_slot]);
+                    memory[current->f_slot] = runtime::make_numeric(simd::sum(elements.data(), nullptr, elements.size()));
+                }
+                NEXT();
+            HANDLER(ARRAY_MIN)
+                // Least element, an empty array has none.
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_MIN-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const std::vector<double>& elements = heap.array(memory[current->s_slot]);
+
+                    if(elements.empty())
+                        return runtime::empty_array(errors, "ARRAY_MIN-VAR-VAR", resolved.names[current->s_slot]);
+
+                    memory[current->f_slot] = runtime::make_numeric(simd::select_all<false>(elements.data(), elements.size()));
+                }
+                NEXT();
+            HANDLER(ARRAY_MAX)
+                // Greatest element, an empty array has none.
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_MAX-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const std::vector<double>& elements = heap.array(memory[current->s_slot]);
+
+                    if(elements.empty())
+                        return runtime::empty_array(errors, "ARRAY_MAX-VAR-VAR", resolved.names[current->s_slot]);
+
+                    memory[current->f_slot] = runtime::make_numeric(simd::select_all<true>(elements.data(), elements.size()));
+                }
+                NEXT();
+            HANDLER(ARRAY_SCALE)
+                // Multiplies each element by the value, in place.
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_SCALE-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ARRAY_SCALE-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    std::vector<double>& elements = heap.array(memory[current->f_slot]);
+                    simd::map(elements.data(), nullptr, elements.size(), runtime::to_double(memory[current->s_slot]), false);
+                }
+                NEXT();
+            HANDLER(ARRAY_ADD)
+                // Adds the value to each element, or the elements of an array of the same length, in place.
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_ADD-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED && memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_a_value(errors, "ARRAY_ADD-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    std::vector<double>& elements = heap.array(memory[current->f_slot]);
+
+                    if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                        simd::map(elements.data(), nullptr, elements.size(), runtime::to_double(memory[current->s_slot]), true);
+                    else if(heap.array(memory[current->s_slot]).size() != elements.size())
+                        return runtime::different_lengths(errors, "ARRAY_ADD-VAR-VAR", resolved.names[current->f_slot], resolved.names[current->s_slot]);
+                    else
+                        simd::map(elements.data(), heap.array(memory[current->s_slot]).data(), elements.size(), 0.0, true);
+                }
+                NEXT();
+            HANDLER(ARRAY_DOT)
+                // Dot product of two arrays of the same length, stored into special variable "dot_product".
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_DOT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_DOT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const std::vector<double>& first = heap.array(memory[current->f_slot]);
+                    const std::vector<double>& second = heap.array(memory[current->s_slot]);
+
+                    if(first.size() != second.size())
+                        return runtime::different_lengths(errors, "ARRAY_DOT-VAR-VAR", resolved.names[current->f_slot], resolved.names[current->s_slot]);
+
+                    memory[runtime::SLOT_DOT_PRODUCT] = runtime::make_numeric(simd::sum(first.data(), second.data(), first.size()));
+                }
+                NEXT();
+            HANDLER(ARRAY_SORT)
+                // Sorts the elements in increasing order, the not-a-number ones last.
+                if(memory[current->f_slot].type != runtime::DVT_ARRAY)
+                    return runtime::not_an_array(errors, "ARRAY_SORT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                runtime::sort_array(heap.array(memory[current->f_slot]));
+                NEXT();
+            HANDLER(MAP_NEW)
+                // Makes the first variable a new empty map. A copy of the variable refers to the same map.
+                memory[current->f_slot] = heap.make_map(memory);
+                NEXT();
+            HANDLER(MAP_PUT)
+                // Stores a copy of special variable "map_value" at the key, a number being the same key as its text.
+                if(memory[current->f_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_PUT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MAP_PUT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const std::string& key = runtime::key_of(memory[current->s_slot], key_text);
+                    heap.map(memory[current->f_slot]).insert(key, runtime::hash_of(resolved, current->s_slot, key)) = memory[runtime::SLOT_MAP_VALUE];
+                }
+                NEXT();
+            HANDLER(MAP_GET)
+                // Copies the value of the key into special variable "map_value", and stores whether it was found into special variable "cmp_register".
+                // map_value is left as it is when the key is not in the map.
+                if(memory[current->f_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_GET-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MAP_GET-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    runtime::hash_map& map = heap.map(memory[current->f_slot]);
+                    const std::string& key = runtime::key_of(memory[current->s_slot], key_text);
+                    std::size_t slot = map.find(key, runtime::hash_of(resolved, current->s_slot, key));
+
+                    if(slot != map.capacity())
+                        memory[runtime::SLOT_MAP_VALUE] = map.value(slot);
+
+                    runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], slot != map.capacity() ? 1 : 0);
+                }
+                NEXT();
+            HANDLER(MAP_HAS)
+                // Stores whether the key is in the map into special variable "cmp_register".
+                if(memory[current->f_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_HAS-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MAP_HAS-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    const runtime::hash_map& map = heap.map(memory[current->f_slot]);
+                    const std::string& key = runtime::key_of(memory[current->s_slot], key_text);
+
+                    runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], map.find(key, runtime::hash_of(resolved, current->s_slot, key)) != map.capacity() ? 1 : 0);
+                }
+                NEXT();
+            HANDLER(MAP_DEL)
+                // Removes the key, and stores whether it was in the map into special variable "cmp_register".
+                if(memory[current->f_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_DEL-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MAP_DEL-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                {
+                    runtime::hash_map& map = heap.map(memory[current->f_slot]);
+                    const std::string& key = runtime::key_of(memory[current->s_slot], key_text);
+                    std::size_t slot = map.find(key, runtime::hash_of(resolved, current->s_slot, key));
+
+                    if(slot != map.capacity())
+                        map.erase(slot);
+
+                    runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], slot != map.capacity() ? 1 : 0);
+                }
+                NEXT();
+            HANDLER(MAP_LEN)
+                // Number of keys of the map in the second argument, as an integer.
+                if(memory[current->s_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_LEN-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                memory[current->f_slot] = runtime::make_integer(static_cast<std::int64_t>(heap.map(memory[current->s_slot]).size()));
+                NEXT();
+            HANDLER(MAP_NEXT)
+                // Iterates the keys of the map in the second argument, from the position held by special variable "map_cursor" :
+                // the next key is stored in the first argument as a string, and map_cursor goes past it.
+                // cmp_register is 1 while there is a key, then 0 at the end : the first argument is then empty and map_cursor is 0 again.
+                if(memory[current->s_slot].type != runtime::DVT_MAP)
+                    return runtime::not_a_map(errors, "MAP_NEXT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(memory[runtime::SLOT_MAP_CURSOR].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "MAP_NEXT-VAR-VAR", resolved.names[runtime::SLOT_MAP_CURSOR], memory[runtime::SLOT_MAP_CURSOR]);
+
+                {
+                    const runtime::hash_map& map = heap.map(memory[current->s_slot]);
+                    std::int64_t cursor = runtime::to_integer(memory[runtime::SLOT_MAP_CURSOR]);
+                    std::size_t slot = map.next(cursor > 0 ? static_cast<std::size_t>(cursor) : 0);
+                    bool found = (slot != map.capacity());
+
+                    if(found)
+                        memory[current->f_slot].value = map.key(slot);
+                    else
+                        memory[current->f_slot].value.clear();
+
+                    memory[current->f_slot].type = runtime::DVT_STRING;
+                    memory[runtime::SLOT_MAP_CURSOR] = runtime::make_integer(found ? static_cast<std::int64_t>(slot + 1) : 0);
+                    runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], found ? 1 : 0);
+                }
+                NEXT();
+            HANDLER(ADD_NUMBER)
+                // Specialized add : both arguments hold numbers.
+                runtime::add_number(memory[current->f_slot], memory[current->s_slot]);
+                NEXT();
+            HANDLER(ADD_STRING)
+                // Specialized add : the first argument holds a string, the second one is defined.
+                if(!runtime::append(memory[current->f_slot].value, memory[current->s_slot]))
+                    return runtime::string_too_long(errors, "ADD-VAR", resolved.names[current->f_slot]);
+
+                NEXT();
+            HANDLER(MUL_NUMBER)
+                // Specialized mul : both arguments hold numbers.
+                runtime::mul_number(memory[current->f_slot], memory[current->s_slot]);
+                NEXT();
+            HANDLER(MUL_STRING)
+                // Specialized mul : the first argument holds a string, the second one is defined.
+                if(!runtime::repeat(memory[current->f_slot].value, runtime::to_integer(memory[current->s_slot])))
+                    return runtime::string_too_long(errors, "MUL-VAR", resolved.names[current->f_slot]);
+
+                NEXT();
+            HANDLER(CMP_EQ_NUMBER)
+                // Specialized cmp_eq : both arguments hold numbers.
+                flag = runtime::equals_number(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_EQ_STRING)
+                // Specialized cmp_eq : both arguments hold strings, compared without a copy.
+                flag = memory[current->f_slot].value == memory[current->s_slot].value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_GT_NUMBER)
+                // Specialized cmp_gt : both arguments hold numbers.
+                flag = runtime::greater_number(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_LT_NUMBER)
+                // Specialized cmp_lt : both arguments hold numbers.
+                flag = runtime::less_number(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(JZ_FLAG)
+                // Specialized jz : cmp_register comes from a comparison, the flag holds it.
+                if(!flag)
+                    cip = current->target;
+                NEXT();
+            HANDLER(JNZ_FLAG)
+                // Specialized jnz : cmp_register comes from a comparison, the flag holds it.
+                if(flag)
+                    cip = current->target;
+                NEXT();
+            HANDLER(CMP_GT_STRING)
+                // Specialized cmp_gt : both arguments hold strings, compared without a copy.
+                flag = memory[current->f_slot].value > memory[current->s_slot].value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_LT_STRING)
+                // Specialized cmp_lt : both arguments hold strings, compared without a copy.
+                flag = memory[current->f_slot].value < memory[current->s_slot].value;
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                NEXT();
+            HANDLER(CMP_EQ_JZ)
+                // Superinstruction : cmp_eq then jz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::equals(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (!flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(CMP_EQ_JNZ)
+                // Superinstruction : cmp_eq then jnz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::equals(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(CMP_GT_JZ)
+                // Superinstruction : cmp_gt then jz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::greater(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (!flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(CMP_GT_JNZ)
+                // Superinstruction : cmp_gt then jnz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_GT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::greater(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(CMP_LT_JZ)
+                // Superinstruction : cmp_lt then jz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::less(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (!flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(CMP_LT_JNZ)
+                // Superinstruction : cmp_lt then jnz (the next instruction).
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_LT-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::less(memory[current->f_slot], memory[current->s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (flag) ? current[1].target : cip + 1;
+                NEXT();
+            HANDLER(MOV_ADD)
+                // Superinstruction : mov then add on the same variable, a three operands add.
+                if(memory[current->s_slot].type == runtime::DVT_UNDEFINED)
+                    return runtime::unknown_variable(errors, "MOV-VAR-VAR", resolved.names[current->s_slot]);
+
+                memory[current->f_slot] = memory[current->s_slot];
+
+                if(memory[current->f_slot].type >= runtime::DVT_ARRAY)
+                    return runtime::not_a_value(errors, "ADD-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current[1].s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR-VAR", resolved.names[current[1].s_slot], memory[current[1].s_slot]);
+
+                if(!runtime::add(memory[current->f_slot], memory[current[1].s_slot]))
+                    return runtime::string_too_long(errors, "ADD-VAR", resolved.names[current->f_slot]);
+
+                cip += 1;
+                NEXT();
+            HANDLER(ADD_CMP_EQ_JZ)
+                // Superinstruction : add, cmp_eq then jz. Mostly a decrement and branch, like "add i, -1", "cmp_eq i, 0" and "jz loop".
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(!runtime::add(memory[current->f_slot], memory[current->s_slot]))
+                    return runtime::string_too_long(errors, "ADD-VAR", resolved.names[current->f_slot]);
+
+                if(memory[current[1].f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR", resolved.names[current[1].f_slot], memory[current[1].f_slot]);
+
+                if(memory[current[1].s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR-VAR", resolved.names[current[1].s_slot], memory[current[1].s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::equals(memory[current[1].f_slot], memory[current[1].s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (!flag) ? current[2].target : cip + 2;
+                NEXT();
+            HANDLER(ADD_CMP_EQ_JNZ)
+                // Superinstruction : add, cmp_eq then jnz. Mostly a decrement and branch, like "add i, -1", "cmp_eq i, 0" and "jnz loop".
+                if(memory[current->f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR", resolved.names[current->f_slot], memory[current->f_slot]);
+
+                if(memory[current->s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "ADD-VAR-VAR", resolved.names[current->s_slot], memory[current->s_slot]);
+
+                if(!runtime::add(memory[current->f_slot], memory[current->s_slot]))
+                    return runtime::string_too_long(errors, "ADD-VAR", resolved.names[current->f_slot]);
+
+                if(memory[current[1].f_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR", resolved.names[current[1].f_slot], memory[current[1].f_slot]);
+
+                if(memory[current[1].s_slot].type >= runtime::DVT_UNDEFINED)
+                    return runtime::not_a_value(errors, "CMP_EQ-VAR-VAR", resolved.names[current[1].s_slot], memory[current[1].s_slot]);
+
+                // cmp_register and the flag are still set, for the next instructions.
+                flag = runtime::equals(memory[current[1].f_slot], memory[current[1].s_slot]);
+                runtime::set_integer(memory[runtime::SLOT_CMP_REGISTER], flag ? 1 : 0);
+                cip = (flag) ? current[2].target : cip + 2;
+                NEXT();
+            HANDLER(JIT_LOOP)
+                // Runs a loop compiled by the JIT. It goes on with the loop itself if its variables do not hold numbers.
+                cip = resolved.native_loops[current->target](memory.data());
+
+                // The native code only sets cmp_register.
+                flag = runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) != 0;
+                NEXT();
+            HANDLER(TRACE_LOOP)
+                // Runs a loop by its trace once it is hot. It goes on with the loop itself before, and from where the trace leaves after.
+                cip = traces.enter(current->target, cip);
+
+                // The trace has its own flag.
+                flag = runtime::to_integer(memory[runtime::SLOT_CMP_REGISTER]) != 0;
+                NEXT();
+            default:
+                NEXT();
+        }
+
+        // The switch engine is back from the handler.
+        RETIRE();
+    }
+
+#ifdef SMALLTHINK_THREADED_CODE
+handle_end:
+#endif
+
+    #undef HANDLER
+    #undef NEXT
+    #undef RETIRE
+
+    return smallthink::ST_OK;
+}
+
+/*
+    Runs a program on the given register file and random generator with the given dispatch engine. The threaded engine falls back to the switch one where computed goto is not available.
+    With counters, the instrumented runtime is used : the profiled one with a profile too.
+*/
+smallthink::status run(const runtime::program& resolved, std::vector<runtime::dynamic_variable>& memory, runtime::random_generator& random, runtime::heap& heap, smallthink::engine used_engine, input_buffer& input, output_buffer& output, std::ostream& errors, smallthink::run_counters* counters = nullptr, profiler::profile* profile = nullptr)
+{
+    if(profile)
+    {
+        smallthink::status result;
+
+#ifdef SMALLTHINK_THREADED_CODE
+        if(used_engine == smallthink::ENGINE_THREADED)
+            result = execute<true, runtime::INSTRUMENT_PROFILE>(resolved, memory, random, heap, input, output, errors, counters, profile);
+        else
+#endif
+            result = execute<false, runtime::INSTRUMENT_PROFILE>(resolved, memory, random, heap, input, output, errors, counters, profile);
+
+        // The last instruction is done when the runtime returns.
+        profile->finish();
+        return result;
+    }
+
+    if(counters)
+    {
+#ifdef SMALLTHINK_THREADED_CODE
+        if(used_engine == smallthink::ENGINE_THREADED)
+            return execute<true, runtime::INSTRUMENT_COUNTERS>(resolved, memory, random, heap, input, output, errors, counters, nullptr);
+#endif
+
+        return execute<false, runtime::INSTRUMENT_COUNTERS>(resolved, memory, random, heap, input, output, errors, counters, nullptr);
+    }
+
+#ifdef SMALLTHINK_THREADED_CODE
+    if(used_engine == smallthink::ENGINE_THREADED)
+        return execute<true, runtime::INSTRUMENT_NONE>(resolved, memory, random, heap, input, output, errors, nullptr, nullptr);
+#else
+    (void)used_engine;
+#endif
+
+    return execute<false, runtime::INSTRUMENT_NONE>(resolved, memory, random, heap, input, output, errors, nullptr, nullptr);
+}
+
+/* Interface of the library, see smallthink.hpp. */
+namespace smallthink
+{
+    /* Returns the peak resident memory of the process in KiB, or -1 where it is not known. */
+    long peak_resident_memory()
+    {
+#ifndef _WIN32
+        struct rusage usage;
+
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1;
+
+#ifdef __APPLE__
+        // In bytes on macOS, in KiB elsewhere.
+        return static_cast<long>(usage.ru_maxrss / 1024);
+#else
+        return static_cast<long>(usage.ru_maxrss);
+#endif
+#else
+        return -1;
+#endif
+    }
+
+    /* Writes a JSON string, the control characters escaped. */
+    void write_json_string(std::ostream& stream, const std::string& text)
+    {
+        stream << "\"";
+
+        for(std::size_t i(0) ; i < text.size() ; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+
+            if(c == '"' || c == '\\')
+            {
+                stream << '\\' << text[i];
+            }
+            else if(c < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                stream << escaped;
+            }
+            else
+            {
+                stream << text[i];
+            }
+        }
+
+        stream << "\"";
+    }
+
+    void statistics::write(std::ostream& stream, const std::string& filename, int exit_code) const
+    {
+        double total(0.0);
+        char number[32];
+
+        stream << "{" << std::endl;
+        stream << "    \"file\": ";
+        write_json_string(stream, filename);
+        stream << "," << std::endl;
+        stream << "    \"exit_code\": " << exit_code << "," << std::endl;
+        stream << "    \"phases\": {";
+
+        for(std::size_t i(0) ; i < m_phases.size() ; ++i)
+        {
+            snprintf(number, sizeof(number), "%.9f", m_phases[i].second);
+            stream << (i > 0 ? "," : "") << std::endl << "        \"" << m_phases[i].first << "\": " << number;
+            total += m_phases[i].second;
+        }
+
+        snprintf(number, sizeof(number), "%.9f", total);
+        stream << std::endl << "    }," << std::endl;
+        stream << "    \"total\": " << number << "," << std::endl;
+        stream << "    \"instructions_retired\": " << counters.instructions << "," << std::endl;
+        stream << "    \"taken_branches\": " << counters.taken_branches << "," << std::endl;
+        stream << "    \"native_loops\": " << counters.native_loops << "," << std::endl;
+        stream << "    \"traced_loops\": " << counters.traced_loops << "," << std::endl;
+        stream << "    \"peak_rss_kb\": ";
+
+        long peak = peak_resident_memory();
+
+        if(peak >= 0)
+            stream << peak;
+        else
+            stream << "null";
+
+        stream << std::endl << "}" << std::endl;
+    }
+
+    std::string default_cache_directory()
+    {
+#ifndef _WIN32
+        const char* cache_home = std::getenv("XDG_CACHE_HOME");
+
+        if(cache_home != nullptr && cache_home[0] == '/')
+            return std::string(cache_home) + "/smallthink";
+
+        const char* home = std::getenv("HOME");
+
+        if(home != nullptr && home[0] == '/')
+            return std::string(home) + "/.cache/smallthink";
+#endif
+
+        return std::string();
+    }
+
+    /* The resolved program, and the native code of its loops. */
+    struct program::implementation
+    {
+        runtime::program resolved;
+        jit::executable_memory native_code;
+        bool compiled;
+        bool lowered; // Compiled by the JIT, specialized, traced or fused : it can not be saved.
+
+        implementation() : compiled(false), lowered(false)
+        {
+        }
+    };
+
+    program::program() : m_implementation(new implementation())
+    {
+    }
+
+    program::~program()
+    {
+    }
+
+    status program::compile_file(const std::string& filename, const compile_options& options)
+    {
+        statistics unused;
+        statistics& stats = options.stats ? *options.stats : unused;
+        mapped_file file;
+
+        if(!file.open(filename))
+        {
+            *options.errors << "[ERROR] Can not open file : " << filename << std::endl;
+            return ST_INVALID_INPUT;
+        }
+
+        stats.end_phase("open");
+
+        // The source is not needed once compiled.
+        return compile(file.data(), file.size(), options);
+    }
+
+    /*
+        Coordinates lexer, parser, optimizer and the lowering passes.
+        Bytecode is recognized and loaded directly. Each phase is timed in the statistics when given.
+    */
+    status program::compile(const char* data, std::size_t size, const compile_options& options)
+    {
+        statistics unused;
+        statistics& stats = options.stats ? *options.stats : unused;
+        std::unique_ptr<implementation> compiled(new implementation());
+        runtime::program& resolved = compiled->resolved;
+
+        stats.begin_phase();
+
+        std::string cache_entry;
+
+        if(bytecode::is_bytecode(data, size))
+        {
+            if(!bytecode::load(data, size, resolved, *options.errors))
+                return ST_INVALID_INPUT;
+
+            stats.end_phase("load");
+        }
+        else if(!options.cache_directory.empty() && cache::load(cache_entry = cache::entry_path(options.cache_directory, data, size, options.optimize), data, size, options.optimize, resolved))
+        {
+            // The entry was saved after the optimizer.
+            stats.end_phase("cache");
+        }
+        else
+        {
+            // Tokens are views into the source, and into this buffer for the strings with escaped characters.
+            // Instructions refer to the tokens by index : the front end is freed at once at the end of this block.
+            std::string unescaped;
+            std::vector<data::token> tokens = lex(data, size, unescaped);
+            stats.end_phase("lex");
+
+            runtime::debug_info debug;
+            std::vector<runtime::instruction> instructions;
+            status parsed = parse(tokens, instructions, debug.lines, *options.errors);
+
+            if(parsed != ST_OK)
+                return parsed;
+
+            stats.end_phase("parse");
+
+            // Unknown labels are rejected before the execution.
+            if(!resolve_labels(instructions, tokens, debug, *options.errors))
+                return ST_RUNTIME_ERROR;
+
+            stats.end_phase("labels");
+
+            resolved = resolve(instructions, tokens);
+            resolved.debug = debug;
+            stats.end_phase("resolve");
+
+            if(options.optimize)
+            {
+                optimizer::optimize(resolved);
+                stats.end_phase("optimize");
+            }
+
+            if(!cache_entry.empty())
+            {
+                cache::store(options.cache_directory, cache_entry, data, size, options.optimize, resolved);
+                stats.end_phase("cache_store");
+            }
+        }
+
+        // Bytecode is optimized once loaded, it was saved before the optimizer.
+        if(options.optimize && bytecode::is_bytecode(data, size))
+        {
+            optimizer::optimize(resolved);
+            stats.end_phase("optimize");
+        }
+
+        // The tracing tier takes the loops the JIT can not compile.
+        if(options.trace)
+        {
+            tracing::mark(resolved, options.use_jit, options.specialize);
+            compiled->lowered = true;
+            stats.end_phase("trace");
+        }
+
+        // The JIT reads the instructions before they are fused.
+        if(options.use_jit)
+        {
+            jit::compile(resolved, compiled->native_code);
+            compiled->lowered = true;
+            stats.end_phase("jit");
+        }
+
+        // The superinstructions take the place of the specialized instructions they begin with.
+        if(options.specialize)
+        {
+            types::specialize(resolved);
+            compiled->lowered = true;
+            stats.end_phase("types");
+        }
+        if(options.fuse)
+        {
+            fuse(resolved);
+            compiled->lowered = true;
+            stats.end_phase("fuse");
+        }
+
+        runtime::hash_constant_keys(resolved);
+
+        compiled->compiled = true;
+        m_implementation.swap(compiled);
+        return ST_OK;
+    }
+
+    bool program::compiled() const
+    {
+        return m_implementation->compiled;
+    }
+
+    void program::dump(std::ostream& stream) const
+    {
+        ::dump(m_implementation->resolved, stream);
+    }
+
+    void program::explain_types(std::ostream& stream) const
+    {
+        types::explain(m_implementation->resolved, stream);
+    }
+
+    status program::save(const std::string& filename, std::ostream& errors) const
+    {
+        if(m_implementation->lowered)
+        {
+            errors << "[ERROR] Can not save a program compiled by the JIT or fused : " << filename << std::endl;
+            return ST_INVALID_INPUT;
+        }
+
+        if(!bytecode::save(m_implementation->resolved, filename))
+        {
+            errors << "[ERROR] Can not write file : " << filename << std::endl;
+            return ST_INVALID_INPUT;
+        }
+
+        return ST_OK;
+    }
+
+    /* The register file, the random generator, the arrays and maps of the current run, and the profile of the last profiled run. */
+    struct vm::implementation
+    {
+        const program::implementation& compiled;
+        std::vector<runtime::dynamic_variable> memory;
+        runtime::random_generator random;
+        runtime::heap heap;
+        std::unique_ptr<profiler::profile> profile;
+        run_counters counters; // Counted by a profiled run without statistics.
+
+        explicit implementation(const program::implementation& program) : compiled(program)
+        {
+        }
+    };
+
+    vm::vm(const program& compiled) : m_implementation(new implementation(*compiled.m_implementation))
+    {
+    }
+
+    vm::~vm()
+    {
+    }
+
+    status vm::run(input_buffer& input, output_buffer& output, const run_options& options)
+    {
+        const runtime::program& resolved = m_implementation->compiled.resolved;
+        run_counters* counters = options.stats ? &options.stats->counters : nullptr;
+
+        if(options.profile && !counters)
+            counters = &m_implementation->counters;
+
+        // The register file is reset to the initial one, its strings keep their memory where they can.
+        m_implementation->memory = resolved.memory;
+        m_implementation->heap.clear();
+        m_implementation->random.reseed(options.seed);
+
+        if(options.profile)
+            m_implementation->profile.reset(new profiler::profile(resolved));
+
+        if(options.stats)
+            options.stats->begin_phase();
+
+        status result(ST_RUNTIME_ERROR);
+
+        // A run out of memory fails alone : the host process goes on.
+        try
+        {
+            result = ::run(resolved, m_implementation->memory, m_implementation->random, m_implementation->heap, options.used_engine, input, output, *options.errors, counters, options.profile ? m_implementation->profile.get() : nullptr);
+        }
+        catch(const std::bad_alloc&)
+        {
+            *options.errors << std::endl << "[ERROR] Out of memory" << std::endl;
+        }
+
+        if(options.stats)
+            options.stats->end_phase("execute");
+
+        return result;
+    }
+
+    void vm::report_profile(std::ostream& stream) const
+    {
+        if(m_implementation->profile)
+            m_implementation->profile->report(stream);
+    }
+
+} // smallthink namespace.
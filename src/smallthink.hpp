@@ -0,0 +1,303 @@
+/*
+	smallthink.hpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	libsmallthink, the SmallThink interpreter as a library (src/smallthink.cpp).
+
+	A program is compiled once, from a file or from a buffer holding a source or bytecode, then run any number of times by virtual machines.
+	Each virtual machine has its own register file and reads and writes through the buffers given to run() : they can write to a string,
+	read from a string, or use the standard streams. The program is only read while running, it is never copied.
+	Errors are printed on the given error stream and returned as status codes, the library never exits.
+
+		smallthink::program rules;
+
+		if(rules.compile_file("rules.small") != smallthink::ST_OK)
+			return;
+
+		smallthink::vm machine(rules);
+		smallthink::string_input request("42 apples");
+		smallthink::string_output response;
+		output_buffer output(output_buffer::FP_EXIT, &response);
+		input_buffer input(&output, &request);
+
+		machine.run(input, output);
+		output.flush();
+		// response.text holds what the program printed.
+*/
+
+#ifndef SMALLTHINK_HPP
+#define SMALLTHINK_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "input_buffer.hpp"
+#include "output_buffer.hpp"
+
+namespace smallthink
+{
+	// Result of the library calls, prefixed by ST_ (STATUS_). The values are the exit codes of the interpreter.
+	enum status
+	{
+		ST_OK = 0,
+		ST_INVALID_INPUT = 1,  // A file can not be read or written, a token is unexpected, or the bytecode is invalid.
+		ST_INTERNAL_ERROR = 2, // The parser is lost.
+		ST_RUNTIME_ERROR = 3   // An unknown label or variable, a too long string or array, or an array or a map used where it can not be (index out of range...).
+	};
+
+	// Dispatch engines of the runtime, prefixed by ENGINE_.
+	enum engine
+	{
+		ENGINE_SWITCH,  // A portable loop around a switch on the opcode.
+		ENGINE_THREADED // Computed goto, where GCC and Clang build the library. Falls back to the switch engine elsewhere.
+	};
+
+	// Counters of a run.
+	struct run_counters
+	{
+		std::uint64_t instructions; // Instructions retired, counted as in the source : a superinstruction counts for each instruction it runs.
+		std::uint64_t taken_branches; // Jumps which went somewhere else than the next instruction.
+		std::uint64_t native_loops; // Loops run by the native code of the JIT. Their instructions are not counted.
+		std::uint64_t traced_loops; // Loops run by a trace of the tracing tier. Their instructions are counted.
+
+		run_counters() : instructions(0), taken_branches(0), native_loops(0), traced_loops(0)
+		{
+		}
+	};
+
+	/*
+		Statistics of a compilation and of the runs of the program : the time of each phase and the counters of the runtime.
+		The phases are timed with std::chrono::steady_clock, in seconds. A bytecode file has a load phase instead of the front end ones.
+	*/
+	class statistics
+	{
+		public:
+			run_counters counters;
+
+			statistics() : m_start(std::chrono::steady_clock::now())
+			{
+			}
+
+			// Starts the clock of the next phase, when something not measured comes before it.
+			void begin_phase()
+			{
+				m_start = std::chrono::steady_clock::now();
+			}
+
+			// Records the time since the beginning of the phase, the next one begins at once.
+			void end_phase(const char* name)
+			{
+				std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+				m_phases.push_back(std::make_pair(std::string(name), std::chrono::duration<double>(end - m_start).count()));
+				m_start = end;
+			}
+
+			// Writes the statistics as a JSON object, with the peak resident memory of the process.
+			void write(std::ostream& stream, const std::string& filename, int exit_code) const;
+
+		private:
+			std::chrono::steady_clock::time_point m_start;
+			std::vector<std::pair<std::string, double> > m_phases;
+	};
+
+	// How a program is compiled.
+	struct compile_options
+	{
+		bool optimize; // Propagates and folds constants, removes dead instructions and moves loop invariants out (-O).
+		bool use_jit; // Compiles the loops which only compute numbers to native code, on x86-64 Unix systems.
+		bool fuse; // Replaces common sequences by superinstructions. A profiled program is not fused, so each instruction is counted.
+		bool specialize; // Infers the types of the variables, and replaces the add, mul and cmp_* whose argument types are known by handlers which do not check them.
+		bool trace; // Records the hot loops the JIT did not compile and whose types are not inferred, and runs them as traces specialized for the types seen, with guards.
+		std::ostream* errors; // Where the errors are printed.
+		statistics* stats; // Times the phases of the compilation when given.
+		std::string cache_directory; // Where the compiled sources are cached, see default_cache_directory(). Empty for no cache.
+
+		compile_options() : optimize(false), use_jit(true), fuse(true), specialize(true), trace(true), errors(&std::cerr), stats(nullptr)
+		{
+		}
+	};
+
+	/*
+		Directory of the compile cache : $XDG_CACHE_HOME/smallthink, else ~/.cache/smallthink, or empty where there is none.
+		A source is cached after the optimizer, keyed by its content, -O and the versions of the entries and of the bytecode : a cached source
+		is neither lexed, parsed, resolved nor optimized again. Entries are written with an atomic rename, and any invalid entry is ignored.
+		compile_options::cache_directory is empty by default : the cache is only used when it is given.
+	*/
+	std::string default_cache_directory();
+
+	// How a program is run.
+	struct run_options
+	{
+		engine used_engine;
+		bool profile; // Counts and times each instruction, see vm::report_profile().
+		std::ostream* errors; // Where the errors are printed.
+		statistics* stats; // Counts the instructions and times the execution when given.
+		std::uint64_t seed; // Seed of the random values of the virtual machine, 0 to seed it from the clock.
+
+		run_options() : used_engine(ENGINE_THREADED), profile(false), errors(&std::cerr), stats(nullptr), seed(0)
+		{
+		}
+	};
+
+	/*
+		A compiled program : lexed, parsed, resolved, optimized and lowered (JIT, types, traced loops and superinstructions) once.
+		It is only read by the virtual machines, so it may be run by several of them at once.
+	*/
+	class program
+	{
+		public:
+			program();
+			~program();
+
+			// Compiles a source or bytecode file.
+			status compile_file(const std::string& filename, const compile_options& options = compile_options());
+
+			// Compiles a source or bytecode held in memory. The buffer is not needed afterwards.
+			status compile(const char* data, std::size_t size, const compile_options& options = compile_options());
+
+			// Returns true once a compilation succeeded.
+			bool compiled() const;
+
+			// Prints the instructions of the program.
+			void dump(std::ostream& stream) const;
+
+			// Prints the add, mul and cmp_* instructions whose argument types are not known at compile time, with these types. It must be compiled without the superinstructions.
+			void explain_types(std::ostream& stream) const;
+
+			// Saves the program as bytecode. It must be compiled with neither the JIT nor the superinstructions, which are not saved.
+			status save(const std::string& filename, std::ostream& errors = std::cerr) const;
+
+		private:
+			friend class vm;
+
+			// Not copyable, the native code is owned.
+			program(const program&);
+			program& operator=(const program&);
+
+			struct implementation;
+			std::unique_ptr<implementation> m_implementation;
+	};
+
+	/*
+		A virtual machine running a program : it owns the register file, which is reset at each run, and its random generator.
+		Virtual machines share nothing, so different ones may run at once on different threads.
+	*/
+	class vm
+	{
+		public:
+			// The program must be compiled, and must outlive the virtual machine.
+			explicit vm(const program& compiled);
+			~vm();
+
+			// Runs the program once, reading from the input buffer and printing in the output buffer. The output is not flushed.
+			status run(input_buffer& input, output_buffer& output, const run_options& options = run_options());
+
+			// Prints the report of the last profiled run : the instructions sorted by time, then the opcodes.
+			void report_profile(std::ostream& stream) const;
+
+		private:
+			// Not copyable, a register file belongs to one virtual machine.
+			vm(const vm&);
+			vm& operator=(const vm&);
+
+			struct implementation;
+			std::unique_ptr<implementation> m_implementation;
+	};
+
+	// Output sink appending to a string.
+	class string_output : public output_buffer::sink
+	{
+		public:
+			std::string text;
+
+			virtual bool write(const char* data, std::size_t size)
+			{
+				text.append(data, size);
+				return true;
+			}
+	};
+
+	// Input source reading a file, or nothing if it can not be opened.
+	class file_input : public input_buffer::source
+	{
+		public:
+			explicit file_input(const std::string& filename) : m_file(fopen(filename.c_str(), "rb"))
+			{
+			}
+
+			virtual ~file_input()
+			{
+				if(m_file != nullptr)
+					fclose(m_file);
+			}
+
+			bool is_open() const
+			{
+				return m_file != nullptr;
+			}
+
+			virtual std::size_t read(char* data, std::size_t size)
+			{
+				return m_file != nullptr ? fread(data, 1, size, m_file) : 0;
+			}
+
+		private:
+			// Not copyable, the file is owned.
+			file_input(const file_input&);
+			file_input& operator=(const file_input&);
+
+			FILE* m_file;
+	};
+
+	// Input source reading a string.
+	class string_input : public input_buffer::source
+	{
+		public:
+			explicit string_input(const std::string& text) : m_text(text), m_position(0)
+			{
+			}
+
+			virtual std::size_t read(char* data, std::size_t size)
+			{
+				std::size_t count = m_text.copy(data, size, m_position);
+				m_position += count;
+
+				return count;
+			}
+
+		private:
+			std::string m_text;
+			std::size_t m_position;
+	};
+
+} // smallthink namespace.
+
+#endif // SMALLTHINK_HPP
@@ -73,6 +73,13 @@ class string_utils
             std::transform(data.begin(), data.end(), data.begin(), ::tolower);
             return data;
         }
+
+        // Convert a std::string to uppercase.
+        static std::string uppercase(std::string data)
+        {
+            std::transform(data.begin(), data.end(), data.begin(), ::toupper);
+            return data;
+        }
 };
 
 #endif // STRING_UTILS_HPP
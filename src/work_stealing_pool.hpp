@@ -0,0 +1,155 @@
+/*
+	work_stealing_pool.hpp
+
+	The MIT License (MIT)
+
+	Copyright (c) 2013 Maxime Alvarez
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	work_stealing_pool is a class which runs numbered jobs on several threads.
+	The jobs are dealt in contiguous ranges, one per worker. A worker takes its jobs in order from the front of its own queue,
+	and when it is empty it steals from the back of the queue of another one : long jobs do not leave the other threads idle.
+*/
+
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class work_stealing_pool
+{
+	public:
+		// Work done for each job.
+		class task
+		{
+			public:
+				virtual ~task()
+				{
+				}
+
+				// Runs the job of the given number. Called by several threads at once, for different jobs.
+				virtual void run(std::size_t job) = 0;
+		};
+
+		// Zero workers means one per hardware thread.
+		explicit work_stealing_pool(unsigned int workers = 0) : m_workers(workers)
+		{
+			if(m_workers == 0)
+				m_workers = std::thread::hardware_concurrency();
+
+			if(m_workers == 0)
+				m_workers = 1;
+		}
+
+		unsigned int workers() const
+		{
+			return m_workers;
+		}
+
+		// Runs the jobs 0 to count - 1, and returns when they are all done. The calling thread is one of the workers.
+		void run(task& to_do, std::size_t count)
+		{
+			std::size_t workers = std::min<std::size_t>(m_workers, count);
+
+			if(workers == 0)
+				return;
+
+			std::vector<queue> queues(workers);
+
+			for(std::size_t i(0) ; i < workers ; ++i)
+			{
+				for(std::size_t job(count * i / workers) ; job < count * (i + 1) / workers ; ++job)
+					queues[i].jobs.push_back(job);
+			}
+
+			std::vector<std::thread> threads;
+
+			for(std::size_t i(1) ; i < workers ; ++i)
+				threads.push_back(std::thread(&work_stealing_pool::work, &to_do, &queues, i));
+
+			work(&to_do, &queues, 0);
+
+			for(std::size_t i(0) ; i < threads.size() ; ++i)
+				threads[i].join();
+		}
+
+	private:
+		// Jobs of a worker.
+		struct queue
+		{
+			std::mutex lock;
+			std::deque<std::size_t> jobs;
+		};
+
+		// Takes the next job of the queue : from the front for its own worker, from the back for a thief. Returns false if it is empty.
+		static bool take(queue& from, bool steal, std::size_t& job)
+		{
+			std::lock_guard<std::mutex> guard(from.lock);
+
+			if(from.jobs.empty())
+				return false;
+
+			if(steal)
+			{
+				job = from.jobs.back();
+				from.jobs.pop_back();
+			}
+			else
+			{
+				job = from.jobs.front();
+				from.jobs.pop_front();
+			}
+
+			return true;
+		}
+
+		// Loop of a worker : its own jobs, then the ones it steals, until every queue is empty. No job is ever added.
+		static void work(task* to_do, std::vector<queue>* queues, std::size_t self)
+		{
+			std::size_t job;
+
+			for(;;)
+			{
+				if(take((*queues)[self], false, job))
+				{
+					to_do->run(job);
+					continue;
+				}
+
+				bool stolen = false;
+
+				for(std::size_t i(1) ; i < queues->size() && !stolen ; ++i)
+					stolen = take((*queues)[(self + i) % queues->size()], true, job);
+
+				if(!stolen)
+					return;
+
+				to_do->run(job);
+			}
+		}
+
+		unsigned int m_workers;
+};
+
+#endif // WORK_STEALING_POOL_HPP
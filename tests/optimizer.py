@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+SmallThink optimizer tests.
+
+Runs each script of tests/optimizer (*.small) with -O and without it (switch engine, no JIT, no trace),
+and compares the outputs, the error outputs and the exit codes. Any difference is a failure : the exit code is then 1.
+
+Usage :
+    tests/optimizer.py [script ...] [--binary linux/bin/smallthink]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+TESTS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "optimizer")
+ROOT_DIR = os.path.dirname(os.path.dirname(TESTS_DIR))
+
+# Reference run : the program as written, on the simplest engine.
+REFERENCE = ["-engine=switch", "-jit=off", "-trace=off", "-cache=off"]
+OPTIMIZED = ["-O", "-cache=off"]
+
+
+def scripts(names):
+    """Returns the names of the scripts to run, all of them by default."""
+    found = sorted(name[:-len(".small")] for name in os.listdir(TESTS_DIR) if name.endswith(".small"))
+
+    for name in names:
+        if name not in found:
+            sys.exit("Unknown script : " + name)
+
+    return names or found
+
+
+def run(binary, script, options):
+    """Runs a script once with an empty input. Returns the exit code, the output and the error output."""
+    command = [binary, os.path.join(TESTS_DIR, script + ".small")] + options
+    result = subprocess.run(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=10)
+
+    return result.returncode, result.stdout, result.stderr
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SmallThink optimizer tests.")
+    parser.add_argument("scripts", nargs="*", help="scripts to run (all by default)")
+    parser.add_argument("--binary", default=os.path.join(ROOT_DIR, "linux", "bin", "smallthink"), help="interpreter to test")
+    arguments = parser.parse_args()
+
+    if not os.path.isfile(arguments.binary):
+        sys.exit("Interpreter not found : %s (build it with project/stupidbuild.sh or give --binary)." % arguments.binary)
+
+    failures = []
+
+    for script in scripts(arguments.scripts):
+        expected = run(arguments.binary, script, REFERENCE)
+        optimized = run(arguments.binary, script, OPTIMIZED)
+
+        if optimized == expected:
+            print("%-24s ok" % script)
+            continue
+
+        print("%-24s FAILED" % script)
+        print("    expected  : exit %d, %r %r" % expected)
+        print("    with -O   : exit %d, %r %r" % optimized)
+        failures.append(script)
+
+    if failures:
+        print("Failures : " + ", ".join(failures))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())